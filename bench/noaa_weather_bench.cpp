@@ -0,0 +1,785 @@
+// Copyright(C) 2025 by Steven Adler
+//
+// This file is part of NOAA Weather plugin for OpenCPN.
+//
+// NOAA Weather plugin for OpenCPN is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// NOAA Weather plugin for OpenCPN is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with the NOAA Weather plugin for OpenCPN. If not, see <https://www.gnu.org/licenses/>.
+//
+
+// Benchmarks of the plugin's parsing, indexing and hit testing code.
+// Built without the OpenCPN host, see bench/CMakeLists.txt
+//
+// Usage: noaa_weather_bench [data folder] [name filter]
+//
+// Each benchmark is repeated for at least BENCH_MIN_SECONDS and reports the time per operation,
+// the throughput for those that consume a file, and the number of heap allocations per operation.
+
+#include "noaa_weather_parser.h"
+#include "noaa_weather_columns.h"
+#include "noaa_weather_spatial.h"
+#include "noaa_weather_clusters.h"
+#include "noaa_weather_hittest.h"
+#include "noaa_weather_extractor.h"
+#include "noaa_weather_history.h"
+#include "noaa_weather_alerts.h"
+#include "noaa_weather_monitor.h"
+#include "noaa_weather_prefetch.h"
+#include "noaa_weather_route.h"
+#include "noaa_weather_barbs.h"
+
+// STL
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <new>
+#include <regex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#ifndef NOAA_BENCH_DATA
+#define NOAA_BENCH_DATA "data"
+#endif
+
+#define BENCH_MIN_SECONDS 0.5
+
+// The fixtures are a handful of stations, they are replicated to the size of the full NDBC network
+#define BENCH_STATION_LIST_COPIES 60
+#define BENCH_SCHEDULED_REPORTS_COPIES 45
+
+// Synthetic stations and view ports for the spatial index and hit test
+#define BENCH_STATIONS 2000
+#define BENCH_VIEWPORTS 64
+#define BENCH_ICONS 1000
+#define BENCH_ICON_SIZE 32
+#define BENCH_CANVAS_WIDTH 1920
+#define BENCH_CANVAS_HEIGHT 1080
+
+// Synthetic alert areas, about the number of active marine alerts on a busy day
+#define BENCH_ALERTS 300
+#define BENCH_ALERT_POINTS 200
+
+// Milliseconds the stand-in server takes to answer each realtime request
+#define BENCH_STANDIN_LATENCY 400
+
+// Count every allocation made through operator new. Every replaceable form is defined, so each
+// allocation is paired with a matching release however the compiler chooses to call them
+static std::atomic<unsigned long long> allocations(0);
+
+static void *Allocate(size_t size) {
+	allocations++;
+	return malloc(size > 0 ? size : 1);
+}
+
+void *operator new(size_t size) {
+	void *p = Allocate(size);
+	if (p == NULL) {
+		throw std::bad_alloc();
+	}
+	return p;
+}
+
+void *operator new[](size_t size) {
+	return operator new(size);
+}
+
+void *operator new(size_t size, const std::nothrow_t&) noexcept {
+	return Allocate(size);
+}
+
+void *operator new[](size_t size, const std::nothrow_t&) noexcept {
+	return Allocate(size);
+}
+
+// GCC inlines these into their callers and then warns that free is called on memory from operator new,
+// which is exactly how this replacement pairs them
+#if defined(__GNUC__) && !defined(__clang__) && (__GNUC__ >= 11)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+void operator delete(void *p) noexcept {
+	free(p);
+}
+
+void operator delete[](void *p) noexcept {
+	free(p);
+}
+
+void operator delete(void *p, const std::nothrow_t&) noexcept {
+	free(p);
+}
+
+void operator delete[](void *p, const std::nothrow_t&) noexcept {
+	free(p);
+}
+
+#if __cplusplus >= 201402L
+void operator delete(void *p, size_t) noexcept {
+	free(p);
+}
+
+void operator delete[](void *p, size_t) noexcept {
+	free(p);
+}
+#endif
+
+#if defined(__GNUC__) && !defined(__clang__) && (__GNUC__ >= 11)
+#pragma GCC diagnostic pop
+#endif
+
+// Defeat dead code elimination of the results
+static volatile size_t sink;
+
+static std::string filter;
+
+// Run a benchmark, bytes is the amount of input consumed by each operation (0 if not applicable)
+static void Run(const char *name, size_t bytes, std::function<void()> operation) {
+	if ((!filter.empty()) && (strstr(name, filter.c_str()) == NULL)) {
+		return;
+	}
+
+	// Warm up, and a first guess at how many operations fit in the minimum time
+	operation();
+
+	unsigned long long iterations = 0;
+	unsigned long long allocated = 0;
+	double elapsed = 0;
+	unsigned long long batch = 1;
+
+	while (elapsed < BENCH_MIN_SECONDS) {
+		unsigned long long before = allocations;
+		auto start = std::chrono::steady_clock::now();
+		for (unsigned long long i = 0; i < batch; i++) {
+			operation();
+		}
+		auto end = std::chrono::steady_clock::now();
+		allocated += allocations - before;
+		elapsed += std::chrono::duration<double>(end - start).count();
+		iterations += batch;
+		batch *= 2;
+	}
+
+	double nanoseconds = (elapsed * 1e9) / iterations;
+	if (bytes > 0) {
+		double megabytes = ((double)bytes * iterations) / (elapsed * 1024 * 1024);
+		printf("%-36s %10llu %12.0f %10.1f %12.1f\n", name, iterations, nanoseconds, megabytes, (double)allocated / iterations);
+	}
+	else {
+		printf("%-36s %10llu %12.0f %10s %12.1f\n", name, iterations, nanoseconds, "-", (double)allocated / iterations);
+	}
+}
+
+static bool ReadFixture(const std::string& folder, const char *name, std::string *contents) {
+	std::ifstream file(folder + "/" + name, std::ios::in | std::ios::binary);
+	if (!file) {
+		fprintf(stderr, "Unable to open fixture %s/%s\n", folder.c_str(), name);
+		return false;
+	}
+	std::ostringstream stream;
+	stream << file.rdbuf();
+	*contents = stream.str();
+	return true;
+}
+
+// Repeat the data lines of a fixture, keeping the header lines once.
+// Each copy's station id (the first token) gets a suffix, so the ids stay distinct
+static std::string Replicate(const std::string& fixture, int copies) {
+	std::vector<std::string> headers;
+	std::vector<std::string> lines;
+	std::istringstream stream(fixture);
+	std::string line;
+	while (std::getline(stream, line)) {
+		if (line.empty()) {
+			continue;
+		}
+		if (line[0] == '#') {
+			headers.push_back(line);
+		}
+		else {
+			lines.push_back(line);
+		}
+	}
+
+	std::string result;
+	for (const auto& it : headers) {
+		result += it + "\n";
+	}
+	for (int i = 0; i < copies; i++) {
+		for (const auto& it : lines) {
+			size_t idEnd = it.find_first_of(" |");
+			if (i == 0) {
+				result += it;
+			}
+			else {
+				result += it.substr(0, idEnd) + "_" + std::to_string((long long)i) + it.substr(idEnd);
+			}
+			result += "\n";
+		}
+	}
+	return result;
+}
+
+// Deterministic pseudo random numbers, so every run measures the same work
+static unsigned int seed = 12345;
+
+static double Random(double minimum, double maximum) {
+	seed = (seed * 1103515245) + 12345;
+	return minimum + ((maximum - minimum) * ((seed >> 8) & 0xFFFF) / 65535.0);
+}
+
+// The regular expression formerly used to parse a station list location, as a baseline for the tokenizer
+static size_t ParseStationListRegex(const std::string& data) {
+	static const std::regex position("([0-9]{1,2}.[0-9]{3})\\s(N|S)\\s([0-9]{1,3}.[0-9]{3})\\s(E|W)*");
+	std::istringstream stream(data);
+	std::string line;
+	std::smatch match;
+	size_t count = 0;
+	while (std::getline(stream, line)) {
+		if ((line.empty()) || (line[0] == '#')) {
+			continue;
+		}
+		// The location is the seventh field
+		size_t field = 0;
+		for (int j = 0; (j < 6) && (field != std::string::npos); j++) {
+			field = line.find('|', field);
+			if (field != std::string::npos) {
+				field++;
+			}
+		}
+		if (field == std::string::npos) {
+			continue;
+		}
+		std::string location = line.substr(field, line.find('|', field) - field);
+		if (std::regex_search(location, match, position)) {
+			double latitude = atof(match[1].str().c_str());
+			double longitude = atof(match[3].str().c_str());
+			count += ((latitude != 0) || (longitude != 0)) ? 1 : 0;
+		}
+	}
+	return count;
+}
+
+// The loop formerly used to parse latest_obs.txt, as a baseline for ParseScheduledReports. Like the
+// original it matches each column, copies the rest of the line after every match and pushes a record per column
+static size_t ParseScheduledReportsRegex(const std::string& data) {
+	static const std::regex column("(\\b(MM)|([A-Z0-9]{4,6})|((-?\\d+\\.)?\\d+)\\b)");
+	std::istringstream stream(data);
+	std::string line;
+	std::smatch match;
+	std::vector<BuoyData> allBuoys;
+	BuoyData buoy;
+	ClearObservation(&buoy);
+
+	// Read past the first two lines which are headers
+	std::getline(stream, line);
+	std::getline(stream, line);
+
+	while (std::getline(stream, line)) {
+		std::string remainder = line;
+		int j = 0;
+		while (std::regex_search(remainder, match, column)) {
+			if (j == 0) {
+				buoy.id = match[1].str();
+			}
+			if (j == 1) {
+				buoy.latitude = atof(match[1].str().c_str());
+			}
+			if (j == 2) {
+				buoy.longitude = atof(match[1].str().c_str());
+			}
+			if (j == 8) {
+				buoy.windDirection = atoi(match[1].str().c_str());
+			}
+			if (j == 9) {
+				buoy.windSpeed = atof(match[1].str().c_str());
+			}
+			if (j == 15) {
+				buoy.barometricPressure = atof(match[1].str().c_str());
+			}
+			if (j == 17) {
+				buoy.airTemperature = atof(match[1].str().c_str());
+			}
+			allBuoys.push_back(buoy);
+			remainder = match.suffix().str();
+			j++;
+		}
+	}
+	return allBuoys.size();
+}
+
+// The regular expression used to parse a realtime observation line by line, as used by the plugin
+static size_t ParseRealtimeRegex(const std::string& data) {
+	static const std::regex column("(\\b(MM)|([A-Z0-9]{4,6})|((-?\\d+\\.)?\\d+)\\b)");
+	std::istringstream stream(data);
+	std::string line;
+	size_t count = 0;
+	while (std::getline(stream, line)) {
+		if ((line.empty()) || (line[0] == '#')) {
+			continue;
+		}
+		BuoyData buoy;
+		ClearObservation(&buoy);
+		int j = 0;
+		for (std::sregex_iterator it(line.begin(), line.end(), column), end; it != end; ++it, j++) {
+			if (j == 5) {
+				buoy.windDirection = atoi((*it)[1].str().c_str());
+			}
+			if (j == 6) {
+				buoy.windSpeed = atof((*it)[1].str().c_str());
+			}
+			if (j == 12) {
+				buoy.barometricPressure = atof((*it)[1].str().c_str());
+			}
+			if (j == 13) {
+				buoy.airTemperature = atof((*it)[1].str().c_str());
+			}
+		}
+		count += IsReported(buoy.windSpeed) ? 1 : 0;
+	}
+	return count;
+}
+
+// The same, using the tokenizer
+static size_t ParseRealtimeTokenizer(const std::string& data) {
+	NDBC_Tokenizer tokenizer(data.data(), data.size());
+	size_t count = 0;
+	while (tokenizer.NextLine()) {
+		if (tokenizer.IsHeader()) {
+			continue;
+		}
+		BuoyData buoy;
+		ClearObservation(&buoy);
+		const char *column;
+		size_t length;
+		for (int j = 0; (j <= 13) && (tokenizer.NextColumn(&column, &length)); j++) {
+			switch (j) {
+				case 5:
+					if (!ParseColumn(column, length, &buoy.windDirection)) {
+						buoy.windDirection = NDBC_MISSING_DIRECTION;
+					}
+					break;
+				case 6:
+					ParseColumn(column, length, &buoy.windSpeed);
+					break;
+				case 12:
+					ParseColumn(column, length, &buoy.barometricPressure);
+					break;
+				case 13:
+					ParseColumn(column, length, &buoy.airTemperature);
+					break;
+				default:
+					break;
+			}
+		}
+		count += IsReported(buoy.windSpeed) ? 1 : 0;
+	}
+	return count;
+}
+
+// The alert areas of an /alerts/active response, the polygons the plugin's ReadAlert decodes with wxJSON
+// (which the benchmarks can't link). Alerts without a geometry of their own, only their zones, are skipped
+static void DecodeAlertAreas(const std::string& json, std::vector<AlertData> *alerts) {
+	size_t position = 0;
+	while ((position = json.find("\"geometry\":", position)) != std::string::npos) {
+		position = json.find_first_not_of(" \t\r\n", position + 11);
+		if ((position == std::string::npos) || (json[position] != '{')) {
+			continue;
+		}
+
+		// Rings are nested one level deeper in a MultiPolygon
+		size_t type = json.find('"', json.find("\"type\":", position) + 7);
+		int polygonDepth = (json.compare(type + 1, 12, "MultiPolygon") == 0) ? 2 : 1;
+
+		AlertData alert;
+		const char *p = json.c_str() + json.find('[', json.find("\"coordinates\":", position));
+		int depth = 0;
+		do {
+			if (*p == '[') {
+				depth++;
+				if (depth == polygonDepth) {
+					alert.polygons.push_back(AlertPolygon());
+				}
+				else if (depth == polygonDepth + 1) {
+					alert.polygons.back().push_back(AlertRing());
+				}
+				p++;
+			}
+			else if (*p == ']') {
+				depth--;
+				p++;
+			}
+			else if ((*p == '-') || ((*p >= '0') && (*p <= '9'))) {
+				char *end;
+				alert.polygons.back().back().push_back(strtod(p, &end));
+				p = end;
+			}
+			else {
+				p++;
+			}
+		} while (depth > 0);
+
+		alerts->push_back(alert);
+		position = p - json.c_str();
+	}
+}
+
+int main(int argc, char *argv[]) {
+	std::string folder = (argc > 1) ? argv[1] : NOAA_BENCH_DATA;
+	if (argc > 2) {
+		filter = argv[2];
+	}
+
+	std::string stationTable, latestObs, realtime, gridpoint, alerts;
+	if ((!ReadFixture(folder, "station_table.txt", &stationTable)) ||
+		(!ReadFixture(folder, "latest_obs.txt", &latestObs)) ||
+		(!ReadFixture(folder, "41001.txt", &realtime)) ||
+		(!ReadFixture(folder, "gridpoint.json", &gridpoint)) ||
+		(!ReadFixture(folder, "alerts.json", &alerts))) {
+		return EXIT_FAILURE;
+	}
+
+	stationTable = Replicate(stationTable, BENCH_STATION_LIST_COPIES);
+	latestObs = Replicate(latestObs, BENCH_SCHEDULED_REPORTS_COPIES);
+
+	printf("%-36s %10s %12s %10s %12s\n", "benchmark", "iterations", "ns/op", "MB/s", "allocs/op");
+
+	// Parsers
+
+	Run("station list (tokenizer)", stationTable.size(), [&]() {
+		NOAA_StationColumns buoys;
+		sink = ParseStationList(stationTable.data(), stationTable.size(), &buoys);
+	});
+
+	Run("station list (regex)", stationTable.size(), [&]() {
+		sink = ParseStationListRegex(stationTable);
+	});
+
+	Run("scheduled reports (tokenizer)", latestObs.size(), [&]() {
+		NOAA_StationColumns buoys;
+		sink = ParseScheduledReports(latestObs.data(), latestObs.size(), &buoys);
+	});
+
+	Run("scheduled reports (regex)", latestObs.size(), [&]() {
+		sink = ParseScheduledReportsRegex(latestObs);
+	});
+
+	Run("realtime observations (tokenizer)", realtime.size(), [&]() {
+		sink = ParseRealtimeTokenizer(realtime);
+	});
+
+	Run("realtime observations (regex)", realtime.size(), [&]() {
+		sink = ParseRealtimeRegex(realtime);
+	});
+
+	// The whole file into an empty history, and a re-fetch of the same file which stops at the first line
+	Run("realtime history (all columns)", realtime.size(), [&]() {
+		NOAA_StationHistory history;
+		sink = history.Update(realtime.data(), realtime.size());
+	});
+
+	NOAA_StationHistory refetched;
+	refetched.Update(realtime.data(), realtime.size());
+	Run("realtime history (re-fetch)", realtime.size(), [&]() {
+		sink = refetched.Update(realtime.data(), realtime.size());
+	});
+
+	// Forecasts, every layer, and only the default layers as the plugin extracts them for the dialog.
+	// Keys are compared in place, so skipping the other layers costs less than merging them
+	Run("forecast merge (all layers)", gridpoint.size(), [&]() {
+		NOAA_Forecast forecast;
+		std::string error;
+		ExtractForecastLayers(gridpoint.data(), gridpoint.size(), std::vector<std::string>(), &forecast, &error);
+		sink = forecast.Hours();
+	});
+
+	std::vector<std::string> defaultLayers;
+	defaultLayers.push_back("temperature");
+	defaultLayers.push_back("windDirection");
+	defaultLayers.push_back("windSpeed");
+	Run("forecast merge (3 layers)", gridpoint.size(), [&]() {
+		NOAA_Forecast forecast;
+		std::string error;
+		ExtractForecastLayers(gridpoint.data(), gridpoint.size(), defaultLayers, &forecast, &error);
+		sink = forecast.Hours();
+	});
+
+	// Forecast along a 300nm route of ten waypoints, sampled every ten miles. A few samples share each
+	// cell, as along a real route, and all of the cells have the recorded forecast. This is the work
+	// repeated each time the route is edited, once its cells have been downloaded
+	NOAA_Forecast routeCell;
+	std::string routeError;
+	ExtractForecastLayers(gridpoint.data(), gridpoint.size(), NOAA_RouteForecast::GetLayerNames(), &routeCell, &routeError);
+
+	std::vector<RouteWaypoint> route;
+	for (int i = 0; i < 10; i++) {
+		RouteWaypoint waypoint;
+		waypoint.name = "WP" + std::to_string((long long)i);
+		waypoint.latitude = 35.0 + (i * 0.5);
+		waypoint.longitude = -75.0 + ((i % 2) * 0.2);
+		route.push_back(waypoint);
+	}
+
+	NOAA_RouteForecast routeForecast;
+	routeForecast.Plan(route, 6.0, routeCell.Time(0));
+	for (size_t i = 0; i < routeForecast.Samples(); i++) {
+		routeForecast.SetForecast("cell" + std::to_string((long long)(i / 3)), routeCell, 0);
+	}
+
+	std::vector<RouteForecastRow> routeRows;
+	Run("route forecast (plan and compute)", 0, [&]() {
+		routeForecast.Plan(route, 6.0, routeCell.Time(0));
+		for (size_t i = 0; i < routeForecast.Samples(); i++) {
+			routeForecast.SetCell(i, "cell" + std::to_string((long long)(i / 3)));
+		}
+		routeForecast.Compute(&routeRows);
+		sink = routeRows.size();
+	});
+
+	// Viewport filtering, FilterVisibleBuoys
+	NOAA_StationColumns stations;
+	stations.Reserve(BENCH_STATIONS);
+	for (int i = 0; i < BENCH_STATIONS; i++) {
+		BuoyData buoy;
+		ClearObservation(&buoy);
+		buoy.id = std::to_string((long long)i);
+		buoy.name = buoy.id;
+		buoy.latitude = Random(-70, 70);
+		buoy.longitude = Random(-180, 180);
+		stations.Add(buoy);
+	}
+	NOAA_SpatialIndex index;
+
+	Run("spatial index build", 0, [&]() {
+		index.Build(stations.Latitudes(), stations.Longitudes(), stations.Size());
+		sink = index.Size();
+	});
+
+	// A mix of harbour, coastal and ocean scale view ports, some crossing the antimeridian
+	std::vector<double> viewports;
+	for (int i = 0; i < BENCH_VIEWPORTS; i++) {
+		double size = (i % 3 == 0) ? 0.5 : (i % 3 == 1) ? 5.0 : 40.0;
+		double latitude = Random(-60, 60 - size);
+		double longitude = Random(-180, 180);
+		viewports.push_back(latitude);
+		viewports.push_back(latitude + size);
+		viewports.push_back(longitude);
+		viewports.push_back(NOAA_SpatialIndex::NormalizeLongitude(longitude + size));
+	}
+
+	std::vector<unsigned int> visible;
+	size_t viewport = 0;
+	Run("filter visible buoys", 0, [&]() {
+		const double *v = &viewports[(viewport++ % BENCH_VIEWPORTS) * 4];
+		index.Query(v[0], v[1], v[2], v[3], &visible);
+		sink = visible.size();
+	});
+
+	// Prefetching a settled view port against a stand-in server, which answers every request with the
+	// recorded realtime file after a fixed latency. Each answer is parsed into the station's history as the plugin does.
+	// The clock is simulated, so this measures the planning and parsing, not the latency
+	long long standinTime = 0;
+	unsigned long long standinRequests = 0;
+	unsigned long long standinViewports = 0;
+	Run("prefetch visible stations", 0, [&]() {
+		const double *v = &viewports[(viewport++ % BENCH_VIEWPORTS) * 4];
+		index.Query(v[0], v[1], v[2], v[3], &visible);
+
+		std::vector<PrefetchRequest> requests;
+		for (auto it : visible) {
+			PrefetchRequest request;
+			request.key = stations.Id(it);
+			request.url = "http://localhost:8000/data/realtime2/" + request.key + ".txt";
+			request.distance = NOAA_PositionMonitor::Distance(v[0], v[2], stations.Latitude(it), stations.Longitude(it));
+			requests.push_back(request);
+		}
+
+		NOAA_PrefetchQueue queue;
+		NOAA_HistoryStore histories;
+		long long now = 0;
+		queue.SetWanted(requests, PREFETCH_STATIONS, now);
+
+		std::vector<std::pair<long long, std::string>> inFlight;
+		PrefetchRequest request;
+		while (true) {
+			while (queue.Next(now, &request)) {
+				inFlight.push_back(std::make_pair(now + BENCH_STANDIN_LATENCY, request.key));
+				standinRequests++;
+			}
+			long long delay = queue.Delay(now);
+			if ((inFlight.empty()) && (delay < 0)) {
+				break;
+			}
+
+			// Advance to the next answer, or to when the next request may start
+			long long next = (delay >= 0) ? now + delay : inFlight.front().first;
+			for (const auto& it : inFlight) {
+				next = std::min(next, it.first);
+			}
+			now = std::max(next, now + 1);
+
+			for (auto it = inFlight.begin(); it != inFlight.end(); ) {
+				if (it->first <= now) {
+					NOAA_StationHistory& history = histories.Get(it->second);
+					history.Update(realtime.data(), realtime.size());
+					queue.Complete(it->second, !history.Empty(), now);
+					it = inFlight.erase(it);
+				}
+				else {
+					++it;
+				}
+			}
+		}
+		standinTime += now;
+		standinViewports++;
+		sink = histories.Size();
+	});
+	if (standinViewports > 0) {
+		printf("%-36s %.1f requests, %.0f ms (simulated) per view port\n", "  stand-in server",
+			(double)standinRequests / standinViewports, (double)standinTime / standinViewports);
+	}
+
+	// Cluster pyramid, built with the index at refresh time and queried at the ocean scale view ports
+	NOAA_ClusterPyramid clusters;
+	Run("cluster pyramid build", 0, [&]() {
+		clusters.Build(stations);
+		sink = clusters.Size(0);
+	});
+
+	Run("filter visible clusters", 0, [&]() {
+		const double *v = &viewports[(viewport++ % BENCH_VIEWPORTS) * 4];
+		clusters.Query(NOAA_ClusterPyramid::SelectLevel(BENCH_CANVAS_WIDTH / (v[1] - v[0]), 64), v[0], v[1], v[2], v[3], &visible);
+		sink = visible.size();
+	});
+
+	// Hit testing, IsUnderCursor. Each frame records the icons as they are drawn
+	NOAA_HitTest hitTest;
+	std::vector<int> iconX, iconY;
+	for (int i = 0; i < BENCH_ICONS; i++) {
+		iconX.push_back((int)Random(0, BENCH_CANVAS_WIDTH - BENCH_ICON_SIZE));
+		iconY.push_back((int)Random(0, BENCH_CANVAS_HEIGHT - BENCH_ICON_SIZE));
+	}
+
+	Run("hit test frame (1000 icons)", 0, [&]() {
+		hitTest.Reset(BENCH_CANVAS_WIDTH, BENCH_CANVAS_HEIGHT);
+		for (int i = 0; i < BENCH_ICONS; i++) {
+			hitTest.Add(i, iconX[i], iconY[i], BENCH_ICON_SIZE, BENCH_ICON_SIZE);
+		}
+		sink = hitTest.Size();
+	});
+
+	int cursor = 0;
+	Run("is under cursor", 0, [&]() {
+		unsigned int found;
+		int x = (cursor * 37) % BENCH_CANVAS_WIDTH;
+		int y = (cursor * 53) % BENCH_CANVAS_HEIGHT;
+		cursor++;
+		sink = hitTest.Find(x, y, &found) ? found : 0;
+	});
+
+	// Wind barbs, generated for the stations of each frame. The speeds (m/s) and directions are random
+	NOAA_BarbBatch barbBatch;
+	std::vector<float> barbSpeeds, barbDirections;
+	for (int i = 0; i < BENCH_ICONS; i++) {
+		barbSpeeds.push_back((float)Random(0, 40));
+		barbDirections.push_back((float)Random(0, 360));
+	}
+
+	Run("wind barbs frame (1000 stations, lines)", 0, [&]() {
+		barbBatch.Begin(0.1, BARB_OUTPUT_LINES);
+		for (int i = 0; i < BENCH_ICONS; i++) {
+			barbBatch.Add(iconX[i], iconY[i], barbDirections[i], barbSpeeds[i] * BARB_KNOTS_PER_MS, 48, i % 4 == 0);
+		}
+		sink = barbBatch.Lines().size() + barbBatch.Triangles().size();
+	});
+
+	Run("wind barbs frame (1000 stations, polygons)", 0, [&]() {
+		barbBatch.Begin(0.1, BARB_OUTPUT_POLYGONS);
+		for (int i = 0; i < BENCH_ICONS; i++) {
+			barbBatch.Add(iconX[i], iconY[i], barbDirections[i], barbSpeeds[i] * BARB_KNOTS_PER_MS, 48, i % 4 == 0);
+		}
+		sink = barbBatch.Outlines().size() + barbBatch.Triangles().size();
+	});
+
+	// Alert areas, SetPositionFix checks the vessel's position against every active alert
+	std::vector<AlertData> alertAreas;
+	for (int i = 0; i < BENCH_ALERTS; i++) {
+		double latitude = Random(20, 50);
+		double longitude = Random(-130, -60);
+		double radius = Random(0.5, 3.0);
+		AlertRing ring;
+		for (int j = 0; j <= BENCH_ALERT_POINTS; j++) {
+			double angle = (2.0 * 3.14159265358979 * (j % BENCH_ALERT_POINTS)) / BENCH_ALERT_POINTS;
+			double r = radius * Random(0.8, 1.0);
+			ring.push_back(longitude + (r * cos(angle)));
+			ring.push_back(latitude + (r * sin(angle)));
+		}
+		AlertData alert;
+		alert.polygons.push_back(AlertPolygon(1, ring));
+		alertAreas.push_back(alert);
+	}
+
+	NOAA_AlertIndex alertIndex;
+	Run("alert index build", 0, [&]() {
+		std::vector<AlertData> copy = alertAreas;
+		alertIndex.Build(copy);
+		sink = alertIndex.PolygonCount();
+	});
+
+	std::vector<unsigned int> applicable;
+	int fix = 0;
+	Run("alerts at position", 0, [&]() {
+		alertIndex.Query(20.0 + ((fix * 7) % 3000) / 100.0, -130.0 + ((fix * 13) % 7000) / 100.0, &applicable);
+		fix++;
+		sink = applicable.size();
+	});
+
+	// The same, with the areas of the recorded alerts. Each position fix is at the centre of one of the
+	// areas or well outside all of them, as a vessel mostly is
+	std::vector<AlertData> recordedAlerts;
+	DecodeAlertAreas(alerts, &recordedAlerts);
+	std::vector<double> recordedFixes;
+	for (const auto& alert : recordedAlerts) {
+		const AlertRing& ring = alert.polygons[0][0];
+		double latitude = 0, longitude = 0;
+		for (size_t i = 0; i + 1 < ring.size(); i += 2) {
+			longitude += ring[i];
+			latitude += ring[i + 1];
+		}
+		recordedFixes.push_back(latitude / (ring.size() / 2));
+		recordedFixes.push_back(longitude / (ring.size() / 2));
+		recordedFixes.push_back(Random(20, 50));
+		recordedFixes.push_back(Random(-130, -60));
+	}
+
+	Run("alert index build (alerts.json)", 0, [&]() {
+		std::vector<AlertData> copy = recordedAlerts;
+		alertIndex.Build(copy);
+		sink = alertIndex.PolygonCount();
+	});
+
+	fix = 0;
+	Run("alerts at position (alerts.json)", 0, [&]() {
+		const double *position = &recordedFixes[(fix++ % (recordedFixes.size() / 2)) * 2];
+		alertIndex.Query(position[0], position[1], &applicable);
+		sink = applicable.size();
+	});
+
+	return EXIT_SUCCESS;
+}
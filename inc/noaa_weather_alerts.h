@@ -0,0 +1,120 @@
+// Copyright(C) 2025 by Steven Adler
+//
+// This file is part of NOAA Weather plugin for OpenCPN.
+//
+// NOAA Weather plugin for OpenCPN is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// NOAA Weather plugin for OpenCPN is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with the NOAA Weather plugin for OpenCPN. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef NOAA_WEATHER_ALERTS_H
+#define NOAA_WEATHER_ALERTS_H
+
+// Index of the areas of the active National Weather Service alerts.
+// Free of wxWidgets and OpenCPN, the alerts are converted from the JSON response by the plugin.
+
+// STL
+#include <string>
+#include <vector>
+#include <cstddef>
+
+// A closed GeoJSON ring, alternating longitude and latitude
+typedef std::vector<double> AlertRing;
+
+// The outer boundary followed by any holes
+typedef std::vector<AlertRing> AlertPolygon;
+
+typedef struct _alertdata {
+	std::string id;
+	std::string event;
+	std::string severity;
+	std::string headline;
+	std::string description;
+	std::string expires;
+	// The area the alert applies to, an alert without polygons never matches a position
+	std::vector<AlertPolygon> polygons;
+} AlertData;
+
+// Point in polygon queries over the alert areas, answered locally for every position fix.
+// A bounding box tree over the polygons finds the few whose bounds contain the position.
+// Each polygon's edges are bucketed into bands of latitude, so the crossing test only
+// examines the edges of the band containing the position rather than the whole boundary.
+// Longitudes are used as given, NWS alert areas do not cross the antimeridian.
+class NOAA_AlertIndex {
+
+public:
+	NOAA_AlertIndex();
+
+	// Replace the indexed alerts, the alerts are moved into the index
+	void Build(std::vector<AlertData>& alerts);
+	void Clear(void);
+
+	// Replace the contents of results with the indices of the alerts whose area contains the position,
+	// each alert at most once and in the order they were built
+	void Query(double latitude, double longitude, std::vector<unsigned int> *results) const;
+
+	const AlertData& Alert(unsigned int index) const { return alerts[index]; }
+	size_t Size(void) const { return alerts.size(); }
+	size_t PolygonCount(void) const { return polygons.size(); }
+
+private:
+	typedef struct _bounds {
+		double minLatitude;
+		double maxLatitude;
+		double minLongitude;
+		double maxLongitude;
+	} Bounds;
+
+	typedef struct _edge {
+		double latitude0;
+		double longitude0;
+		double latitude1;
+		double longitude1;
+	} Edge;
+
+	typedef struct _polygon {
+		unsigned int alert;
+		Bounds bounds;
+		// The polygon's bands of latitude, bandOffsets[firstBand + b] to bandOffsets[firstBand + b + 1]
+		// are the indices into bandEdges of the edges crossing band b
+		unsigned int firstBand;
+		unsigned int bands;
+		double bandHeight;
+	} Polygon;
+
+	// Nodes are stored depth first, a node's first child immediately follows it
+	typedef struct _node {
+		Bounds bounds;
+		// Leaves cover order[first] to order[first + count - 1]
+		unsigned int first;
+		unsigned int count;
+		// Index of the second child, 0 for a leaf
+		unsigned int second;
+	} Node;
+
+	void AddPolygon(unsigned int alert, const AlertPolygon& polygon);
+	unsigned int BuildNode(unsigned int first, unsigned int count);
+	bool Contains(const Polygon& polygon, double latitude, double longitude) const;
+
+	static bool Inside(const Bounds& bounds, double latitude, double longitude);
+
+	std::vector<AlertData> alerts;
+	std::vector<Polygon> polygons;
+	std::vector<Edge> edges;
+	std::vector<unsigned int> bandOffsets;
+	std::vector<unsigned int> bandEdges;
+	std::vector<Node> nodes;
+	// Polygon indices, reordered as the tree is built
+	std::vector<unsigned int> order;
+};
+
+#endif
@@ -0,0 +1,105 @@
+// Copyright(C) 2025 by Steven Adler
+//
+// This file is part of NOAA Weather plugin for OpenCPN.
+//
+// NOAA Weather plugin for OpenCPN is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// NOAA Weather plugin for OpenCPN is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with the NOAA Weather plugin for OpenCPN. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef NOAA_WEATHER_BARBS_H
+#define NOAA_WEATHER_BARBS_H
+
+// STL
+#include <vector>
+#include <cstddef>
+
+// NDBC wind speeds are m/s, barbs are drawn in knots
+#define BARB_KNOTS_PER_MS 1.943844
+
+// Barbs are drawn to the nearest 5 knots, up to 200 knots (four pennants)
+#define BARB_STEP 5
+#define BARB_BUCKETS 41
+
+// Below half a step the wind is calm, drawn as a circle
+#define BARB_CALM_SEGMENTS 12
+
+// Which vertices Add generates
+typedef enum _barboutput {
+	BARB_OUTPUT_LINES = 0,		// Line segments and triangles, for GL_LINES and GL_TRIANGLES
+	BARB_OUTPUT_POLYGONS = 1	// One closed outline per barb and the pennants, for wxDC::DrawPolyPolygon
+} BARB_OUTPUT;
+
+// Wind barbs of every visible station, generated into a few flat vertex arrays so a frame's barbs
+// are drawn with one call per primitive type. The shape of each 5 knot bucket is generated once, in
+// the barb's own coordinates (the staff is one unit long, pointing at where the wind comes from),
+// and each station's barb is that shape rotated, scaled and moved to the station.
+class NOAA_BarbBatch {
+
+public:
+	NOAA_BarbBatch();
+
+	// Start a frame. northAngle is the screen angle (radians, clockwise from up) of true north,
+	// so the barbs follow a rotated chart
+	void Begin(double northAngle, BARB_OUTPUT output);
+
+	// Queue a barb whose staff starts at x,y. Direction is where the wind is from (degrees true),
+	// the speed is in knots and size the staff length in pixels. In the southern hemisphere the
+	// feathers are drawn on the other side of the staff
+	void Add(float x, float y, float direction, float speed, float size, bool southern);
+
+	// x, y pairs. Lines has two vertices per segment, Triangles three per pennant
+	const std::vector<float>& Lines(void) const { return lines; }
+	const std::vector<float>& Triangles(void) const { return triangles; }
+
+	// The outlines, each closed and with its number of vertices in OutlineCounts
+	const std::vector<float>& Outlines(void) const { return outlines; }
+	const std::vector<int>& OutlineCounts(void) const { return outlineCounts; }
+
+	size_t Size(void) const { return barbs; }
+
+	static int Bucket(float speed);
+
+private:
+	typedef struct _barbshape {
+		// Local x, y pairs: segment end points, pennant corners and the outline
+		std::vector<float> lines;
+		std::vector<float> triangles;
+		std::vector<float> outline;
+	} BarbShape;
+
+	void BuildShape(int bucket, BarbShape *shape);
+
+	// Transform local x, y pairs and append them
+	void Append(const std::vector<float>& local, std::vector<float> *result) const;
+
+	BarbShape shapes[BARB_BUCKETS];
+
+	BARB_OUTPUT output;
+	double northAngle;
+	size_t barbs;
+
+	// Transform of the barb being added
+	float originX;
+	float originY;
+	float staffX;
+	float staffY;
+	float featherX;
+	float featherY;
+
+	std::vector<float> lines;
+	std::vector<float> triangles;
+	std::vector<float> outlines;
+	std::vector<int> outlineCounts;
+};
+
+#endif
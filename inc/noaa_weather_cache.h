@@ -0,0 +1,134 @@
+// Copyright(C) 2025 by Steven Adler
+//
+// This file is part of NOAA Weather plugin for OpenCPN.
+//
+// NOAA Weather plugin for OpenCPN is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// NOAA Weather plugin for OpenCPN is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with the NOAA Weather plugin for OpenCPN. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef NOAA_WEATHER_CACHE_H
+#define NOAA_WEATHER_CACHE_H
+
+// Pre compiled headers
+#include "wx/wxprec.h"
+
+#ifndef WX_PRECOMP
+#include <wx/wx.h>
+#endif
+
+// wxWidgets include files
+#include <wx/filename.h>
+#include <wx/file.h>
+#include <wx/textfile.h>
+#include <wx/tokenzr.h>
+#include <wx/uri.h>
+#include <wx/datetime.h>
+
+// STL
+#include <map>
+#include <vector>
+
+// Max ages with a special meaning, from the Cache-Control directives
+#define CACHE_NO_CACHE -1	// Stored, but revalidated with the server before every use
+#define CACHE_NO_STORE -2	// Never stored
+
+// Seconds between writes of the index, changes in between are only held in memory
+#define CACHE_INDEX_INTERVAL 60
+
+typedef enum _cachestatus {
+	CACHE_MISS = 0,
+	CACHE_FRESH = 1,	// Can be used without contacting the server
+	CACHE_STALE = 2,	// Can be used, but should be revalidated
+	CACHE_EXPIRED = 3	// Too old to be used, only its validators are returned for a conditional request
+} CACHE_STATUS;
+
+typedef struct _cacheentry {
+	// Seconds since the epoch when the response was fetched or last revalidated
+	long long fetched;
+	// Seconds since the epoch when the entry was last used, for LRU eviction
+	long long accessed;
+	// Seconds the response remains fresh after it was fetched, or CACHE_NO_CACHE
+	long long maxAge;
+	unsigned long long size;
+	// Validators used for conditional requests
+	wxString eTag;
+	wxString lastModified;
+} CacheEntry;
+
+// Disk backed cache of HTTP responses keyed by normalized URL.
+// Each response body is stored in its own file, the metadata in an index that survives restarts.
+class NOAA_ResponseCache {
+
+public:
+	NOAA_ResponseCache();
+	~NOAA_ResponseCache();
+
+	// Open (creating if necessary) the cache folder and load its index
+	bool Open(const wxString& folder, unsigned long long maxBytes);
+
+	// Write the index, the cache can then be reopened
+	void Close(void);
+
+	// Write the index if it has changed since it was last written. Changes are otherwise written
+	// at most every CACHE_INDEX_INTERVAL seconds, so a burst of downloads doesn't rewrite it for each response
+	void Flush(void);
+
+	bool IsOpen(void) const { return !folder.IsEmpty(); }
+
+	// Look up a response. On a hit the body and its metadata are returned. A response more than maxStale
+	// seconds past its max age, or one that must always be revalidated, is CACHE_EXPIRED and only the
+	// metadata is returned. A negative maxStale has no limit
+	CACHE_STATUS Lookup(const wxString& url, long long now, long long maxStale, std::vector<char> *body, CacheEntry *entry);
+
+	// Store a response, evicting the least recently used entries if the cache is full.
+	// A maxAge of CACHE_NO_STORE removes any copy already held instead
+	void Store(const wxString& url, long long now, long long maxAge,
+		const wxString& eTag, const wxString& lastModified, const std::vector<char>& body);
+
+	// The server confirmed (HTTP 304) a stale entry is still valid
+	void Revalidate(const wxString& url, long long now, long long maxAge);
+
+	// The body of a response whatever its age, eg. once it has been revalidated.
+	// Returns false if the response is no longer held
+	bool Read(const wxString& url, long long now, std::vector<char> *body);
+
+	unsigned long long Size(void) const { return totalBytes; }
+
+	// Lower case the scheme and host, remove default ports and fragments and sort the query parameters,
+	// so equivalent URLs share an entry
+	static wxString NormalizeUrl(const wxString& url);
+
+	// The max-age directive of a Cache-Control header, or defaultAge if there isn't one.
+	// Returns CACHE_NO_STORE or CACHE_NO_CACHE for those directives
+	static long long ParseMaxAge(const wxString& cacheControl, long long defaultAge);
+
+private:
+	wxString GetBodyFileName(const wxString& key) const;
+	void Remove(std::map<wxString, CacheEntry>::iterator it);
+	bool ReadBody(std::map<wxString, CacheEntry>::iterator it, std::vector<char> *body);
+	void Changed(long long now);
+	void Evict(unsigned long long required);
+	bool SaveIndex(void);
+	void LoadIndex(void);
+
+	wxString folder;
+	unsigned long long maxBytes;
+	unsigned long long totalBytes;
+	std::map<wxString, CacheEntry> entries;
+
+	// Whether the index in memory differs from the file, and when (seconds since the epoch) it was last written
+	bool dirty;
+	long long savedAt;
+};
+
+#endif
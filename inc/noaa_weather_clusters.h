@@ -0,0 +1,84 @@
+// Copyright(C) 2025 by Steven Adler
+//
+// This file is part of NOAA Weather plugin for OpenCPN.
+//
+// NOAA Weather plugin for OpenCPN is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// NOAA Weather plugin for OpenCPN is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with the NOAA Weather plugin for OpenCPN. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef NOAA_WEATHER_CLUSTERS_H
+#define NOAA_WEATHER_CLUSTERS_H
+
+// Station list columns
+#include "noaa_weather_columns.h"
+
+// STL
+#include <vector>
+#include <cstddef>
+
+// Cell size of the finest level, in degrees. Each level doubles the cell size, up to 64 degrees
+#define CLUSTER_CELL_SIZE 0.25
+#define CLUSTER_LEVELS 9
+
+// Stations sharing a cell at one level of the pyramid
+typedef struct _stationcluster {
+	// Mean position of the stations
+	float latitude;
+	float longitude;
+	unsigned int count;
+	// Index of a station in the cluster, the only one when count is 1
+	unsigned int station;
+	// Mean wind speed of the stations reporting wind, NaN if none do
+	float windSpeed;
+	unsigned int windCount;
+	// Cell within the level, clusters are sorted by row and then column
+	int row;
+	int column;
+} StationCluster;
+
+// Grid pyramid of station clusters, built once whenever the station list is refreshed.
+// At small chart scales the overlay draws a single marker per cluster instead of every station,
+// the level is chosen so the cells are at least a marker apart, which bounds the number of
+// markers drawn to the number of cells that fit on the screen.
+class NOAA_ClusterPyramid {
+
+public:
+	NOAA_ClusterPyramid();
+
+	// Level 0 is built from the stations, each coarser level from the level below
+	void Build(const NOAA_StationColumns& buoys);
+	void Clear(void);
+
+	static double CellSize(int level);
+
+	// The finest level whose cells are at least minimumPixels wide, given the pixels per degree of
+	// longitude. Returns -1 if even the finest cells are that wide, the stations are then drawn individually
+	static int SelectLevel(double pixelsPerDegree, double minimumPixels);
+
+	// Replace the contents of results with the indices of the clusters at a level inside the bounding box.
+	// Longitudes are handled as in NOAA_SpatialIndex, including boxes crossing the antimeridian
+	void Query(int level, double latMin, double latMax, double lonMin, double lonMax, std::vector<unsigned int> *results) const;
+
+	const StationCluster& Cluster(int level, unsigned int index) const { return levels[level][index]; }
+	size_t Size(int level) const { return levels[level].size(); }
+
+private:
+	void QueryRange(int level, double latMin, double latMax, double lonMin, double lonMax, std::vector<unsigned int> *results) const;
+
+	// Merge the clusters sharing a cell. The clusters must be sorted by cell
+	static void Merge(std::vector<StationCluster>& clusters, std::vector<StationCluster> *merged);
+
+	std::vector<StationCluster> levels[CLUSTER_LEVELS];
+};
+
+#endif
@@ -0,0 +1,120 @@
+// Copyright(C) 2025 by Steven Adler
+//
+// This file is part of NOAA Weather plugin for OpenCPN.
+//
+// NOAA Weather plugin for OpenCPN is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// NOAA Weather plugin for OpenCPN is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with the NOAA Weather plugin for OpenCPN. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef NOAA_WEATHER_COLUMNS_H
+#define NOAA_WEATHER_COLUMNS_H
+
+// NDBC Station data
+#include "noaa_weather_parser.h"
+
+// STL
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+#include <cstddef>
+
+// Bits of the presence mask, set when the station reported the value (ie. it was not "MM")
+typedef enum _observationfield {
+	OBSERVATION_WIND_DIRECTION = 0x01,
+	OBSERVATION_WIND_SPEED = 0x02,
+	OBSERVATION_PRESSURE = 0x04,
+	OBSERVATION_AIR_TEMPERATURE = 0x08
+} OBSERVATION_FIELD;
+
+// Structure of arrays store for the station list.
+// Each value is held in its own contiguous column, so the filtering, rendering and hit testing loops
+// only touch the coordinates. Ids and names are interned in a single string arena and referenced by
+// index, so the scheduled reports (where the name is the id) hold each string once.
+// BuoyData remains the record type used by the parsers and for display of a single station.
+class NOAA_StationColumns {
+
+public:
+	NOAA_StationColumns();
+
+	void Clear(void);
+	void Reserve(size_t count);
+
+	size_t Size(void) const { return latitudes.size(); }
+	bool Empty(void) const { return latitudes.empty(); }
+
+	// Append a station, returns its index
+	unsigned int Add(const BuoyData& buoy);
+
+	// Reassemble the full record, for display
+	BuoyData Get(unsigned int index) const;
+
+	// Release the interning table once the store is complete, Add may still be called afterwards
+	// but strings are then no longer shared with earlier stations
+	void Compact(void);
+
+	// Append the columns, the string references and the arena to result, each as one block in the host's
+	// byte order. Used by the snapshot so it can be loaded a column at a time rather than a station at a time
+	void Write(std::string *result) const;
+
+	// Replace the store with count stations read from blocks written by Write.
+	// Returns false, leaving the store empty, if the blocks are truncated or inconsistent
+	bool Read(const char *data, size_t size, uint32_t count);
+
+	float Latitude(unsigned int index) const { return latitudes[index]; }
+	float Longitude(unsigned int index) const { return longitudes[index]; }
+	const float *Latitudes(void) const { return latitudes.data(); }
+	const float *Longitudes(void) const { return longitudes.data(); }
+
+	std::string Id(unsigned int index) const { return String(ids[index]); }
+	std::string Name(unsigned int index) const { return String(names[index]); }
+
+	bool IsReported(unsigned int index, OBSERVATION_FIELD field) const { return (present[index] & field) != 0; }
+
+	// Observation values, only meaningful if reported
+	int WindDirection(unsigned int index) const { return windDirections[index]; }
+	float WindSpeed(unsigned int index) const { return windSpeeds[index]; }
+
+private:
+	typedef struct _stringref {
+		uint32_t offset;
+		uint32_t length;
+	} StringRef;
+
+	uint32_t Intern(const std::string& value);
+	std::string String(uint32_t string) const;
+
+	// Coordinates, the hot columns
+	std::vector<float> latitudes;
+	std::vector<float> longitudes;
+
+	// Observations, only valid where the presence mask bit is set
+	std::vector<uint8_t> present;
+	std::vector<int16_t> windDirections;
+	std::vector<float> windSpeeds;
+	std::vector<float> pressures;
+	std::vector<float> airTemperatures;
+
+	// Indices into stringOffsets
+	std::vector<uint32_t> ids;
+	std::vector<uint32_t> names;
+
+	// String arena, strings are stored without terminators
+	std::string arena;
+	std::vector<StringRef> stringOffsets;
+
+	// Only needed while the store is being built
+	std::unordered_map<std::string, uint32_t> interned;
+};
+
+#endif
@@ -37,14 +37,31 @@
 #include "wx/jsonwriter.h"
 #include <wx/stdpaths.h>
 
+// Forecast time series
+#include "noaa_weather_forecast.h"
+#include "noaa_weather_table.h"
+
+// Layers not shown initially are extracted from the response when they are selected
+#include "noaa_weather_extractor.h"
+
+// STL
+#include <string>
+#include <vector>
+
 // image for dialog icon
 extern wxBitmap pluginBitmap;
 
 class NOAA_Plugin_Dialog : public NOAA_Plugin_DialogBase {
 	
 public:
-	NOAA_Plugin_Dialog(wxWindow* parent, const wxString jasonResponse);
+	// available lists every numeric layer in the response, those not already in the forecast
+	// are extracted from the response if the user chooses to show them
+	NOAA_Plugin_Dialog(wxWindow* parent, const NOAA_Forecast& forecastData,
+		const std::vector<std::string>& availableLayers, const std::vector<char>& forecastResponse);
 	~NOAA_Plugin_Dialog();
+
+	// The layers shown when the dialog is opened, the user can then add any other layer
+	static std::vector<std::string> GetLayerNames(void);
 		
 protected:
 	//overridden methods from the base class
@@ -52,6 +69,17 @@ protected:
 	void OnClose(wxCommandEvent &event);
 	
 private:
+	void OnLabelRightClick(wxGridEvent& event);
+
+	// Extract a layer from the response and add it to the forecast, returns its index or -1
+	int ExtractLayer(const std::string& name);
+
+	// The dialog keeps its own copy of the forecast, the table (owned by the grid) reads from it
+	NOAA_Forecast forecast;
+	NOAA_ForecastTable *table;
+
+	std::vector<std::string> available;
+	std::vector<char> response;
 	
 };
 
@@ -0,0 +1,207 @@
+// Copyright(C) 2025 by Steven Adler
+//
+// This file is part of NOAA Weather plugin for OpenCPN.
+//
+// NOAA Weather plugin for OpenCPN is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// NOAA Weather plugin for OpenCPN is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with the NOAA Weather plugin for OpenCPN. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef NOAA_WEATHER_DOWNLOAD_H
+#define NOAA_WEATHER_DOWNLOAD_H
+
+// Pre compiled headers
+#include "wx/wxprec.h"
+
+#ifndef WX_PRECOMP
+#include <wx/wx.h>
+#endif
+
+// OpenCPN include file
+#include "ocpn_plugin.h"
+
+// wxWidgets include files
+#include <wx/timer.h>
+#include <wx/filename.h>
+#include <wx/file.h>
+#include <wx/uri.h>
+#include <wx/datetime.h>
+
+// Cached responses
+#include "noaa_weather_cache.h"
+
+// NOAA_DelayedCall
+#include "noaa_weather_scheduler.h"
+
+// Download timings and cache hit rates
+#include "noaa_weather_statistics.h"
+
+// Responses kept in memory are received directly into a buffer using wxWebRequest where available,
+// otherwise they go through a temporary file downloaded by OpenCPN
+#if wxCHECK_VERSION(3, 1, 5) && wxUSE_WEBREQUEST
+#define NOAA_USE_WEBREQUEST
+#include <wx/webrequest.h>
+#endif
+
+// STL
+#include <functional>
+#include <map>
+#include <utility>
+#include <vector>
+
+// Downloads are serviced in priority order, then in the order they were queued
+typedef enum _downloadpriority {
+	PRIORITY_USER = 0,			// User initiated, eg. a context menu action
+	PRIORITY_BACKGROUND = 1		// Background refresh of the station data
+} DOWNLOAD_PRIORITY;
+
+typedef enum _downloadstatus {
+	DOWNLOAD_COMPLETE = 0,
+	DOWNLOAD_FAILED = 1,
+	DOWNLOAD_CANCELLED = 2
+} DOWNLOAD_STATUS;
+
+// Passed to the completion callback
+typedef struct _downloadresult {
+	long id;
+	wxString url;
+	DOWNLOAD_STATUS status;
+	// OpenCPN download status, valid when the download failed
+	int errorCode;
+	// HTTP status of the response, 0 when it isn't known (OpenCPN's downloader doesn't report it)
+	int httpStatus;
+	// When downloading to a file, the file name, otherwise the raw bytes of the response.
+	// The response is not converted to a wxString, parsers work directly on the bytes
+	wxString fileName;
+	std::vector<char> response;
+} NOAA_DownloadResult;
+
+typedef std::function<void(const NOAA_DownloadResult&)> NOAA_DownloadCallback;
+
+// Queues downloads and runs them in the background using OpenCPN's asynchronous downloader,
+// so neither the plugin's initialization nor the context menu actions block the user interface.
+// Completion callbacks are always posted to, and invoked from, the main event loop.
+class NOAA_DownloadManager : public wxEvtHandler {
+
+public:
+	NOAA_DownloadManager();
+	~NOAA_DownloadManager();
+
+	// Queue a download whose response is returned in the result
+	long Enqueue(const wxString& url, DOWNLOAD_PRIORITY priority, NOAA_DownloadCallback callback);
+
+	// Queue a download that is saved to the specified file
+	long Enqueue(const wxString& url, const wxString& fileName, DOWNLOAD_PRIORITY priority, NOAA_DownloadCallback callback);
+
+	// As above, but served from the response cache when possible. Fresh responses are returned without
+	// contacting the server, stale responses are returned immediately and then revalidated in the background.
+	// maxAge (seconds) is used when the server does not send a Cache-Control max-age. Responses more than
+	// maxStale seconds past their max age are not shown, the caller waits for the server instead
+	long EnqueueCached(const wxString& url, long long maxAge, long long maxStale, DOWNLOAD_PRIORITY priority, NOAA_DownloadCallback callback);
+
+	// The cache is owned by the caller and must outlive the download manager's use of it
+	void SetCache(NOAA_ResponseCache *responseCache) { cache = responseCache; }
+
+	// As with the cache, owned by the caller. NULL disables the instrumentation
+	void SetStatistics(NOAA_Statistics *downloadStatistics) { statistics = downloadStatistics; }
+
+	// Cancel a queued or active download, its callback receives DOWNLOAD_CANCELLED
+	bool Cancel(long id);
+
+	// Cancel everything, callbacks are not invoked. Used when the plugin is shutting down
+	void CancelAll(void);
+
+	bool IsBusy(void) const;
+
+private:
+	typedef struct _downloadjob {
+		long id;
+		wxString url;
+		wxString fileName;
+		// Downloads without a file name are kept in memory. Without wxWebRequest this
+		// uses a temporary file which is read and removed on completion
+		bool temporary;
+		NOAA_DownloadCallback callback;
+		// Cached responses, with the validators of a stale copy being revalidated
+		bool cacheable;
+		long long maxAge;
+		wxString eTag;
+		wxString lastModified;
+	} DownloadJob;
+
+	long Queue(DownloadJob& job, DOWNLOAD_PRIORITY priority);
+
+	// Whether a download of the url is already queued or active
+	bool IsPending(const wxString& url) const;
+
+	// Start the active download, returns false if it could not be started
+	bool StartFile(void);
+#ifdef NOAA_USE_WEBREQUEST
+	bool StartRequest(void);
+#endif
+
+	// Abort the active transfer, its completion is then drained
+	void Abort(void);
+
+	// Start the highest priority queued download if nothing is active
+	void StartNext(void);
+
+	// Finish the active download and post its result to the main event loop
+	void Complete(DOWNLOAD_STATUS status, int errorCode);
+
+	void Post(const DownloadJob& job, DOWNLOAD_STATUS status, int errorCode);
+
+	void OnDownloadEvent(OCPN_downloadEvent& event);
+	void OnTimer(wxTimerEvent& event);
+#ifdef NOAA_USE_WEBREQUEST
+	void OnRequestState(wxWebRequestEvent& event);
+	void OnRequestData(wxWebRequestEvent& event);
+#endif
+
+	// Pending downloads keyed by priority and sequence number
+	std::map<std::pair<int, long>, DownloadJob> queue;
+	long sequence;
+
+	// OpenCPN's background downloader reports progress through a single event handler,
+	// so only one download is active at a time
+	bool active;
+	DownloadJob activeJob;
+	long activeHandle;
+#ifdef NOAA_USE_WEBREQUEST
+	// In memory downloads, received straight into activeResponse
+	wxWebRequest activeRequest;
+	std::vector<char> activeResponse;
+#endif
+
+	// A cancelled transfer is drained (its end event ignored) before the next one starts
+	bool cancelling;
+
+	// HTTP status and caching details from the active transfer's response
+	int activeHttpStatus;
+	bool activeNotModified;
+	long long activeMaxAge;
+	wxString activeETag;
+	wxString activeLastModified;
+
+	NOAA_ResponseCache *cache;
+	// Writes the cache index once downloads have gone quiet
+	NOAA_DelayedCall cacheFlush;
+
+	NOAA_Statistics *statistics;
+	// When the active transfer was started, in microseconds
+	uint64_t activeStarted;
+
+	// Watchdog for stalled transfers and for cancellations that never report back
+	wxTimer watchdog;
+};
+
+#endif
@@ -0,0 +1,42 @@
+// Copyright(C) 2025 by Steven Adler
+//
+// This file is part of NOAA Weather plugin for OpenCPN.
+//
+// NOAA Weather plugin for OpenCPN is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// NOAA Weather plugin for OpenCPN is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with the NOAA Weather plugin for OpenCPN. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef NOAA_WEATHER_EXTRACTOR_H
+#define NOAA_WEATHER_EXTRACTOR_H
+
+// Forecast time series
+#include "noaa_weather_forecast.h"
+
+// STL
+#include <string>
+#include <vector>
+#include <cstddef>
+
+// Single pass extraction of layers from a NWS gridpoint (forecastGridData) response.
+// Rather than building a DOM of the whole document, the JSON is scanned once and only the
+// "values" arrays of the requested layers are decoded, everything else is skipped over in place
+// (member names are compared against the document, so skipping allocates nothing).
+// The layers are added to the forecast in the order requested, whether or not they are present.
+// If no layers are requested, every layer with a "values" array is extracted.
+// If available is not NULL it receives, in document order, the names of the requested layers found and of
+// every other numeric layer, which can then be extracted on demand.
+// Returns false, with a description of the error, if the response is not valid JSON.
+bool ExtractForecastLayers(const char *data, size_t length, const std::vector<std::string>& layers,
+	NOAA_Forecast *forecast, std::string *error, std::vector<std::string> *available = NULL);
+
+#endif
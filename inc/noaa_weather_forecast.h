@@ -0,0 +1,102 @@
+// Copyright(C) 2025 by Steven Adler
+//
+// This file is part of NOAA Weather plugin for OpenCPN.
+//
+// NOAA Weather plugin for OpenCPN is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// NOAA Weather plugin for OpenCPN is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with the NOAA Weather plugin for OpenCPN. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef NOAA_WEATHER_FORECAST_H
+#define NOAA_WEATHER_FORECAST_H
+
+// Time series model of a NWS gridpoint forecast (forecastGridData).
+// Like the NDBC parsers, free of wxWidgets so it can be benchmarked without OpenCPN.
+
+// STL
+#include <string>
+#include <vector>
+#include <cstddef>
+
+// Forecasts are presented on an hourly axis
+#define FORECAST_STEP 3600
+
+// Guard against malformed intervals, gridpoint forecasts cover about seven days
+#define FORECAST_MAX_HOURS (16 * 24)
+
+// A value and the interval it applies to, times are seconds since the epoch (UTC)
+typedef struct _forecastvalue {
+	long long start;
+	long long duration;
+	double value;
+} ForecastValue;
+
+// Parse an ISO-8601 date time such as "2021-12-05T17:00:00+00:00" to seconds since the epoch
+bool ParseIsoDateTime(const char *text, size_t length, long long *seconds);
+
+// Parse an ISO-8601 duration such as "PT1H" or "P1DT6H" to seconds
+bool ParseIsoDuration(const char *text, size_t length, long long *seconds);
+
+// Parse a validTime interval, "2021-12-05T17:00:00+00:00/PT3H"
+bool ParseValidTime(const char *text, size_t length, long long *start, long long *duration);
+
+// Each layer (temperature, windSpeed etc.) has its own list of intervals. The layers are
+// joined onto a common hourly axis, with multi-hour intervals repeated for each hour they cover
+class NOAA_Forecast {
+
+public:
+	NOAA_Forecast();
+
+	void Clear(void);
+
+	// Add a layer, returns its index. Build must be called once all the layers have been added
+	size_t AddLayer(const std::string& name, const std::vector<ForecastValue>& values);
+
+	// Copy another forecast's layer, Build must then be called
+	size_t AddLayer(const NOAA_Forecast& source, size_t layer);
+
+	// Append a value to a layer
+	void AddValue(size_t layer, const ForecastValue& value);
+
+	// Unit of measure, as given by NWS eg. "wmoUnit:degC"
+	void SetLayerUnit(size_t layer, const std::string& unit) { layers[layer].unit = unit; }
+	const std::string& LayerUnit(size_t layer) const { return layers[layer].unit; }
+
+	// Lay out every layer on the hourly axis, in a single pass over each layer's values
+	void Build(void);
+
+	size_t Hours(void) const { return hours; }
+	long long Time(size_t hour) const { return origin + ((long long)hour * FORECAST_STEP); }
+
+	size_t Layers(void) const { return layers.size(); }
+	const std::string& LayerName(size_t layer) const { return layers[layer].name; }
+
+	// Returns -1 if there is no such layer
+	int FindLayer(const std::string& name) const;
+
+	// NaN if the layer has no value for the hour
+	double Value(size_t layer, size_t hour) const { return layers[layer].hourly[hour]; }
+
+private:
+	typedef struct _forecastlayer {
+		std::string name;
+		std::string unit;
+		std::vector<ForecastValue> values;
+		std::vector<double> hourly;
+	} ForecastLayer;
+
+	std::vector<ForecastLayer> layers;
+	long long origin;
+	size_t hours;
+};
+
+#endif
@@ -0,0 +1,126 @@
+// Copyright(C) 2025 by Steven Adler
+//
+// This file is part of NOAA Weather plugin for OpenCPN.
+//
+// NOAA Weather plugin for OpenCPN is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// NOAA Weather plugin for OpenCPN is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with the NOAA Weather plugin for OpenCPN. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef NOAA_WEATHER_HISTORY_H
+#define NOAA_WEATHER_HISTORY_H
+
+// Realtime observation history of the National Data Buoy Center (NDBC) stations.
+// Like the parsers, free of wxWidgets and OpenCPN.
+
+// STL
+#include <string>
+#include <vector>
+#include <map>
+#include <cstdint>
+#include <cstddef>
+
+// A realtime2 file holds 45 days of observations, every 10 minutes at most
+#define HISTORY_CAPACITY (45 * 24 * 6)
+
+// Number of stations whose history is kept
+#define HISTORY_STATIONS 16
+
+// The value columns of a realtime2 standard meteorological file, following the five date and time columns
+// #YY  MM DD hh mm WDIR WSPD GST  WVHT   DPD   APD MWD   PRES  ATMP  WTMP  DEWP  VIS PTDY  TIDE
+typedef enum _realtimecolumn {
+	REALTIME_WIND_DIRECTION = 0,	// degT
+	REALTIME_WIND_SPEED,			// m/s
+	REALTIME_GUST,					// m/s
+	REALTIME_WAVE_HEIGHT,			// m
+	REALTIME_DOMINANT_PERIOD,		// sec
+	REALTIME_AVERAGE_PERIOD,		// sec
+	REALTIME_WAVE_DIRECTION,		// degT
+	REALTIME_PRESSURE,				// hPa
+	REALTIME_AIR_TEMPERATURE,		// degC
+	REALTIME_WATER_TEMPERATURE,		// degC
+	REALTIME_DEW_POINT,				// degC
+	REALTIME_VISIBILITY,			// nmi
+	REALTIME_PRESSURE_TENDENCY,		// hPa
+	REALTIME_TIDE,					// ft
+	REALTIME_COLUMNS
+} REALTIME_COLUMN;
+
+// Seconds since the epoch of a UTC date and time, independent of the local time zone
+int64_t UtcSeconds(int year, int month, int day, int hour, int minute);
+
+// Columnar ring buffer of a station's realtime observations, oldest first.
+// A realtime2 file lists the newest observation first, so an update only parses the lines
+// newer than the latest stored observation and stops at the first one it already has.
+class NOAA_StationHistory {
+
+public:
+	NOAA_StationHistory(size_t capacity = HISTORY_CAPACITY);
+
+	// Append the observations in the contents of a realtime2 file that are newer than the latest stored.
+	// When the buffer is full the oldest observations are overwritten. Returns the number appended
+	size_t Update(const char *data, size_t length);
+
+	void Clear(void);
+	size_t Size(void) const { return count; }
+	bool Empty(void) const { return count == 0; }
+
+	// Observations are indexed from 0, the oldest, to Size() - 1, the latest.
+	// Missing values are NaN
+	int64_t Time(size_t index) const { return times[Slot(index)]; }
+	float Value(size_t index, REALTIME_COLUMN column) const { return values[column][Slot(index)]; }
+
+	// Time of the latest observation, 0 if there are none
+	int64_t LatestTime(void) const { return (count > 0) ? Time(count - 1) : 0; }
+
+	// The latest reported value of a column and its change over the preceding period (seconds),
+	// eg. the three hour pressure tendency. Returns false if there aren't two reported values that far apart
+	bool Change(REALTIME_COLUMN column, int64_t period, float *latest, float *change) const;
+
+private:
+	size_t Slot(size_t index) const { return (first + index) % capacity; }
+	void Append(int64_t time, const float *record);
+
+	size_t capacity;
+	size_t first;
+	size_t count;
+	std::vector<int64_t> times;
+	std::vector<float> values[REALTIME_COLUMNS];
+};
+
+// The histories of the most recently viewed stations
+class NOAA_HistoryStore {
+
+public:
+	NOAA_HistoryStore(size_t stations = HISTORY_STATIONS);
+
+	// The station's history, created if necessary. The least recently used history is discarded
+	// if there are too many. The reference is valid until the next Get
+	NOAA_StationHistory& Get(const std::string& id);
+
+	// As above, but NULL if the station's history isn't held
+	NOAA_StationHistory *Find(const std::string& id);
+
+	size_t Size(void) const { return histories.size(); }
+
+private:
+	typedef struct _entry {
+		NOAA_StationHistory history;
+		unsigned long long used;
+	} Entry;
+
+	size_t maxStations;
+	unsigned long long sequence;
+	std::map<std::string, Entry> histories;
+};
+
+#endif
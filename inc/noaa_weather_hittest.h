@@ -0,0 +1,72 @@
+// Copyright(C) 2025 by Steven Adler
+//
+// This file is part of NOAA Weather plugin for OpenCPN.
+//
+// NOAA Weather plugin for OpenCPN is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// NOAA Weather plugin for OpenCPN is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with the NOAA Weather plugin for OpenCPN. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef NOAA_WEATHER_HITTEST_H
+#define NOAA_WEATHER_HITTEST_H
+
+// STL
+#include <vector>
+#include <cstddef>
+
+// Screen space bucket grid of the icons drawn in the last frame.
+// Rebuilt by the render callbacks as each icon is drawn, so a cursor lookup only
+// has to examine the handful of icons sharing the cursor's bucket.
+// Each frame sets the bucket size to the largest footprint drawn, icons scale with the chart and the
+// display and barbs are larger still, so each entry occupies at most four buckets whatever their size.
+class NOAA_HitTest {
+
+public:
+	NOAA_HitTest(int bucketSize = 32);
+
+	// Start a new frame for a canvas of the given pixel dimensions. largest is the widest or tallest
+	// footprint that will be added, zero keeps the current bucket size
+	void Reset(int width, int height, int largest = 0);
+
+	// Record an icon whose top left corner is drawn at x,y
+	void Add(unsigned int index, int x, int y, int width, int height);
+
+	// Find the icon whose footprint contains the point. When icons overlap the
+	// icon whose centre is nearest the point is returned
+	bool Find(int x, int y, unsigned int *index) const;
+
+	size_t Size(void) const { return icons.size(); }
+
+private:
+	typedef struct _icon {
+		unsigned int index;
+		int left;
+		int top;
+		int right;
+		int bottom;
+	} Icon;
+
+	// Singly linked list of the icons in each bucket, stored in a flat array
+	typedef struct _node {
+		unsigned int icon;
+		int next;
+	} Node;
+
+	int bucketSize;
+	int columns;
+	int rows;
+	std::vector<int> buckets;
+	std::vector<Node> nodes;
+	std::vector<Icon> icons;
+};
+
+#endif
@@ -0,0 +1,82 @@
+// Copyright(C) 2025 by Steven Adler
+//
+// This file is part of NOAA Weather plugin for OpenCPN.
+//
+// NOAA Weather plugin for OpenCPN is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// NOAA Weather plugin for OpenCPN is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with the NOAA Weather plugin for OpenCPN. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef NOAA_WEATHER_ICONS_H
+#define NOAA_WEATHER_ICONS_H
+
+// Pre compiled headers
+#include "wx/wxprec.h"
+
+#ifndef WX_PRECOMP
+#include <wx/wx.h>
+#endif
+
+// OpenCPN Plugin header, GetBitmapFromSVGFile
+#include "ocpn_plugin.h"
+
+// The rasters are also added to the OpenGL texture atlas
+#include "noaa_weather_renderer.h"
+
+// STL
+#include <vector>
+
+// Number of rasters kept, enough for every icon at the sizes of a few neighbouring chart scales
+#define ICON_CACHE_CAPACITY 8
+
+// An icon rasterized at one size
+typedef struct _iconraster {
+	int icon;
+	int size;
+	wxBitmap bitmap;
+	// The raster's symbol in the texture atlas
+	int symbol;
+	// Sequence number of the last Get, for LRU eviction
+	unsigned long long used;
+} IconRaster;
+
+// Rasters of SVG icons at a small set of quantized sizes.
+// Icons are rasterized the first time a size is needed and kept in an LRU, so zooming
+// between chart scales reuses the existing rasters rather than re-rendering the SVG
+class NOAA_IconCache {
+
+public:
+	NOAA_IconCache(NOAA_GLRenderer *renderer);
+
+	// Register an SVG file, returns the icon's id. Nothing is rasterized yet
+	int AddIcon(const wxString& svgFile);
+
+	// The icon at the given size, rasterizing it if it isn't cached. The reference is valid until the next Get
+	const IconRaster& Get(int icon, int size);
+
+	// Icon size in pixels for a chart scale (1:chartScale) and display content scale factor,
+	// rounded up to one of the quantized sizes
+	static int SelectSize(double chartScale, double scaleFactor);
+
+	size_t Size(void) const { return rasters.size(); }
+
+private:
+	NOAA_GLRenderer *renderer;
+	std::vector<wxString> svgFiles;
+	std::vector<IconRaster> rasters;
+	unsigned long long sequence;
+
+	// Atlas symbols of evicted rasters, reused by the next raster of the same size so the atlas doesn't grow
+	std::vector<IconRaster> released;
+};
+
+#endif
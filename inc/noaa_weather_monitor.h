@@ -0,0 +1,89 @@
+// Copyright(C) 2025 by Steven Adler
+//
+// This file is part of NOAA Weather plugin for OpenCPN.
+//
+// NOAA Weather plugin for OpenCPN is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// NOAA Weather plugin for OpenCPN is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with the NOAA Weather plugin for OpenCPN. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef NOAA_WEATHER_MONITOR_H
+#define NOAA_WEATHER_MONITOR_H
+
+// STL
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+
+// Distance (km) the vessel must move from where the forecast was last fetched before it is fetched
+// again, about the size of a NWS forecast grid cell. GPS jitter is far smaller
+#define MONITOR_CELL_DISTANCE 2.5
+
+// Consecutive fixes a change must be seen for before it is acted on
+#define MONITOR_CONFIRMATIONS 5
+
+// Seconds before the forecast is fetched again even if the vessel hasn't moved, the forecast cache age
+#define MONITOR_FORECAST_AGE 3600
+
+// What changed as a result of a position fix
+typedef struct _monitorupdate {
+	// The vessel has moved into another forecast cell, or the forecast has expired
+	bool forecast;
+	// Alerts that now apply to the vessel, and those that no longer do
+	std::vector<std::string> raised;
+	std::vector<std::string> cleared;
+} MonitorUpdate;
+
+// Tracks the forecast cell and the alerts the vessel is in as position fixes arrive.
+// Changes are only reported once they have been seen for several consecutive fixes, and the forecast
+// cell only changes once the vessel is a cell's width from where it was established. A vessel sitting
+// on a boundary, with its position jittering back and forth across it, therefore doesn't cause a
+// request or a notification at every fix
+class NOAA_PositionMonitor {
+
+public:
+	NOAA_PositionMonitor(double cellDistance = MONITOR_CELL_DISTANCE, int confirmations = MONITOR_CONFIRMATIONS,
+		long long forecastAge = MONITOR_FORECAST_AGE);
+
+	// A position fix at time now (seconds) with the ids of the alerts whose area contains it
+	void Update(double latitude, double longitude, const std::vector<std::string>& alerts, long long now, MonitorUpdate *update);
+
+	void Reset(void);
+
+	// The alerts currently applying to the vessel
+	const std::set<std::string>& Active(void) const { return active; }
+
+	// Approximate distance in km, sufficient over the few kilometres of a forecast cell
+	static double Distance(double latitude0, double longitude0, double latitude1, double longitude1);
+
+private:
+	double cellDistance;
+	int confirmations;
+	long long forecastAge;
+
+	// Where and when the forecast was last fetched
+	bool anchored;
+	double anchorLatitude;
+	double anchorLongitude;
+	long long forecastTime;
+
+	// Consecutive fixes beyond the cell distance
+	int moved;
+
+	// Alerts applying to the vessel, with the consecutive fixes a change to them has been seen for
+	std::set<std::string> active;
+	std::map<std::string, int> entering;
+	std::map<std::string, int> leaving;
+};
+
+#endif
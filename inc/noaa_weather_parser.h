@@ -0,0 +1,93 @@
+// Copyright(C) 2025 by Steven Adler
+//
+// This file is part of NOAA Weather plugin for OpenCPN.
+//
+// NOAA Weather plugin for OpenCPN is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// NOAA Weather plugin for OpenCPN is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with the NOAA Weather plugin for OpenCPN. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef NOAA_WEATHER_PARSER_H
+#define NOAA_WEATHER_PARSER_H
+
+// Parsers for the National Data Buoy Center (NDBC) text products.
+// Deliberately free of wxWidgets and OpenCPN so they can be used from worker threads
+// and benchmarked without the OpenCPN host.
+
+// STL
+#include <string>
+#include <vector>
+#include <cstddef>
+
+// NDBC reports missing values as "MM". Missing doubles are stored as NaN,
+// a missing wind direction is stored as NDBC_MISSING_DIRECTION
+#define NDBC_MISSING_DIRECTION -1
+
+// NDBC Station data
+typedef struct _buoydata {
+	std::string id;
+	std::string name;
+	double latitude;
+	double longitude;
+	double windSpeed;
+	int windDirection;
+	double barometricPressure;
+	double airTemperature;
+} BuoyData;
+
+// Returns true if an observation value was reported, ie. was not "MM"
+bool IsReported(double value);
+bool IsReported(int direction);
+
+// Mark all of the observation values as missing
+void ClearObservation(BuoyData *buoy);
+
+// Single pass tokenizer over the whitespace aligned columns used by NDBC text files.
+// Columns are returned as pointers into the original buffer, nothing is copied.
+class NDBC_Tokenizer {
+
+public:
+	NDBC_Tokenizer(const char *data, size_t length);
+
+	// Advance to the next line, returns false at the end of the data
+	bool NextLine(void);
+
+	// Returns the next column on the current line, returns false at the end of the line
+	bool NextColumn(const char **column, size_t *length);
+
+	// Header lines start with '#'
+	bool IsHeader(void) const;
+
+private:
+	const char *position;
+	const char *lineStart;
+	const char *lineEnd;
+	const char *end;
+};
+
+// Structure of arrays store the list parsers append to
+class NOAA_StationColumns;
+
+// Convert a column to a number. Returns false for "MM" (missing) or malformed values.
+// Unlike strtod these are not affected by the locale's decimal separator.
+bool ParseColumn(const char *column, size_t length, double *value);
+bool ParseColumn(const char *column, size_t length, int *value);
+
+// Parse the contents of latest_obs.txt, appending exactly one record per station line.
+// Returns the number of stations appended
+size_t ParseScheduledReports(const char *data, size_t length, NOAA_StationColumns *buoys);
+
+// Parse the contents of station_table.txt, appending the stations that have a position.
+// Returns the number of stations appended
+size_t ParseStationList(const char *data, size_t length, NOAA_StationColumns *buoys);
+
+#endif
@@ -53,9 +53,66 @@
 // OpenCPN Device Context Abstraction Layer
 #include "noaa_weather_graphics.h"
 
+// Batched OpenGL rendering of the station icons
+#include "noaa_weather_renderer.h"
+
+// Station icons rasterized at quantized sizes
+#include "noaa_weather_icons.h"
+
 // Dialog to display weather forecast data
 #include "noaa_weather_dialog.h"
 
+// Background downloads
+#include "noaa_weather_download.h"
+
+// NDBC text file parsers
+#include "noaa_weather_parser.h"
+
+// Spatial index of the NDBC stations
+#include "noaa_weather_spatial.h"
+
+// Screen space hit testing of the station icons
+#include "noaa_weather_hittest.h"
+
+// Forecast layers from the gridpoint response
+#include "noaa_weather_extractor.h"
+
+// Forecast grid urls for positions
+#include "noaa_weather_points.h"
+
+// Binary snapshot of the last station data, for an immediate (and offline) cold start
+#include "noaa_weather_snapshot.h"
+
+// Station data, refreshed on a worker thread
+#include "noaa_weather_stations.h"
+
+// History of the realtime observations
+#include "noaa_weather_history.h"
+
+// Areas of the active alerts
+#include "noaa_weather_alerts.h"
+
+// Forecast cell and alert tracking as the vessel moves
+#include "noaa_weather_monitor.h"
+
+// Alert notifications
+#include <wx/notifmsg.h>
+
+// Fetching the realtime observations of the visible stations ahead of time
+#include "noaa_weather_prefetch.h"
+
+// Forecast along the active route
+#include "noaa_weather_route.h"
+
+// Wind barbs of the reported observations
+#include "noaa_weather_barbs.h"
+
+// Periodic refresh of the station data
+#include "noaa_weather_scheduler.h"
+
+// Latency and counter instrumentation
+#include "noaa_weather_statistics.h"
+
 // wxWidgets include files
 
 // Configuration
@@ -63,32 +120,77 @@
 
 // Strings
 #include <wx/string.h>
-#include <wx/tokenzr.h>
 #include <wx/regex.h>
 
 // File handling
 #include <wx/stdpaths.h>
 #include <wx/filename.h>
+#include <wx/file.h>
+
+// Snapshot timestamps
+#include <wx/datetime.h>
 
 // Web Access
 #include <wx/uri.h>
+#include <wx/mstream.h>
+
+// Drawing the cluster markers
+#include <wx/graphics.h>
+
+// Default locations of the National Data Buoy Center and National Weather Service servers
+#define NDBC_SERVER "https://www.ndbc.noaa.gov"
+#define NWS_SERVER "https://api.weather.gov"
+
+// How long (seconds) cached NWS responses are fresh, unless the server specifies otherwise
+#define CACHE_AGE_FORECAST 3600
+#define CACHE_AGE_ALERTS 60
+// Forecast zone boundaries rarely change
+#define CACHE_AGE_ZONES (7 * 24 * 3600)
+
+// How long (seconds) past their max age cached responses are still shown while they are revalidated.
+// Older responses are not shown, the server's reply is awaited instead. Alerts have a hard limit,
+// an outdated alert must never be displayed as if it were current
+#define CACHE_STALE_FORECAST (2 * CACHE_AGE_FORECAST)
+#define CACHE_STALE_ALERTS (10 * 60)
+#define CACHE_STALE_ZONES (4 * CACHE_AGE_ZONES)
+
+// Minutes between downloads of the active marine alerts, whose areas are then checked locally at each position fix
+#define ALERT_REFRESH_INTERVAL 5
+
+// Maximum size of the response cache
+#define CACHE_SIZE (16 * 1024 * 1024)
+
+// The statistics are published with this message id every STATISTICS_INTERVAL minutes,
+// and immediately (and logged) when another plugin sends the request message
+#define STATISTICS_MESSAGE "NOAA_WEATHER_STATISTICS"
+#define STATISTICS_REQUEST "NOAA_WEATHER_STATISTICS_REQUEST"
+#define STATISTICS_INTERVAL 10
+
+// Zoomed out, stations closer than this (pixels) are drawn as a single cluster marker
+#define CLUSTER_MINIMUM_PIXELS 64
+#define CLUSTER_SYMBOL_SIZE 32
+
+// Knots used for the route forecast's ETAs when the vessel is stopped, or there is no fix
+#define ROUTE_DEFAULT_SPEED 5.0
+#define ROUTE_MINIMUM_SPEED 1.0
+
+// Seconds before a position without a forecast cell is looked up again, in case the NWS grids have grown
+#define ROUTE_UNCOVERED_AGE (7 * 24 * 60 * 60)
+
+// Colour and line width (pixels) of the wind barbs
+#define BARB_COLOUR wxColour(0, 52, 94)
+#define BARB_LINE_WIDTH 1.5f
 
 // STL
 #include <string>
 #include <vector>
 #include <regex>
-
-// NDBC Station data
-typedef struct _buoydata {
-	std::string id;
-	std::string name;
-	double latitude;
-	double longitude;
-	double windSpeed;
-	int windDirection;
-	double barometricPressure;
-	double airTemperature;
-} BuoyData;
+#include <algorithm>
+#include <map>
+#include <set>
+#include <cmath>
+#include <limits>
+#include <memory>
 
 // Used to determine what query to send (not used anywhere ?)
 typedef enum _nooa {
@@ -98,6 +200,31 @@ typedef enum _nooa {
 	REALTIME = 3	// Realtime observations
 } NOAA_REQUEST;
 
+// Cluster marker, rasterized once per label
+typedef struct _clustersymbol {
+	wxBitmap bitmap;
+	int symbol;
+} ClusterSymbol;
+
+// Each canvas of a split screen has its own view port, culled stations and hit test
+typedef struct _canvasstate {
+	// The view port the stations were last filtered for, pix_width is 0 until the canvas is first drawn
+	PlugIn_ViewPort viewPort;
+	// The station data visibleBuoys was filtered from, and its indices of the stations within the view port
+	NOAA_StationDataPtr visibleStations;
+	std::vector<unsigned int> visibleBuoys;
+	// Zoomed out, the clusters of two or more stations within the view port are drawn instead.
+	// visibleBuoys then only holds the stations that are alone in their cluster. -1 if not clustering
+	int clusterLevel;
+	std::vector<unsigned int> visibleClusters;
+	// Icon size for the view port's chart scale and the canvas' content scale factor
+	int buoySize;
+	// Icons drawn in the last frame, rebuilt by the render callbacks.
+	// The hit test indices refer to the station data that was drawn
+	NOAA_HitTest hitTest;
+	NOAA_StationDataPtr renderedStations;
+} CanvasState;
+
 // The NOAA Weather plugin
 class NOAA_Plugin : public opencpn_plugin_118 {
 
@@ -128,17 +255,19 @@ public:
 	void SetCursorLatLon(double lat, double lon);
 	void SetCurrentViewPort(PlugIn_ViewPort& vp);
 	bool MouseEventHook(wxMouseEvent& event);
+	void SetPluginMessage(wxString& message_id, wxString& message_body);
 	//int GetToolbarToolCount(void);
 	//int GetToolbarItemId(void);
 	//void OnToolbarToolCallback(int id);
 	
 private: 
 	
-	// The viewing area of the chart
-	PlugIn_ViewPort viewPort;
+	// OpenGL renderer, owns the texture atlas of the symbols
+	NOAA_GLRenderer glRenderer;
 
-	// Bitmap used to draw a weather buoy on the chart
-	wxBitmap buoyBitmap;
+	// Rasters of the weather buoy icon at the sizes used by recent chart scales
+	NOAA_IconCache iconCache;
+	int buoyIcon;
 
 	// Reference to the OpenCPN window handle
 	wxWindow *parentWindow;
@@ -149,6 +278,7 @@ private:
 	// OpenCPN Vessel Position - used to fetch area forecasts and warnings
 	double currentLatitude;
 	double currentLongitude;
+	double currentSpeed;
 
 	// Toolbar id
 	//int toolbarId;
@@ -157,24 +287,143 @@ private:
 	int noaaAlertMenu;
 	int noaaForecastMenu;
 	int noaaBuoyMenu;
-
-	wxString GetForecastUrl(const double &latitude, const double &longitude);
-	wxString ExecuteQuery(const wxString endpoint);
-	void ParsePosition(wxString location, double* latitude, double* longitude);
-	std::vector<BuoyData> FilterVisibleBuoys(const PlugIn_ViewPort& vp);
-	bool IsUnderCursor(double lat, double lon, wxString *id, wxString *name);
+	int noaaRouteMenu;
+	int noaaBarbMenu;
+
+	void RequestForecast(const double &latitude, const double &longitude, bool display = true);
+	void RequestAlerts(const double &latitude, const double &longitude);
+	void RefreshAlerts(void);
+	void OnAlertsDownloaded(const std::vector<char>& response);
+	void DownloadZone(const wxString& url);
+	void BuildAlertIndex(void);
+	void ShowAlerts(const std::vector<AlertData>& alerts);
+	void RequestGridData(const wxString& url, bool display);
+	void MonitorPosition(void);
+	void NotifyAlert(const std::string& alertId);
+	void LoadPointsCache(void);
+	void SavePointsCache(void);
+	bool CheckDownload(const NOAA_DownloadResult& result, bool notifyUser);
+	bool ParseJson(const std::vector<char>& jsonResponse, wxJSONValue *root);
+	CanvasState& GetCanvasState(int canvasIndex);
+	CanvasState& UpdateCanvas(int canvasIndex, const PlugIn_ViewPort& vp);
+	void FilterVisibleBuoys(CanvasState& canvas);
+	bool IsUnderCursor(CanvasState& canvas, const wxPoint& point, wxString *id, wxString *name);
+	const ClusterSymbol& GetClusterSymbol(unsigned int count);
 	void DownloadRealtimeObservation(wxString id, wxString name);
-	bool DownloadScheduledReports(void);
-	bool DownloadStationList(void);
-	bool DownloadFile(wxString url, wxString filename);
-
-	// NOAA NDBC Station List
-	std::vector<BuoyData> allBuoys;
-	std::vector<BuoyData> visibleBuoys;
-
-	// Station Id & Name
+	void ShowRealtimeObservation(const wxString& id, const std::vector<char>& data);
+	void ShowStationHistory(const wxString& id, const NOAA_StationHistory& history);
+	void PrefetchVisible(void);
+	void StartPrefetches(void);
+	bool GetActiveRouteWaypoints(std::vector<RouteWaypoint> *waypoints);
+	void RequestRouteForecast(void);
+	void LookupRouteCell(double latitude, double longitude, long generation);
+	void FetchRouteCells(long generation);
+	void ShowRouteForecast(void);
+	bool IsBarbDrawn(const NOAA_StationColumns& buoys, unsigned int index) const;
+	static double GetNorthAngle(PlugIn_ViewPort* vp);
+	void DrawBarbs(wxDC& dc);
+	void DownloadStations(DOWNLOAD_PRIORITY priority);
+	void RefreshStations(std::vector<char>& data);
+	void OnStationsPublished(void);
+	bool ReadDataFile(const wxString& fileName, std::vector<char> *buffer);
+	wxString GetSnapshotFileName(void);
+	wxString GetDataFolder(void);
+	bool LoadStationSnapshot(void);
+	wxString FormatObservation(const BuoyData& buoy);
+	wxJSONValue GetStatistics(void);
+	void PublishStatistics(bool log);
+
+	// Timings of each stage, declared first as the download manager and station store record into it
+	NOAA_Statistics statistics;
+
+	// Publishes the statistics at the configured interval (minutes, 0 disables)
+	NOAA_RefreshScheduler statisticsScheduler;
+	int statisticsInterval;
+
+	// Runs the downloads in the background
+	NOAA_DownloadManager downloadManager;
+
+	// Forecasts and alerts, kept on disk between sessions
+	NOAA_ResponseCache responseCache;
+
+	// Forecast grid urls of previously requested positions
+	NOAA_PointsCache pointsCache;
+
+	// Server base urls
+	wxString ndbcServer;
+	wxString nwsServer;
+
+	// Realtime observations of the recently viewed stations
+	NOAA_HistoryStore histories;
+
+	// Realtime observations of the visible stations are prefetched once the view port has settled,
+	// at most prefetchConcurrency at once and spaced apart to be polite to the NDBC server
+	NOAA_PrefetchQueue prefetchQueue;
+	NOAA_DelayedCall prefetchSettle;
+	NOAA_DelayedCall prefetchPacing;
+	bool prefetchEnabled;
+	int prefetchConcurrency;
+
+	// Forecast along the active route, with the cells downloaded for previous plans of the route.
+	// Each request has a generation, so the downloads of a superseded request are ignored
+	NOAA_RouteForecast routeForecast;
+	long routeGeneration;
+	int routePending;
+	// Sample positions (to the points cache resolution) outside the NWS forecast grids, and when (seconds since the epoch)
+	// the NWS said so. Failed lookups that aren't a definite answer (eg. no connection) are retried by the next request
+	std::map<std::string, long long> routeUncovered;
+	double routeSpeed;
+
+	// Active marine alerts as downloaded, with the forecast zones of those without a geometry of their own
+	std::vector<AlertData> activeAlerts;
+	std::vector<std::vector<std::string>> activeAlertZones;
+
+	// Zone boundaries keyed by zone url, the zones requested and the number of those downloads outstanding
+	std::map<std::string, std::vector<AlertPolygon>> zoneAreas;
+	std::set<std::string> zonesRequested;
+	int pendingZones;
+
+	// The areas of the active alerts, and the alerts applying at the vessel's position
+	NOAA_AlertIndex alertIndex;
+	bool alertsLoaded;
+	std::vector<unsigned int> positionAlerts;
+
+	// Downloads the active alerts at the configured interval (minutes, 0 disables)
+	NOAA_RefreshScheduler alertScheduler;
+	int alertInterval;
+
+	// Prefetches the forecast and raises notifications for the alerts as the vessel moves
+	NOAA_PositionMonitor positionMonitor;
+	bool monitorEnabled;
+
+	// NOAA NDBC Station List or Scheduled Reports, replaced as a whole by each refresh
+	NOAA_StationStore stationStore;
+
+	// Downloads the station data at the configured interval
+	NOAA_RefreshScheduler refreshScheduler;
+
+	// Minutes between refreshes (0 disables them) and past the hour of the first refresh
+	int refreshInterval;
+	int refreshOffset;
+
+	// Indexed by canvas, grown as each canvas is first drawn
+	std::vector<CanvasState> canvases;
+
+	// Cluster markers keyed by their label, a bounded set as large counts share a label
+	std::map<wxString, ClusterSymbol> clusterSymbols;
+
+	// Stations reporting the wind are drawn as wind barbs rather than the buoy icon. The barbs of
+	// each frame are generated into one batch, drawn with a call per primitive type
+	bool windBarbs;
+	NOAA_BarbBatch barbBatch;
+	std::vector<wxPoint> barbPoints;
+	std::vector<int> barbCounts;
+
+	// Station Id & Name of the station last found under the cursor, and its entry in the station data
 	wxString id;
 	wxString name;
+	NOAA_StationDataPtr selectedStations;
+	unsigned int selectedStation;
 
 	// Whether to use scheduled reports or realtime observations
 	bool useScheduled = false;
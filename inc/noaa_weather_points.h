@@ -0,0 +1,69 @@
+// Copyright(C) 2025 by Steven Adler
+//
+// This file is part of NOAA Weather plugin for OpenCPN.
+//
+// NOAA Weather plugin for OpenCPN is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// NOAA Weather plugin for OpenCPN is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with the NOAA Weather plugin for OpenCPN. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef NOAA_WEATHER_POINTS_H
+#define NOAA_WEATHER_POINTS_H
+
+// STL
+#include <string>
+#include <unordered_map>
+#include <cstdint>
+#include <cstddef>
+
+// NWS grid cells are about 2.5km, positions are quantized to a finer grid (0.01 degrees is about 1km)
+// so that a cached position very rarely maps to a neighbouring forecast cell
+#define POINTS_RESOLUTION 0.01
+
+// The office and grid assigned to a position almost never change, but do expire them eventually
+#define POINTS_MAX_AGE (30 * 24 * 60 * 60)
+
+// Maps quantized positions to the forecastGridData url returned by the NWS /points endpoint,
+// so repeated forecasts for nearby positions don't need the /points round trip
+class NOAA_PointsCache {
+
+public:
+	NOAA_PointsCache(double resolution = POINTS_RESOLUTION);
+
+	// Returns true and the url if the position's cell has an entry no older than maxAge seconds
+	bool Find(double latitude, double longitude, long long now, long long maxAge, std::string *url) const;
+
+	void Add(double latitude, double longitude, long long now, const std::string& url);
+
+	// Remove entries older than maxAge seconds
+	void Expire(long long now, long long maxAge);
+
+	void Clear(void) { entries.clear(); }
+	size_t Size(void) const { return entries.size(); }
+
+	// Persist the cache as text, one entry per line. File handling is left to the caller
+	std::string Serialize(void) const;
+	bool Deserialize(const char *data, size_t length);
+
+private:
+	typedef struct _pointsentry {
+		long long fetched;
+		std::string url;
+	} PointsEntry;
+
+	uint64_t Key(double latitude, double longitude) const;
+
+	double resolution;
+	std::unordered_map<uint64_t, PointsEntry> entries;
+};
+
+#endif
@@ -0,0 +1,127 @@
+// Copyright(C) 2025 by Steven Adler
+//
+// This file is part of NOAA Weather plugin for OpenCPN.
+//
+// NOAA Weather plugin for OpenCPN is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// NOAA Weather plugin for OpenCPN is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with the NOAA Weather plugin for OpenCPN. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef NOAA_WEATHER_PREFETCH_H
+#define NOAA_WEATHER_PREFETCH_H
+
+// STL
+#include <string>
+#include <vector>
+#include <map>
+
+// Requests in flight at once, in total and to any one host
+#define PREFETCH_CONCURRENCY 4
+#define PREFETCH_HOST_CONCURRENCY 2
+
+// Milliseconds between the start of requests to the same host
+#define PREFETCH_HOST_INTERVAL 250
+
+// Milliseconds the view port must be unchanged before the visible stations are prefetched
+#define PREFETCH_SETTLE 750
+
+// Milliseconds a prefetched observation is used for before it is fetched again. NDBC updates
+// the realtime observations every few minutes, but most stations only report every half hour
+#define PREFETCH_MAX_AGE (15 * 60 * 1000)
+
+// Milliseconds before a station that failed (eg. one without realtime observations) is tried again
+#define PREFETCH_RETRY_DELAY (60 * 60 * 1000)
+
+// Stations prefetched per settled view port, the nearest first. Kept below HISTORY_STATIONS so the
+// prefetched stations don't evict each other, nor the station the user last looked at
+#define PREFETCH_STATIONS 12
+
+typedef struct _prefetchrequest {
+	// Station id
+	std::string key;
+	std::string url;
+	// Distance to the vessel, only used to order the requests
+	double distance;
+} PrefetchRequest;
+
+// Decides which station files to fetch ahead of the user asking for them, and when.
+// The transport is left to the caller: Next hands out the requests that may be started now, and the
+// caller reports back with Complete. Requests are limited in total and per host, and successive requests
+// to a host are spaced apart, so a burst of prefetches is polite to the server and never starves the
+// user's own requests. All times are in milliseconds, from any monotonic clock
+class NOAA_PrefetchQueue {
+
+public:
+	NOAA_PrefetchQueue(int concurrency = PREFETCH_CONCURRENCY, int hostConcurrency = PREFETCH_HOST_CONCURRENCY,
+		long long hostInterval = PREFETCH_HOST_INTERVAL, long long maxAge = PREFETCH_MAX_AGE,
+		long long retryDelay = PREFETCH_RETRY_DELAY);
+
+	void SetConcurrency(int concurrency);
+
+	// Replace the stations waiting to be fetched with the nearest limit of these (requests is sorted). Stations in flight,
+	// recently fetched or that recently failed are skipped. Requests already in flight are left to finish
+	void SetWanted(std::vector<PrefetchRequest>& requests, size_t limit, long long now);
+
+	// The next request that may be started at now, which is then in flight
+	bool Next(long long now, PrefetchRequest *request);
+
+	// Milliseconds until Next could return a request, or -1 if nothing can start before a request completes
+	long long Delay(long long now) const;
+
+	// A request handed out by Next finished
+	void Complete(const std::string& key, bool success, long long now);
+
+	// The station was fetched some other way (eg. the user asked for it), so it isn't fetched again.
+	// A request for it already in flight still holds its slot until it reports back with Complete
+	void Satisfied(const std::string& key, bool success, long long now);
+
+	// Whether the station was fetched successfully within the maximum age
+	bool IsFresh(const std::string& key, long long now) const;
+
+	// Forget the waiting requests, those in flight are still expected to complete
+	void Clear(void) { waiting.clear(); }
+
+	size_t Waiting(void) const { return waiting.size(); }
+	size_t InFlight(void) const { return inFlight.size(); }
+
+	// The scheme, host and port of a url, eg. "https://www.ndbc.noaa.gov"
+	static std::string Host(const std::string& url);
+
+private:
+	typedef struct _hoststate {
+		int active;
+		long long lastStart;
+	} HostState;
+
+	// Whether a request to the host may start at now, otherwise the milliseconds until it may (-1 if it is at its limit)
+	long long HostDelay(const std::string& host, long long now) const;
+	void Record(const std::string& key, bool success, long long now);
+
+	int concurrency;
+	int hostConcurrency;
+	long long hostInterval;
+	long long maxAge;
+	long long retryDelay;
+
+	// Nearest first
+	std::vector<PrefetchRequest> waiting;
+
+	// Host of each request in flight, keyed by station
+	std::map<std::string, std::string> inFlight;
+	std::map<std::string, HostState> hosts;
+
+	// When each station was last fetched, or last failed
+	std::map<std::string, long long> fetched;
+	std::map<std::string, long long> failed;
+};
+
+#endif
@@ -0,0 +1,131 @@
+// Copyright(C) 2025 by Steven Adler
+//
+// This file is part of NOAA Weather plugin for OpenCPN.
+//
+// NOAA Weather plugin for OpenCPN is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// NOAA Weather plugin for OpenCPN is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with the NOAA Weather plugin for OpenCPN. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef NOAA_WEATHER_RENDERER_H
+#define NOAA_WEATHER_RENDERER_H
+
+// Pre compiled headers
+#include "wx/wxprec.h"
+
+#ifndef WX_PRECOMP
+#include <wx/wx.h>
+#endif
+
+// OpenCPN Device Context Abstraction Layer, used when batching is unavailable
+#include "noaa_weather_graphics.h"
+
+// STL
+#include <map>
+#include <vector>
+
+// Batching uses the fixed function pipeline, which is not available with GLES
+#if defined(ocpnUSE_GL) && !defined(ocpnUSE_GLES) && !defined(USE_ANDROID_GLES2)
+#define NOAA_BATCHED_GL
+#endif
+
+// Draws the station symbols in OpenGL mode.
+// The symbols are packed into a single texture atlas that is uploaded once, each frame's
+// symbols are then appended to one vertex array and drawn with a single glDrawArrays call.
+// Where batching is unavailable the symbols are drawn one by one using piDC.
+class NOAA_GLRenderer {
+
+public:
+	NOAA_GLRenderer();
+	~NOAA_GLRenderer();
+
+	// Add a symbol to the atlas, returns the symbol's id.
+	// Safe to call without a GL context, the atlas is uploaded on the next frame
+	int AddSymbol(const wxBitmap& bitmap);
+
+	// Replace a symbol's bitmap, which must be no larger than the original as it reuses its space in the atlas
+	void ReplaceSymbol(int symbol, const wxBitmap& bitmap);
+
+	// Start a new frame
+	void Begin(wxGLContext *context);
+
+	// Queue a symbol drawn with its top left corner at x,y
+	void Add(int symbol, int x, int y);
+
+	// Draw all of the queued symbols
+	void Flush(void);
+
+	// Draw untextured geometry in pixel coordinates, such as the wind barbs, with a single call per primitive type.
+	// Lines holds two x, y pairs per segment and triangles three per triangle
+	void DrawGeometry(const std::vector<float>& lines, const std::vector<float>& triangles, const wxColour& colour, float lineWidth);
+
+	int GetSymbolWidth(int symbol) const { return symbols[symbol].width; }
+	int GetSymbolHeight(int symbol) const { return symbols[symbol].height; }
+
+private:
+	typedef struct _symbol {
+		wxBitmap bitmap;
+		int x;
+		int y;
+		int width;
+		int height;
+	} Symbol;
+
+	std::vector<Symbol> symbols;
+
+#ifdef NOAA_BATCHED_GL
+	// Texture names are only valid for the context they were created in, so each canvas' context
+	// has its own copy of the atlas, uploaded again only when symbols have been added or replaced
+	typedef struct _contexttexture {
+		unsigned int texture;
+		bool dirty;
+	} ContextTexture;
+
+	// Symbols have been added or replaced
+	void MarkDirty(void);
+
+	// Compose the atlas pixels from the symbols' bitmaps
+	void Compose(void);
+
+	// Upload the atlas to the current context's texture, creating it on first use
+	void Upload(ContextTexture& contextTexture);
+
+	// Shelf packing of the symbols into the atlas
+	int shelfX;
+	int shelfY;
+	int shelfHeight;
+	int atlasWidth;
+	int atlasHeight;
+
+	// RGBA pixels of the atlas, recomposed when symbols are added or replaced
+	std::vector<unsigned char> pixels;
+	bool composed;
+
+	std::map<wxGLContext *, ContextTexture> textures;
+	ContextTexture *currentTexture;
+
+	// Interleaved x, y, u, v for two triangles per symbol, reused every frame
+	std::vector<float> vertices;
+#else
+	typedef struct _queued {
+		int symbol;
+		int x;
+		int y;
+	} Queued;
+
+	// Created in the first frame, when a GL context is current
+	NOAA_Graphics *graphics;
+	std::vector<Queued> queue;
+#endif
+};
+
+#endif
@@ -0,0 +1,151 @@
+// Copyright(C) 2025 by Steven Adler
+//
+// This file is part of NOAA Weather plugin for OpenCPN.
+//
+// NOAA Weather plugin for OpenCPN is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// NOAA Weather plugin for OpenCPN is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with the NOAA Weather plugin for OpenCPN. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef NOAA_WEATHER_ROUTE_H
+#define NOAA_WEATHER_ROUTE_H
+
+// Forecast time series
+#include "noaa_weather_forecast.h"
+
+// STL
+#include <string>
+#include <vector>
+#include <map>
+#include <cstdint>
+#include <cstddef>
+
+// Nautical miles between the samples along each leg. Forecast cells are about 2.5km, but the marine
+// forecast varies little over a few miles and each distinct cell is a separate download
+#define ROUTE_SAMPLE_DISTANCE 10.0
+
+// Longer routes are sampled more sparsely, so a route never needs more than this many cells
+#define ROUTE_MAX_SAMPLES 100
+
+// Forecast cells kept between plans, so editing a route only downloads the cells it has moved into
+#define ROUTE_CELLS 128
+
+// Knots per km/h, NWS gridpoint wind speeds are km/h
+#define ROUTE_KNOTS_PER_KMH (1.0 / 1.852)
+
+// The forecast layers used along the route. The wind direction is held as the components of a
+// unit vector, so it can be interpolated across north
+typedef enum _routelayer {
+	ROUTE_TEMPERATURE = 0,
+	ROUTE_WIND_SPEED,
+	ROUTE_WIND_GUST,
+	ROUTE_WIND_X,
+	ROUTE_WIND_Y,
+	ROUTE_LAYERS
+} ROUTE_LAYER;
+
+typedef struct _routewaypoint {
+	std::string name;
+	double latitude;
+	double longitude;
+} RouteWaypoint;
+
+// The forecast at a waypoint at the time the vessel is expected there. Missing values are NaN
+typedef struct _routeforecastrow {
+	std::string name;
+	// Nautical miles from the start of the route, and the ETA in seconds since the epoch
+	double distance;
+	long long eta;
+	// degC, knots and degrees true the wind is from
+	double temperature;
+	double windSpeed;
+	double windGust;
+	double windDirection;
+	// Strongest wind forecast along the leg to the next waypoint
+	double legWindSpeed;
+} RouteForecastRow;
+
+// Forecast along a route. The route is sampled at intervals along each leg and each sample given the
+// time the vessel will pass it. The caller assigns each sample the forecast cell covering it and supplies
+// the forecast of each distinct cell. Compute then interpolates each sample's cell in time, and fills the
+// samples without a forecast (eg. offshore of the NWS grids) by interpolating between their neighbours
+// along the route. Planning and computing take microseconds, only new cells need downloading
+class NOAA_RouteForecast {
+
+public:
+	NOAA_RouteForecast();
+
+	// Sample the route at the waypoints and every sampleDistance nautical miles between them,
+	// for a vessel leaving the first waypoint at departure (seconds since the epoch) at speed knots
+	void Plan(const std::vector<RouteWaypoint>& waypoints, double speed, long long departure,
+		double sampleDistance = ROUTE_SAMPLE_DISTANCE);
+
+	size_t Samples(void) const { return times.size(); }
+	double SampleLatitude(size_t sample) const { return latitudes[sample]; }
+	double SampleLongitude(size_t sample) const { return longitudes[sample]; }
+	long long SampleTime(size_t sample) const { return times[sample]; }
+
+	// The forecast cell covering a sample, identified by its gridpoint url
+	void SetCell(size_t sample, const std::string& key);
+
+	// The distinct cells of the samples
+	const std::vector<std::string>& Cells(void) const { return cellKeys; }
+
+	// Whether the cell's forecast was supplied no more than maxAge seconds before now
+	bool HasForecast(const std::string& key, long long now, long long maxAge) const;
+
+	// Keep the layers used along the route from a cell's forecast
+	void SetForecast(const std::string& key, const NOAA_Forecast& forecast, long long now);
+
+	// The forecast at each waypoint
+	void Compute(std::vector<RouteForecastRow> *rows);
+
+	// Nautical miles along the rhumb line, the track OpenCPN follows between waypoints
+	static double Distance(double latitude0, double longitude0, double latitude1, double longitude1);
+
+	// Names of the forecast layers used, to extract only those from the gridpoint response
+	static std::vector<std::string> GetLayerNames(void);
+
+private:
+	// A cell's hourly values, each layer padded with the last hour repeated and then two NaN
+	// so the interpolation never needs a bounds check, see Compute
+	typedef struct _routecell {
+		long long origin;
+		size_t hours;
+		long long fetched;
+		std::vector<float> values[ROUTE_LAYERS];
+	} RouteCell;
+
+	std::map<std::string, RouteCell> cells;
+
+	// Waypoints, and the sample at each
+	std::vector<std::string> names;
+	std::vector<size_t> waypointSamples;
+
+	// Samples, in order along the route
+	std::vector<double> latitudes;
+	std::vector<double> longitudes;
+	std::vector<double> distances;
+	std::vector<long long> times;
+	// Index into cellKeys, -1 if the sample has no cell
+	std::vector<int> sampleCells;
+	std::vector<std::string> cellKeys;
+
+	// Interpolated values of each sample, and working storage of the interpolation
+	std::vector<float> sampleValues[ROUTE_LAYERS];
+	std::vector<uint32_t> cellSamples;
+	std::vector<int32_t> hourIndex;
+	std::vector<float> hourFraction;
+	std::vector<float> interpolated;
+};
+
+#endif
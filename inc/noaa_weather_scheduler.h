@@ -0,0 +1,86 @@
+// Copyright(C) 2025 by Steven Adler
+//
+// This file is part of NOAA Weather plugin for OpenCPN.
+//
+// NOAA Weather plugin for OpenCPN is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// NOAA Weather plugin for OpenCPN is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with the NOAA Weather plugin for OpenCPN. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef NOAA_WEATHER_SCHEDULER_H
+#define NOAA_WEATHER_SCHEDULER_H
+
+// Pre compiled headers
+#include "wx/wxprec.h"
+
+#ifndef WX_PRECOMP
+#include <wx/wx.h>
+#endif
+
+// wxWidgets include files
+#include <wx/timer.h>
+#include <wx/datetime.h>
+
+// STL
+#include <functional>
+
+// NDBC observations are taken on the hour and half hour and are usually published within ten minutes
+#define REFRESH_INTERVAL_REPORTS 30
+#define REFRESH_INTERVAL_STATIONS (24 * 60)
+#define REFRESH_OFFSET 10
+
+// wxTimer takes an int number of milliseconds (about 24.8 days), longer waits are made in steps of at most this (seconds)
+#define SCHEDULER_MAX_DELAY (24 * 60 * 60)
+
+// Periodically refreshes the station data. Rather than a fixed period from when OpenCPN started,
+// each refresh is aligned to the clock (eg. hh:10 and hh:40), so it follows NDBC's publication cadence.
+// The callback is invoked from the main event loop.
+class NOAA_RefreshScheduler : public wxTimer {
+
+public:
+	NOAA_RefreshScheduler();
+
+	// Interval and offset are in seconds, an interval of zero disables the refresh
+	void Schedule(long long interval, long long offset, std::function<void()> callback);
+	void Cancel(void);
+
+	// Seconds since the epoch of the next refresh after now
+	static long long NextRefresh(long long now, long long interval, long long offset);
+
+	void Notify() override;
+
+private:
+	void ScheduleNext(void);
+	void StartTimer(long long now);
+
+	long long interval;
+	long long offset;
+	// Seconds since the epoch of the next refresh
+	long long due;
+	std::function<void()> callback;
+};
+
+// Runs a callback once after a delay, from the main event loop. Deferring it again before it has run
+// restarts the delay, so a burst of calls (eg. while the chart is dragged) results in a single callback
+class NOAA_DelayedCall : public wxTimer {
+
+public:
+	void Defer(long long milliseconds, std::function<void()> callback);
+	void Cancel(void);
+
+	void Notify() override;
+
+private:
+	std::function<void()> callback;
+};
+
+#endif
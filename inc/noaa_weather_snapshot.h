@@ -0,0 +1,84 @@
+// Copyright(C) 2025 by Steven Adler
+//
+// This file is part of NOAA Weather plugin for OpenCPN.
+//
+// NOAA Weather plugin for OpenCPN is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// NOAA Weather plugin for OpenCPN is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with the NOAA Weather plugin for OpenCPN. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef NOAA_WEATHER_SNAPSHOT_H
+#define NOAA_WEATHER_SNAPSHOT_H
+
+// NDBC Station data
+#include "noaa_weather_columns.h"
+
+// STL
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// Bump whenever the layout of the snapshot changes, older snapshots are then ignored
+#define SNAPSHOT_VERSION 2
+
+// What the snapshot contains
+typedef enum _snapshotcontent {
+	SNAPSHOT_STATION_LIST = 0,		// station_table.txt
+	SNAPSHOT_SCHEDULED_REPORTS = 1	// latest_obs.txt
+} SNAPSHOT_CONTENT;
+
+typedef struct _snapshotinfo {
+	uint32_t content;
+	// Hash of the upstream file the snapshot was built from, used to skip unchanged downloads
+	uint64_t sourceHash;
+	// Seconds since the epoch when the snapshot was written
+	int64_t created;
+} SnapshotInfo;
+
+// Read only memory mapping of a file
+class NOAA_MappedFile {
+
+public:
+	NOAA_MappedFile();
+	~NOAA_MappedFile();
+
+	// The file name is UTF-8 encoded
+	bool Open(const std::string& fileName);
+	void Close(void);
+
+	const char *Data(void) const { return data; }
+	size_t Size(void) const { return size; }
+
+private:
+	const char *data;
+	size_t size;
+#ifdef _WIN32
+	void *file;
+	void *mapping;
+#else
+	int file;
+#endif
+};
+
+// 64 bit FNV-1a hash
+uint64_t HashData(const char *data, size_t length);
+
+// Write the station list to a compact binary snapshot.
+// The snapshot is written to a temporary file and then renamed, so a reader never sees a partial snapshot
+bool SaveSnapshot(const std::string& fileName, const SnapshotInfo& info, const NOAA_StationColumns& buoys);
+
+// Load a snapshot by memory mapping it and copying each column out of the mapping.
+// Returns false if the file is missing, truncated or from a different version
+bool LoadSnapshot(const std::string& fileName, SnapshotInfo *info, NOAA_StationColumns *buoys);
+
+#endif
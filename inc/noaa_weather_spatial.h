@@ -0,0 +1,73 @@
+// Copyright(C) 2025 by Steven Adler
+//
+// This file is part of NOAA Weather plugin for OpenCPN.
+//
+// NOAA Weather plugin for OpenCPN is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// NOAA Weather plugin for OpenCPN is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with the NOAA Weather plugin for OpenCPN. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef NOAA_WEATHER_SPATIAL_H
+#define NOAA_WEATHER_SPATIAL_H
+
+// NDBC Station data
+#include "noaa_weather_parser.h"
+
+// STL
+#include <vector>
+
+// Uniform latitude/longitude grid over the station list.
+// Built once whenever the station list is refreshed, a viewport query then only visits
+// the grid cells overlapping the viewport rather than every station.
+// Results are indices into the station list that was used to build the index.
+class NOAA_SpatialIndex {
+
+public:
+	NOAA_SpatialIndex(double cellSize = 1.0);
+
+	// Rebuild the index from the station coordinate columns
+	void Build(const float *buoyLatitudes, const float *buoyLongitudes, size_t count);
+
+	void Clear(void);
+
+	// Replace the contents of results with the stations inside the bounding box.
+	// Longitudes may be expressed in either the -180..180 or 0..360 convention and
+	// boxes crossing the antimeridian (lonMin > lonMax once normalized) are split in two.
+	void Query(double latMin, double latMax, double lonMin, double lonMax, std::vector<unsigned int> *results) const;
+
+	size_t Size(void) const { return stations.size(); }
+
+	// Normalize a longitude to the range -180 <= longitude < 180
+	static double NormalizeLongitude(double longitude);
+
+private:
+	// Append the stations within a box that does not cross the antimeridian
+	void QueryRange(double latMin, double latMax, double lonMin, double lonMax, std::vector<unsigned int> *results) const;
+
+	int Row(double latitude) const;
+	int Column(double longitude) const;
+
+	double cellSize;
+	int rows;
+	int columns;
+
+	// Compressed cell lists, the stations for cell n are stations[cellStart[n]] to stations[cellStart[n + 1] - 1]
+	std::vector<unsigned int> cellStart;
+	std::vector<unsigned int> stations;
+
+	// Copy of each station's position, in the same order as stations,
+	// so the boundary cells can be checked without touching the station list
+	std::vector<float> latitudes;
+	std::vector<float> longitudes;
+};
+
+#endif
@@ -0,0 +1,106 @@
+// Copyright(C) 2025 by Steven Adler
+//
+// This file is part of NOAA Weather plugin for OpenCPN.
+//
+// NOAA Weather plugin for OpenCPN is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// NOAA Weather plugin for OpenCPN is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with the NOAA Weather plugin for OpenCPN. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef NOAA_WEATHER_STATIONS_H
+#define NOAA_WEATHER_STATIONS_H
+
+// NDBC Station data
+#include "noaa_weather_columns.h"
+
+// Spatial index of the stations
+#include "noaa_weather_spatial.h"
+
+// Clusters of stations for small chart scales
+#include "noaa_weather_clusters.h"
+
+// Snapshot content, hashing and saving
+#include "noaa_weather_snapshot.h"
+
+// Parse timings
+#include "noaa_weather_statistics.h"
+
+// STL
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cstdint>
+
+// A complete set of station data. Once published it is never modified, a refresh builds a new one
+typedef struct _stationdata {
+	uint32_t content;
+	// Hash of the upstream file the stations were parsed from
+	uint64_t sourceHash;
+	NOAA_StationColumns buoys;
+	// Indices into buoys
+	NOAA_SpatialIndex index;
+	NOAA_ClusterPyramid clusters;
+} NOAA_StationData;
+
+typedef std::shared_ptr<const NOAA_StationData> NOAA_StationDataPtr;
+
+// Invoked on the worker thread once new station data has been published, and whether it was saved to the snapshot.
+// The data is NULL when the download held no stations and was discarded
+typedef std::function<void(NOAA_StationDataPtr, bool)> NOAA_PublishCallback;
+
+// Holds the current station data. A refresh parses the downloaded file and builds the spatial index
+// on a worker thread, then swaps in the new data with a single atomic store. Readers take a reference
+// with Get() and keep using it for as long as they need, so they never see a partially built list
+// and the old data is released when its last reader lets go.
+class NOAA_StationStore {
+
+public:
+	NOAA_StationStore();
+	~NOAA_StationStore();
+
+	// The current station data, never NULL (but may be empty)
+	NOAA_StationDataPtr Get(void) const { return std::atomic_load(&current); }
+
+	void Publish(NOAA_StationDataPtr data) { std::atomic_store(&current, data); }
+
+	// Build the spatial index for a list of stations, the list is moved into the result
+	static NOAA_StationDataPtr Build(uint32_t content, uint64_t sourceHash, NOAA_StationColumns& buoys);
+
+	// Parse a downloaded station_table.txt or latest_obs.txt on the worker thread, publish it and
+	// save it to the snapshot file. The data is moved from the caller.
+	// Nothing is published if the file is unchanged or holds no stations. Returns false if a refresh is already running
+	bool Refresh(std::vector<char>& data, uint32_t content, const std::string& snapshotFile, NOAA_PublishCallback published);
+
+	bool IsBusy(void) const { return busy; }
+
+	// Owned by the caller, NULL disables the instrumentation
+	void SetStatistics(NOAA_Statistics *parseStatistics) { statistics = parseStatistics; }
+
+	// Wait for a running refresh to finish
+	void Wait(void);
+
+private:
+	void Run(std::shared_ptr<std::vector<char>> data, uint32_t content, std::string snapshotFile, NOAA_PublishCallback published);
+
+	// Only accessed with atomic_load and atomic_store
+	NOAA_StationDataPtr current;
+
+	std::thread worker;
+	std::atomic<bool> busy;
+
+	NOAA_Statistics *statistics;
+};
+
+#endif
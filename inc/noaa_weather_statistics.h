@@ -0,0 +1,134 @@
+// Copyright(C) 2025 by Steven Adler
+//
+// This file is part of NOAA Weather plugin for OpenCPN.
+//
+// NOAA Weather plugin for OpenCPN is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// NOAA Weather plugin for OpenCPN is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with the NOAA Weather plugin for OpenCPN. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef NOAA_WEATHER_STATISTICS_H
+#define NOAA_WEATHER_STATISTICS_H
+
+// STL
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+
+// Bucket i holds values less than 2^i (and at least 2^(i-1)), the last bucket holds everything larger
+#define HISTOGRAM_BUCKETS 40
+
+// Timers are recorded in microseconds, sizes in bytes
+typedef enum _statistic {
+	STAT_POINTS_LOOKUP = 0,		// Round trip of the /points request for a forecast url
+	STAT_DOWNLOAD,				// Time from starting a transfer to its completion
+	STAT_DOWNLOAD_BYTES,		// Size of each response
+	STAT_PARSE_FORECAST,		// Extracting the gridpoint forecast layers
+	STAT_PARSE_ALERTS,
+	STAT_PARSE_STATIONS,		// Parsing and indexing the station list or scheduled reports
+	STAT_PARSE_REALTIME,
+	STAT_DIALOG,				// Creating and populating the forecast dialog
+	STAT_FILTER,				// FilterVisibleBuoys
+	STAT_RENDER_DC,
+	STAT_RENDER_GL,
+	STAT_FRAME_ICONS,			// Icons drawn per frame
+	STAT_HISTOGRAMS
+} STATISTIC;
+
+typedef enum _counter {
+	COUNTER_CACHE_FRESH = 0,	// Response cache hits served without contacting the server
+	COUNTER_CACHE_STALE,		// Hits that were revalidated in the background
+	COUNTER_CACHE_MISS,
+	COUNTER_CACHE_NOT_MODIFIED,	// Revalidations answered with HTTP 304
+	COUNTER_POINTS_HIT,			// Forecast urls found in the points cache
+	COUNTER_POINTS_MISS,
+	COUNTER_DOWNLOAD_FAILED,
+	COUNTER_PREFETCHED,			// Realtime observations fetched ahead of the user asking for them
+	COUNTER_PREFETCH_HIT,		// Realtime observations shown without waiting on a download
+	COUNTER_COUNT
+} COUNTER;
+
+typedef struct _histogramsummary {
+	uint64_t count;
+	uint64_t sum;
+	uint64_t maximum;
+	// Percentiles are the upper bound of the bucket they fall in, so within a factor of two
+	uint64_t p50;
+	uint64_t p90;
+	uint64_t p99;
+} HistogramSummary;
+
+// Log2 bucketed histogram. Recording is a handful of relaxed atomic operations,
+// so it is cheap enough for every frame and may be used from worker threads.
+class NOAA_Histogram {
+
+public:
+	NOAA_Histogram();
+
+	void Record(uint64_t value);
+	void Reset(void);
+	HistogramSummary Summarize(void) const;
+
+private:
+	uint64_t Percentile(const uint64_t *counts, uint64_t total, double percentile, uint64_t maximum) const;
+
+	std::atomic<uint64_t> buckets[HISTOGRAM_BUCKETS];
+	std::atomic<uint64_t> count;
+	std::atomic<uint64_t> sum;
+	std::atomic<uint64_t> maximum;
+};
+
+// Latency, size and counter instrumentation of the plugin's stages
+class NOAA_Statistics {
+
+public:
+	NOAA_Statistics();
+
+	void Record(STATISTIC statistic, uint64_t value) { histograms[statistic].Record(value); }
+	void Increment(COUNTER counter) { counters[counter].fetch_add(1, std::memory_order_relaxed); }
+
+	HistogramSummary Summarize(STATISTIC statistic) const { return histograms[statistic].Summarize(); }
+	uint64_t Counter(COUNTER counter) const { return counters[counter].load(std::memory_order_relaxed); }
+
+	// Seconds since the statistics were created or reset
+	uint64_t Uptime(void) const;
+
+	void Reset(void);
+
+	// Names used when publishing the statistics
+	static const char *Name(STATISTIC statistic);
+	static const char *Unit(STATISTIC statistic);
+	static const char *Name(COUNTER counter);
+
+	// Monotonic clock, in microseconds
+	static uint64_t Now(void);
+
+private:
+	NOAA_Histogram histograms[STAT_HISTOGRAMS];
+	std::atomic<uint64_t> counters[COUNTER_COUNT];
+	std::atomic<uint64_t> started;
+};
+
+// Records the time from its construction to its destruction. Nothing is recorded if statistics is NULL
+class NOAA_StatisticsTimer {
+
+public:
+	NOAA_StatisticsTimer(NOAA_Statistics *statistics, STATISTIC statistic);
+	~NOAA_StatisticsTimer();
+
+private:
+	NOAA_Statistics *statistics;
+	STATISTIC statistic;
+	uint64_t start;
+};
+
+#endif
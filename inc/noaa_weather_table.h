@@ -0,0 +1,74 @@
+// Copyright(C) 2025 by Steven Adler
+//
+// This file is part of NOAA Weather plugin for OpenCPN.
+//
+// NOAA Weather plugin for OpenCPN is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// NOAA Weather plugin for OpenCPN is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with the NOAA Weather plugin for OpenCPN. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#ifndef NOAA_WEATHER_TABLE_H
+#define NOAA_WEATHER_TABLE_H
+
+// Pre compiled headers
+#include "wx/wxprec.h"
+
+#ifndef WX_PRECOMP
+#include <wx/wx.h>
+#endif
+
+// wxWidgets include files
+#include <wx/grid.h>
+#include <wx/datetime.h>
+
+// Forecast time series
+#include "noaa_weather_forecast.h"
+
+// STL
+#include <string>
+#include <vector>
+
+// Presents a forecast to a wxGrid, one row per hour and one column per selected layer.
+// Nothing is formatted up front, the grid asks for the cells it paints.
+class NOAA_ForecastTable : public wxGridTableBase {
+
+public:
+	// The forecast must outlive the table
+	NOAA_ForecastTable(const NOAA_Forecast *forecast);
+
+	int GetNumberRows() override;
+	int GetNumberCols() override;
+	bool IsEmptyCell(int row, int col) override;
+	wxString GetValue(int row, int col) override;
+	void SetValue(int row, int col, const wxString& value) override;
+	wxString GetRowLabelValue(int row) override;
+	wxString GetColLabelValue(int col) override;
+
+	// Show or hide a layer, updating the grid if attached
+	void ShowLayer(size_t layer, bool show);
+	bool IsLayerShown(size_t layer) const;
+
+	// The forecast has been rebuilt with another layer, which may have changed the number of hours
+	void HoursChanged(int previousRows);
+
+	// Column heading of a layer, eg. "Wind Speed (km/h)"
+	static wxString GetLayerTitle(const NOAA_Forecast& forecast, size_t layer);
+	static wxString GetLayerTitle(const std::string& name, const std::string& unit);
+
+private:
+	const NOAA_Forecast *forecast;
+
+	// Layer displayed in each column
+	std::vector<size_t> columns;
+};
+
+#endif
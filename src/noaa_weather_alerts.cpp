@@ -0,0 +1,233 @@
+// Copyright(C) 2025 by Steven Adler
+//
+// This file is part of NOAA Weather plugin for OpenCPN.
+//
+// NOAA Weather plugin for OpenCPN is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// NOAA Weather plugin for OpenCPN is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with the NOAA Weather plugin for OpenCPN. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "noaa_weather_alerts.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+// Polygons per leaf of the bounding box tree
+#define ALERT_LEAF_SIZE 4
+
+// Bands per polygon, roughly four edges per band
+#define ALERT_EDGES_PER_BAND 4
+#define ALERT_MAX_BANDS 64
+
+NOAA_AlertIndex::NOAA_AlertIndex() {
+}
+
+void NOAA_AlertIndex::Clear(void) {
+	alerts.clear();
+	polygons.clear();
+	edges.clear();
+	bandOffsets.clear();
+	bandEdges.clear();
+	nodes.clear();
+	order.clear();
+}
+
+bool NOAA_AlertIndex::Inside(const Bounds& bounds, double latitude, double longitude) {
+	return (latitude >= bounds.minLatitude) && (latitude <= bounds.maxLatitude) &&
+		(longitude >= bounds.minLongitude) && (longitude <= bounds.maxLongitude);
+}
+
+void NOAA_AlertIndex::Build(std::vector<AlertData>& newAlerts) {
+	Clear();
+	alerts.swap(newAlerts);
+	newAlerts.clear();
+
+	for (unsigned int i = 0; i < alerts.size(); i++) {
+		for (const auto& it : alerts[i].polygons) {
+			AddPolygon(i, it);
+		}
+	}
+
+	order.resize(polygons.size());
+	for (unsigned int i = 0; i < order.size(); i++) {
+		order[i] = i;
+	}
+	if (!order.empty()) {
+		nodes.reserve((2 * order.size() / ALERT_LEAF_SIZE) + 1);
+		BuildNode(0, (unsigned int)order.size());
+	}
+}
+
+void NOAA_AlertIndex::AddPolygon(unsigned int alert, const AlertPolygon& polygon) {
+	Polygon p;
+	p.alert = alert;
+	p.bounds.minLatitude = p.bounds.minLongitude = std::numeric_limits<double>::max();
+	p.bounds.maxLatitude = p.bounds.maxLongitude = -std::numeric_limits<double>::max();
+
+	// Every ring contributes its edges, with the even-odd rule the holes then take care of themselves
+	size_t firstEdge = edges.size();
+	for (const auto& ring : polygon) {
+		size_t points = ring.size() / 2;
+		for (size_t i = 0; i < points; i++) {
+			Edge edge;
+			edge.longitude0 = ring[i * 2];
+			edge.latitude0 = ring[(i * 2) + 1];
+			// GeoJSON rings are closed, but don't rely on it
+			size_t next = (i + 1) % points;
+			edge.longitude1 = ring[next * 2];
+			edge.latitude1 = ring[(next * 2) + 1];
+
+			p.bounds.minLatitude = std::min(p.bounds.minLatitude, edge.latitude0);
+			p.bounds.maxLatitude = std::max(p.bounds.maxLatitude, edge.latitude0);
+			p.bounds.minLongitude = std::min(p.bounds.minLongitude, edge.longitude0);
+			p.bounds.maxLongitude = std::max(p.bounds.maxLongitude, edge.longitude0);
+
+			// Horizontal edges never cross the ray
+			if (edge.latitude0 != edge.latitude1) {
+				edges.push_back(edge);
+			}
+		}
+	}
+	size_t edgeCount = edges.size() - firstEdge;
+	if (edgeCount == 0) {
+		return;
+	}
+
+	p.bands = (unsigned int)std::min<size_t>(std::max<size_t>(edgeCount / ALERT_EDGES_PER_BAND, 1), ALERT_MAX_BANDS);
+	p.bandHeight = (p.bounds.maxLatitude - p.bounds.minLatitude) / p.bands;
+	p.firstBand = (unsigned int)bandOffsets.size();
+
+	// Count the edges crossing each band, then fill the bands
+	auto bandOf = [&p](double latitude) {
+		int band = (p.bandHeight > 0) ? (int)((latitude - p.bounds.minLatitude) / p.bandHeight) : 0;
+		return (unsigned int)std::min(std::max(band, 0), (int)p.bands - 1);
+	};
+
+	std::vector<unsigned int> counts(p.bands + 1, 0);
+	for (size_t i = firstEdge; i < edges.size(); i++) {
+		unsigned int low = bandOf(std::min(edges[i].latitude0, edges[i].latitude1));
+		unsigned int high = bandOf(std::max(edges[i].latitude0, edges[i].latitude1));
+		for (unsigned int b = low; b <= high; b++) {
+			counts[b + 1]++;
+		}
+	}
+
+	unsigned int start = (unsigned int)bandEdges.size();
+	for (unsigned int b = 0; b <= p.bands; b++) {
+		start += counts[b];
+		bandOffsets.push_back(start);
+	}
+	bandEdges.resize(bandOffsets.back());
+
+	std::vector<unsigned int> fill(bandOffsets.begin() + p.firstBand, bandOffsets.end() - 1);
+	for (size_t i = firstEdge; i < edges.size(); i++) {
+		unsigned int low = bandOf(std::min(edges[i].latitude0, edges[i].latitude1));
+		unsigned int high = bandOf(std::max(edges[i].latitude0, edges[i].latitude1));
+		for (unsigned int b = low; b <= high; b++) {
+			bandEdges[fill[b]++] = (unsigned int)i;
+		}
+	}
+
+	polygons.push_back(p);
+}
+
+// Split at the median of the polygons' centres along the longer side of their bounds
+unsigned int NOAA_AlertIndex::BuildNode(unsigned int first, unsigned int count) {
+	unsigned int index = (unsigned int)nodes.size();
+	nodes.push_back(Node());
+
+	Node node;
+	node.first = first;
+	node.count = count;
+	node.second = 0;
+	node.bounds = polygons[order[first]].bounds;
+	for (unsigned int i = first + 1; i < first + count; i++) {
+		const Bounds& bounds = polygons[order[i]].bounds;
+		node.bounds.minLatitude = std::min(node.bounds.minLatitude, bounds.minLatitude);
+		node.bounds.maxLatitude = std::max(node.bounds.maxLatitude, bounds.maxLatitude);
+		node.bounds.minLongitude = std::min(node.bounds.minLongitude, bounds.minLongitude);
+		node.bounds.maxLongitude = std::max(node.bounds.maxLongitude, bounds.maxLongitude);
+	}
+
+	if (count > ALERT_LEAF_SIZE) {
+		bool byLatitude = (node.bounds.maxLatitude - node.bounds.minLatitude) > (node.bounds.maxLongitude - node.bounds.minLongitude);
+		unsigned int half = count / 2;
+		std::nth_element(order.begin() + first, order.begin() + first + half, order.begin() + first + count,
+			[this, byLatitude](unsigned int a, unsigned int b) {
+				const Bounds& p = polygons[a].bounds;
+				const Bounds& q = polygons[b].bounds;
+				return byLatitude ? (p.minLatitude + p.maxLatitude) < (q.minLatitude + q.maxLatitude) :
+					(p.minLongitude + p.maxLongitude) < (q.minLongitude + q.maxLongitude);
+			});
+		BuildNode(first, half);
+		node.second = BuildNode(first + half, count - half);
+	}
+
+	nodes[index] = node;
+	return index;
+}
+
+// Even-odd crossing test of a ray running east from the position, over the edges of its band
+bool NOAA_AlertIndex::Contains(const Polygon& polygon, double latitude, double longitude) const {
+	int band = (polygon.bandHeight > 0) ? (int)((latitude - polygon.bounds.minLatitude) / polygon.bandHeight) : 0;
+	band = std::min(std::max(band, 0), (int)polygon.bands - 1);
+
+	bool inside = false;
+	for (unsigned int i = bandOffsets[polygon.firstBand + band]; i < bandOffsets[polygon.firstBand + band + 1]; i++) {
+		const Edge& edge = edges[bandEdges[i]];
+		if ((edge.latitude0 > latitude) != (edge.latitude1 > latitude)) {
+			double crossing = edge.longitude0 + ((latitude - edge.latitude0) * (edge.longitude1 - edge.longitude0) / (edge.latitude1 - edge.latitude0));
+			if (longitude < crossing) {
+				inside = !inside;
+			}
+		}
+	}
+	return inside;
+}
+
+void NOAA_AlertIndex::Query(double latitude, double longitude, std::vector<unsigned int> *results) const {
+	results->clear();
+
+	if ((nodes.empty()) || (std::isnan(latitude)) || (std::isnan(longitude))) {
+		return;
+	}
+
+	// The tree is balanced, so the stack never holds more than one node per level
+	unsigned int stack[64];
+	int top = 0;
+	stack[top++] = 0;
+
+	while (top > 0) {
+		unsigned int current = stack[--top];
+		const Node& node = nodes[current];
+		if (!Inside(node.bounds, latitude, longitude)) {
+			continue;
+		}
+		if (node.second == 0) {
+			for (unsigned int i = node.first; i < node.first + node.count; i++) {
+				const Polygon& polygon = polygons[order[i]];
+				if ((Inside(polygon.bounds, latitude, longitude)) && (Contains(polygon, latitude, longitude))) {
+					results->push_back(polygon.alert);
+				}
+			}
+		}
+		else {
+			stack[top++] = node.second;
+			stack[top++] = current + 1;
+		}
+	}
+
+	// An alert covering several polygons may have matched more than once
+	std::sort(results->begin(), results->end());
+	results->erase(std::unique(results->begin(), results->end()), results->end());
+}
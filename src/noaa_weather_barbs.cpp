@@ -0,0 +1,151 @@
+// Copyright(C) 2025 by Steven Adler
+//
+// This file is part of NOAA Weather plugin for OpenCPN.
+//
+// NOAA Weather plugin for OpenCPN is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// NOAA Weather plugin for OpenCPN is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with the NOAA Weather plugin for OpenCPN. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "noaa_weather_barbs.h"
+
+#include <cmath>
+
+#define BARB_PI 3.14159265358979323846
+
+// Proportions of the staff
+#define BARB_FEATHER_X 0.42f
+#define BARB_FEATHER_Y 0.2f
+#define BARB_SPACING 0.13f
+#define BARB_PENNANT_WIDTH 0.14f
+#define BARB_CALM_RADIUS 0.15f
+
+NOAA_BarbBatch::NOAA_BarbBatch() {
+	output = BARB_OUTPUT_LINES;
+	northAngle = 0;
+	barbs = 0;
+	originX = originY = 0;
+	staffX = staffY = 0;
+	featherX = featherY = 0;
+
+	for (int i = 0; i < BARB_BUCKETS; i++) {
+		BuildShape(i, &shapes[i]);
+	}
+}
+
+int NOAA_BarbBatch::Bucket(float speed) {
+	if (!(speed > 0)) {
+		return 0;
+	}
+	int bucket = (int)((speed + (BARB_STEP / 2.0f)) / BARB_STEP);
+	return (bucket < BARB_BUCKETS) ? bucket : BARB_BUCKETS - 1;
+}
+
+// The staff runs from the station at 0,0 to 0,1. From its tip are the pennants (50 knots),
+// the feathers (10 knots) and a half feather (5 knots), on the positive x side
+void NOAA_BarbBatch::BuildShape(int bucket, BarbShape *shape) {
+
+	if (bucket == 0) {
+		for (int i = 0; i < BARB_CALM_SEGMENTS; i++) {
+			for (int j = 0; j < 2; j++) {
+				double angle = (2.0 * BARB_PI * (i + j)) / BARB_CALM_SEGMENTS;
+				shape->lines.push_back(BARB_CALM_RADIUS * (float)std::sin(angle));
+				shape->lines.push_back(BARB_CALM_RADIUS * (float)std::cos(angle));
+			}
+			shape->outline.push_back(shape->lines[i * 4]);
+			shape->outline.push_back(shape->lines[(i * 4) + 1]);
+		}
+		return;
+	}
+
+	int knots = bucket * BARB_STEP;
+	int pennants = knots / 50;
+	int feathers = (knots % 50) / 10;
+	bool half = (knots % 10) != 0;
+
+	const float staff[] = { 0, 0, 0, 1 };
+	shape->lines.assign(staff, staff + 4);
+	shape->outline.assign(staff, staff + 4);
+
+	// A lone half feather is set back from the tip, so it isn't mistaken for a full one
+	float y = ((pennants == 0) && (feathers == 0)) ? 1.0f - BARB_SPACING : 1.0f;
+
+	for (int i = 0; i < pennants; i++) {
+		const float pennant[] = { 0, y, BARB_FEATHER_X, y + BARB_FEATHER_Y - BARB_PENNANT_WIDTH, 0, y - BARB_PENNANT_WIDTH };
+		shape->triangles.insert(shape->triangles.end(), pennant, pennant + 6);
+		y -= BARB_PENNANT_WIDTH + (BARB_SPACING / 2);
+	}
+
+	for (int i = 0; i < feathers + (half ? 1 : 0); i++) {
+		float scale = (i < feathers) ? 1.0f : 0.5f;
+		const float feather[] = { 0, y, scale * BARB_FEATHER_X, y + (scale * BARB_FEATHER_Y) };
+		shape->lines.insert(shape->lines.end(), feather, feather + 4);
+
+		// Down the staff to the feather, out to its end and back
+		shape->outline.insert(shape->outline.end(), feather, feather + 4);
+		shape->outline.push_back(0);
+		shape->outline.push_back(y);
+		y -= BARB_SPACING;
+	}
+
+	// Back down the staff, so the outline closes on itself without enclosing anything
+	shape->outline.push_back(0);
+	shape->outline.push_back(0);
+}
+
+void NOAA_BarbBatch::Begin(double angle, BARB_OUTPUT barbOutput) {
+	northAngle = angle;
+	output = barbOutput;
+	barbs = 0;
+	lines.clear();
+	triangles.clear();
+	outlines.clear();
+	outlineCounts.clear();
+}
+
+void NOAA_BarbBatch::Append(const std::vector<float>& local, std::vector<float> *result) const {
+	size_t start = result->size();
+	result->resize(start + local.size());
+	float *destination = result->data() + start;
+	for (size_t i = 0; i < local.size(); i += 2) {
+		destination[i] = originX + (local[i] * featherX) + (local[i + 1] * staffX);
+		destination[i + 1] = originY + (local[i] * featherY) + (local[i + 1] * staffY);
+	}
+}
+
+void NOAA_BarbBatch::Add(float x, float y, float direction, float speed, float size, bool southern) {
+	const BarbShape& shape = shapes[Bucket(speed)];
+
+	// Screen y is down. The staff points at where the wind is from, the feathers are a quarter turn clockwise of it
+	double angle = (direction * BARB_PI / 180.0) + northAngle;
+	float sine = (float)std::sin(angle);
+	float cosine = (float)std::cos(angle);
+	float side = southern ? -size : size;
+
+	originX = x;
+	originY = y;
+	staffX = sine * size;
+	staffY = -cosine * size;
+	featherX = cosine * side;
+	featherY = sine * side;
+
+	if (output == BARB_OUTPUT_LINES) {
+		Append(shape.lines, &lines);
+		Append(shape.triangles, &triangles);
+	}
+	else {
+		Append(shape.outline, &outlines);
+		outlineCounts.push_back((int)(shape.outline.size() / 2));
+		Append(shape.triangles, &triangles);
+	}
+	barbs++;
+}
@@ -0,0 +1,350 @@
+// Copyright(C) 2025 by Steven Adler
+//
+// This file is part of NOAA Weather plugin for OpenCPN.
+//
+// NOAA Weather plugin for OpenCPN is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// NOAA Weather plugin for OpenCPN is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with the NOAA Weather plugin for OpenCPN. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "noaa_weather_cache.h"
+
+// HashData
+#include "noaa_weather_snapshot.h"
+
+#include <algorithm>
+
+// One line per entry, tab separated:
+// url fetched accessed maxAge size eTag lastModified
+#define CACHE_INDEX "index.txt"
+#define CACHE_INDEX_VERSION "#NOAA cache 1"
+
+NOAA_ResponseCache::NOAA_ResponseCache() {
+	maxBytes = 0;
+	totalBytes = 0;
+	dirty = false;
+	savedAt = 0;
+}
+
+NOAA_ResponseCache::~NOAA_ResponseCache() {
+	Close();
+}
+
+bool NOAA_ResponseCache::Open(const wxString& cacheFolder, unsigned long long cacheSize) {
+	Close();
+
+	if (!wxFileName::Mkdir(cacheFolder, wxS_DIR_DEFAULT, wxPATH_MKDIR_FULL)) {
+		wxLogMessage("NOAA Weather Plugin, Error creating cache folder: %s", cacheFolder);
+		return false;
+	}
+
+	folder = cacheFolder;
+	maxBytes = cacheSize;
+	LoadIndex();
+	savedAt = (long long)wxDateTime::Now().GetTicks();
+	Evict(0);
+	return true;
+}
+
+void NOAA_ResponseCache::Close(void) {
+	Flush();
+	folder.Clear();
+	entries.clear();
+	totalBytes = 0;
+	dirty = false;
+}
+
+void NOAA_ResponseCache::Flush(void) {
+	if ((IsOpen()) && (dirty)) {
+		SaveIndex();
+	}
+}
+
+// Index changes are written once CACHE_INDEX_INTERVAL has passed since the last write, otherwise by Flush
+void NOAA_ResponseCache::Changed(long long now) {
+	dirty = true;
+	if (now - savedAt >= CACHE_INDEX_INTERVAL) {
+		SaveIndex();
+	}
+}
+
+bool NOAA_ResponseCache::ReadBody(std::map<wxString, CacheEntry>::iterator it, std::vector<char> *body) {
+	wxFile bodyFile;
+	if ((!bodyFile.Open(GetBodyFileName(it->first), wxFile::read)) || ((unsigned long long)bodyFile.Length() != it->second.size)) {
+		// Removed or truncated behind our back
+		Remove(it);
+		dirty = true;
+		return false;
+	}
+
+	body->resize(it->second.size);
+	if ((body->size() > 0) && (bodyFile.Read(body->data(), body->size()) != (ssize_t)body->size())) {
+		body->clear();
+		return false;
+	}
+	return true;
+}
+
+CACHE_STATUS NOAA_ResponseCache::Lookup(const wxString& url, long long now, long long maxStale, std::vector<char> *body, CacheEntry *entry) {
+	if (!IsOpen()) {
+		return CACHE_MISS;
+	}
+
+	wxString key = NormalizeUrl(url);
+	auto it = entries.find(key);
+	if (it == entries.end()) {
+		return CACHE_MISS;
+	}
+
+	// Too old to show, or never to be shown without asking the server, but a 304 can still spare
+	// downloading the body again
+	if ((it->second.maxAge == CACHE_NO_CACHE) ||
+		((maxStale >= 0) && (now > it->second.fetched + it->second.maxAge + maxStale))) {
+		*entry = it->second;
+		return CACHE_EXPIRED;
+	}
+
+	if (!ReadBody(it, body)) {
+		return CACHE_MISS;
+	}
+
+	it->second.accessed = now;
+	dirty = true;
+	*entry = it->second;
+
+	return (now < it->second.fetched + it->second.maxAge) ? CACHE_FRESH : CACHE_STALE;
+}
+
+void NOAA_ResponseCache::Store(const wxString& url, long long now, long long maxAge,
+	const wxString& eTag, const wxString& lastModified, const std::vector<char>& body) {
+	if (!IsOpen()) {
+		return;
+	}
+
+	wxString key = NormalizeUrl(url);
+	auto it = entries.find(key);
+	if ((maxAge == CACHE_NO_STORE) || (body.size() > maxBytes)) {
+		if (it != entries.end()) {
+			Remove(it);
+			Changed(now);
+		}
+		return;
+	}
+
+	if (it != entries.end()) {
+		totalBytes -= it->second.size;
+		entries.erase(it);
+	}
+	Evict(body.size());
+
+	wxString fileName = GetBodyFileName(key);
+	wxFile bodyFile;
+	if ((!bodyFile.Create(fileName, true)) ||
+		((body.size() > 0) && (bodyFile.Write(body.data(), body.size()) != body.size()))) {
+		wxLogMessage("NOAA Weather Plugin, Error writing cache file: %s", fileName);
+		bodyFile.Close();
+		wxRemoveFile(fileName);
+		Changed(now);
+		return;
+	}
+	bodyFile.Close();
+
+	CacheEntry entry;
+	entry.fetched = now;
+	entry.accessed = now;
+	entry.maxAge = maxAge;
+	entry.size = body.size();
+	entry.eTag = eTag;
+	entry.lastModified = lastModified;
+	entries[key] = entry;
+	totalBytes += entry.size;
+
+	Changed(now);
+}
+
+void NOAA_ResponseCache::Revalidate(const wxString& url, long long now, long long maxAge) {
+	if (!IsOpen()) {
+		return;
+	}
+
+	auto it = entries.find(NormalizeUrl(url));
+	if (it != entries.end()) {
+		it->second.fetched = now;
+		it->second.maxAge = maxAge;
+		Changed(now);
+	}
+}
+
+bool NOAA_ResponseCache::Read(const wxString& url, long long now, std::vector<char> *body) {
+	if (!IsOpen()) {
+		return false;
+	}
+
+	auto it = entries.find(NormalizeUrl(url));
+	if ((it == entries.end()) || (!ReadBody(it, body))) {
+		return false;
+	}
+	it->second.accessed = now;
+	dirty = true;
+	return true;
+}
+
+wxString NOAA_ResponseCache::NormalizeUrl(const wxString& url) {
+	wxURI uri(url);
+
+	wxString scheme = uri.GetScheme().Lower();
+	wxString normalized = scheme + "://" + uri.GetServer().Lower();
+
+	if ((uri.HasPort()) && (!((scheme == "http") && (uri.GetPort() == "80"))) &&
+		(!((scheme == "https") && (uri.GetPort() == "443")))) {
+		normalized += ":" + uri.GetPort();
+	}
+
+	wxString path = uri.GetPath();
+	if (path.IsEmpty()) {
+		path = "/";
+	}
+	normalized += path;
+
+	// The fragment is never sent to the server, the query parameters may be in any order
+	if (uri.HasQuery()) {
+		wxArrayString parameters = wxSplit(uri.GetQuery(), '&', '\0');
+		parameters.Sort();
+		normalized += "?" + wxJoin(parameters, '&', '\0');
+	}
+	return normalized;
+}
+
+long long NOAA_ResponseCache::ParseMaxAge(const wxString& cacheControl, long long defaultAge) {
+	// no-store overrides everything else, no-cache overrides max-age, whatever order they are listed in
+	long long result = defaultAge;
+	bool noCache = false;
+	wxStringTokenizer tokenizer(cacheControl.Lower(), ",");
+	while (tokenizer.HasMoreTokens()) {
+		wxString directive = tokenizer.GetNextToken().Trim(true).Trim(false);
+		wxLongLong_t maxAge;
+		if (directive == "no-store") {
+			return CACHE_NO_STORE;
+		}
+		else if (directive == "no-cache") {
+			noCache = true;
+		}
+		else if ((directive.StartsWith("max-age=")) && (directive.Mid(8).ToLongLong(&maxAge)) && (maxAge >= 0)) {
+			result = (long long)maxAge;
+		}
+	}
+	return noCache ? CACHE_NO_CACHE : result;
+}
+
+wxString NOAA_ResponseCache::GetBodyFileName(const wxString& key) const {
+	const wxScopedCharBuffer utf8 = key.utf8_str();
+	return wxFileName(folder, wxString::Format("%016llx.body", (unsigned long long)HashData(utf8.data(), utf8.length()))).GetFullPath();
+}
+
+void NOAA_ResponseCache::Remove(std::map<wxString, CacheEntry>::iterator it) {
+	wxRemoveFile(GetBodyFileName(it->first));
+	totalBytes -= it->second.size;
+	entries.erase(it);
+}
+
+// Evict the least recently used entries until there is room for the required number of bytes.
+// The cache holds at most a few hundred responses, so a linear scan for the oldest is sufficient
+void NOAA_ResponseCache::Evict(unsigned long long required) {
+	while ((!entries.empty()) && (totalBytes + required > maxBytes)) {
+		auto oldest = std::min_element(entries.begin(), entries.end(),
+			[](const std::pair<const wxString, CacheEntry>& a, const std::pair<const wxString, CacheEntry>& b) {
+				return a.second.accessed < b.second.accessed;
+			});
+		Remove(oldest);
+		dirty = true;
+	}
+}
+
+bool NOAA_ResponseCache::SaveIndex(void) {
+	wxString fileName = wxFileName(folder, CACHE_INDEX).GetFullPath();
+	wxString temporaryName = fileName + ".tmp";
+
+	wxFile indexFile;
+	if (!indexFile.Create(temporaryName, true)) {
+		wxLogMessage("NOAA Weather Plugin, Error writing cache index: %s", temporaryName);
+		return false;
+	}
+
+	wxString contents = CACHE_INDEX_VERSION "\n";
+	for (const auto& it : entries) {
+		contents += wxString::Format("%s\t%lld\t%lld\t%lld\t%llu\t%s\t%s\n", it.first,
+			it.second.fetched, it.second.accessed, it.second.maxAge, it.second.size,
+			it.second.eTag, it.second.lastModified);
+	}
+	bool success = indexFile.Write(contents, wxConvUTF8);
+	indexFile.Close();
+
+	if ((!success) || (!wxRenameFile(temporaryName, fileName, true))) {
+		wxRemoveFile(temporaryName);
+		return false;
+	}
+	dirty = false;
+	savedAt = (long long)wxDateTime::Now().GetTicks();
+	return true;
+}
+
+void NOAA_ResponseCache::LoadIndex(void) {
+	entries.clear();
+	totalBytes = 0;
+
+	wxString fileName = wxFileName(folder, CACHE_INDEX).GetFullPath();
+	wxTextFile indexFile;
+	if ((!wxFileExists(fileName)) || (!indexFile.Open(fileName, wxConvUTF8))) {
+		return;
+	}
+
+	// An index from a different version is discarded, the orphaned bodies are overwritten or left to be evicted
+	if (indexFile.GetFirstLine() != CACHE_INDEX_VERSION) {
+		return;
+	}
+
+	while (!indexFile.Eof()) {
+		wxString line = indexFile.GetNextLine();
+		wxStringTokenizer tokenizer(line, "\t", wxTOKEN_RET_EMPTY_ALL);
+		if (tokenizer.CountTokens() != 7) {
+			continue;
+		}
+
+		wxString key = tokenizer.GetNextToken();
+		wxLongLong_t fetched, accessed, maxAge;
+		wxULongLong_t size;
+		if ((!tokenizer.GetNextToken().ToLongLong(&fetched)) ||
+			(!tokenizer.GetNextToken().ToLongLong(&accessed)) ||
+			(!tokenizer.GetNextToken().ToLongLong(&maxAge)) ||
+			(!tokenizer.GetNextToken().ToULongLong(&size))) {
+			continue;
+		}
+
+		CacheEntry entry;
+		entry.fetched = fetched;
+		entry.accessed = accessed;
+		entry.maxAge = maxAge;
+		entry.size = size;
+		entry.eTag = tokenizer.GetNextToken();
+		entry.lastModified = tokenizer.GetNextToken();
+
+		// Skip entries whose body has gone missing
+		wxString bodyName = GetBodyFileName(key);
+		if ((!wxFileExists(bodyName)) || ((unsigned long long)wxFileName::GetSize(bodyName).GetValue() != entry.size)) {
+			continue;
+		}
+
+		entries[key] = entry;
+		totalBytes += entry.size;
+	}
+	indexFile.Close();
+}
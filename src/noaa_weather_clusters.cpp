@@ -0,0 +1,188 @@
+// Copyright(C) 2025 by Steven Adler
+//
+// This file is part of NOAA Weather plugin for OpenCPN.
+//
+// NOAA Weather plugin for OpenCPN is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// NOAA Weather plugin for OpenCPN is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with the NOAA Weather plugin for OpenCPN. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "noaa_weather_clusters.h"
+
+// NormalizeLongitude
+#include "noaa_weather_spatial.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+static bool CellOrder(const StationCluster& a, const StationCluster& b) {
+	return (a.row < b.row) || ((a.row == b.row) && (a.column < b.column));
+}
+
+static int CellRow(double latitude, double cellSize) {
+	int rows = (int)std::ceil(180.0 / cellSize);
+	int row = (int)std::floor((latitude + 90.0) / cellSize);
+	return (row < 0) ? 0 : (row >= rows) ? rows - 1 : row;
+}
+
+static int CellColumn(double longitude, double cellSize) {
+	int columns = (int)std::ceil(360.0 / cellSize);
+	int column = (int)std::floor((longitude + 180.0) / cellSize);
+	return (column < 0) ? 0 : (column >= columns) ? columns - 1 : column;
+}
+
+NOAA_ClusterPyramid::NOAA_ClusterPyramid() {
+}
+
+void NOAA_ClusterPyramid::Clear(void) {
+	for (int i = 0; i < CLUSTER_LEVELS; i++) {
+		levels[i].clear();
+	}
+}
+
+double NOAA_ClusterPyramid::CellSize(int level) {
+	return CLUSTER_CELL_SIZE * (double)(1 << level);
+}
+
+int NOAA_ClusterPyramid::SelectLevel(double pixelsPerDegree, double minimumPixels) {
+	if (CellSize(0) * pixelsPerDegree >= minimumPixels) {
+		return -1;
+	}
+	for (int level = 1; level < CLUSTER_LEVELS; level++) {
+		if (CellSize(level) * pixelsPerDegree >= minimumPixels) {
+			return level;
+		}
+	}
+	return CLUSTER_LEVELS - 1;
+}
+
+void NOAA_ClusterPyramid::Build(const NOAA_StationColumns& buoys) {
+	Clear();
+
+	// Every station starts as a cluster of one in its level 0 cell
+	std::vector<StationCluster> clusters;
+	clusters.reserve(buoys.Size());
+	for (unsigned int i = 0; i < buoys.Size(); i++) {
+		StationCluster cluster;
+		cluster.latitude = buoys.Latitude(i);
+		cluster.longitude = (float)NOAA_SpatialIndex::NormalizeLongitude(buoys.Longitude(i));
+		if ((std::isnan(cluster.latitude)) || (std::isnan(cluster.longitude))) {
+			continue;
+		}
+		cluster.count = 1;
+		cluster.station = i;
+		cluster.windCount = buoys.IsReported(i, OBSERVATION_WIND_SPEED) ? 1 : 0;
+		cluster.windSpeed = (cluster.windCount > 0) ? buoys.WindSpeed(i) : std::numeric_limits<float>::quiet_NaN();
+		cluster.row = CellRow(cluster.latitude, CellSize(0));
+		cluster.column = CellColumn(cluster.longitude, CellSize(0));
+		clusters.push_back(cluster);
+	}
+	std::sort(clusters.begin(), clusters.end(), CellOrder);
+	Merge(clusters, &levels[0]);
+
+	// The cells of each level are exactly four cells of the level below, so a level's clusters
+	// only need their cell halved (and resorting, as rows now interleave) before merging
+	for (int level = 1; level < CLUSTER_LEVELS; level++) {
+		clusters = levels[level - 1];
+		for (auto& it : clusters) {
+			it.row /= 2;
+			it.column /= 2;
+		}
+		std::sort(clusters.begin(), clusters.end(), CellOrder);
+		Merge(clusters, &levels[level]);
+	}
+}
+
+void NOAA_ClusterPyramid::Merge(std::vector<StationCluster>& clusters, std::vector<StationCluster> *merged) {
+	merged->clear();
+
+	size_t i = 0;
+	while (i < clusters.size()) {
+		StationCluster cluster = clusters[i];
+		double latitude = (double)cluster.latitude * cluster.count;
+		double longitude = (double)cluster.longitude * cluster.count;
+		double windSpeed = (cluster.windCount > 0) ? (double)cluster.windSpeed * cluster.windCount : 0.0;
+
+		size_t j = i + 1;
+		for (; (j < clusters.size()) && (clusters[j].row == cluster.row) && (clusters[j].column == cluster.column); j++) {
+			const StationCluster& other = clusters[j];
+			latitude += (double)other.latitude * other.count;
+			longitude += (double)other.longitude * other.count;
+			if (other.windCount > 0) {
+				windSpeed += (double)other.windSpeed * other.windCount;
+			}
+			cluster.count += other.count;
+			cluster.windCount += other.windCount;
+		}
+
+		// Cells never span the antimeridian, so the longitudes can simply be averaged
+		cluster.latitude = (float)(latitude / cluster.count);
+		cluster.longitude = (float)(longitude / cluster.count);
+		cluster.windSpeed = (cluster.windCount > 0) ? (float)(windSpeed / cluster.windCount) : std::numeric_limits<float>::quiet_NaN();
+		merged->push_back(cluster);
+		i = j;
+	}
+}
+
+void NOAA_ClusterPyramid::Query(int level, double latMin, double latMax, double lonMin, double lonMax, std::vector<unsigned int> *results) const {
+	results->clear();
+
+	if ((level < 0) || (level >= CLUSTER_LEVELS) || (levels[level].empty()) || (latMin > latMax)) {
+		return;
+	}
+
+	double width = lonMax - lonMin;
+	if (width < 0) {
+		width += 360.0;
+	}
+
+	if (width >= 360.0) {
+		QueryRange(level, latMin, latMax, -180.0, 180.0, results);
+		return;
+	}
+
+	double west = NOAA_SpatialIndex::NormalizeLongitude(lonMin);
+	double east = west + width;
+
+	if (east <= 180.0) {
+		QueryRange(level, latMin, latMax, west, east, results);
+	}
+	else {
+		QueryRange(level, latMin, latMax, west, 180.0, results);
+		QueryRange(level, latMin, latMax, -180.0, east - 360.0, results);
+	}
+}
+
+void NOAA_ClusterPyramid::QueryRange(int level, double latMin, double latMax, double lonMin, double lonMax, std::vector<unsigned int> *results) const {
+	const std::vector<StationCluster>& clusters = levels[level];
+	double cellSize = CellSize(level);
+
+	StationCluster key;
+	key.row = CellRow(latMin, cellSize);
+	key.column = CellColumn(lonMin, cellSize);
+	int lastRow = CellRow(latMax, cellSize);
+	int lastColumn = CellColumn(lonMax, cellSize);
+	int firstColumn = key.column;
+
+	// One binary search per row of cells, then a run of the row's clusters
+	for (; key.row <= lastRow; key.row++) {
+		key.column = firstColumn;
+		auto it = std::lower_bound(clusters.begin(), clusters.end(), key, CellOrder);
+		for (; (it != clusters.end()) && (it->row == key.row) && (it->column <= lastColumn); ++it) {
+			// The marker is drawn at the cluster's mean position, which may be outside the box in the edge cells
+			if ((it->latitude >= latMin) && (it->latitude <= latMax) && (it->longitude >= lonMin) && (it->longitude <= lonMax)) {
+				results->push_back((unsigned int)(it - clusters.begin()));
+			}
+		}
+	}
+}
@@ -0,0 +1,214 @@
+// Copyright(C) 2025 by Steven Adler
+//
+// This file is part of NOAA Weather plugin for OpenCPN.
+//
+// NOAA Weather plugin for OpenCPN is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// NOAA Weather plugin for OpenCPN is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with the NOAA Weather plugin for OpenCPN. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "noaa_weather_columns.h"
+
+#include <cstring>
+
+NOAA_StationColumns::NOAA_StationColumns() {
+}
+
+void NOAA_StationColumns::Clear(void) {
+	latitudes.clear();
+	longitudes.clear();
+	present.clear();
+	windDirections.clear();
+	windSpeeds.clear();
+	pressures.clear();
+	airTemperatures.clear();
+	ids.clear();
+	names.clear();
+	arena.clear();
+	stringOffsets.clear();
+	interned.clear();
+}
+
+void NOAA_StationColumns::Reserve(size_t count) {
+	latitudes.reserve(count);
+	longitudes.reserve(count);
+	present.reserve(count);
+	windDirections.reserve(count);
+	windSpeeds.reserve(count);
+	pressures.reserve(count);
+	airTemperatures.reserve(count);
+	ids.reserve(count);
+	names.reserve(count);
+}
+
+unsigned int NOAA_StationColumns::Add(const BuoyData& buoy) {
+	unsigned int index = (unsigned int)latitudes.size();
+
+	latitudes.push_back((float)buoy.latitude);
+	longitudes.push_back((float)buoy.longitude);
+
+	// Missing values are stored as zero, the presence mask is the only indication they are missing
+	uint8_t mask = 0;
+	if (::IsReported(buoy.windDirection)) {
+		mask |= OBSERVATION_WIND_DIRECTION;
+	}
+	if (::IsReported(buoy.windSpeed)) {
+		mask |= OBSERVATION_WIND_SPEED;
+	}
+	if (::IsReported(buoy.barometricPressure)) {
+		mask |= OBSERVATION_PRESSURE;
+	}
+	if (::IsReported(buoy.airTemperature)) {
+		mask |= OBSERVATION_AIR_TEMPERATURE;
+	}
+	present.push_back(mask);
+	windDirections.push_back((mask & OBSERVATION_WIND_DIRECTION) ? (int16_t)buoy.windDirection : 0);
+	windSpeeds.push_back((mask & OBSERVATION_WIND_SPEED) ? (float)buoy.windSpeed : 0.0f);
+	pressures.push_back((mask & OBSERVATION_PRESSURE) ? (float)buoy.barometricPressure : 0.0f);
+	airTemperatures.push_back((mask & OBSERVATION_AIR_TEMPERATURE) ? (float)buoy.airTemperature : 0.0f);
+
+	ids.push_back(Intern(buoy.id));
+	names.push_back(Intern(buoy.name));
+	return index;
+}
+
+BuoyData NOAA_StationColumns::Get(unsigned int index) const {
+	BuoyData buoy;
+	ClearObservation(&buoy);
+	buoy.id = Id(index);
+	buoy.name = Name(index);
+	buoy.latitude = latitudes[index];
+	buoy.longitude = longitudes[index];
+
+	if (IsReported(index, OBSERVATION_WIND_DIRECTION)) {
+		buoy.windDirection = windDirections[index];
+	}
+	if (IsReported(index, OBSERVATION_WIND_SPEED)) {
+		buoy.windSpeed = windSpeeds[index];
+	}
+	if (IsReported(index, OBSERVATION_PRESSURE)) {
+		buoy.barometricPressure = pressures[index];
+	}
+	if (IsReported(index, OBSERVATION_AIR_TEMPERATURE)) {
+		buoy.airTemperature = airTemperatures[index];
+	}
+	return buoy;
+}
+
+void NOAA_StationColumns::Compact(void) {
+	std::unordered_map<std::string, uint32_t>().swap(interned);
+}
+
+template <typename T>
+static void WriteBlock(const std::vector<T>& column, std::string *result) {
+	if (!column.empty()) {
+		result->append((const char *)column.data(), column.size() * sizeof(T));
+	}
+}
+
+template <typename T>
+static bool ReadBlock(const char **data, const char *end, size_t count, std::vector<T> *column) {
+	if ((size_t)(end - *data) / sizeof(T) < count) {
+		return false;
+	}
+	column->resize(count);
+	if (count > 0) {
+		memcpy(column->data(), *data, count * sizeof(T));
+	}
+	*data += count * sizeof(T);
+	return true;
+}
+
+// Layout, each block holding count values unless stated otherwise:
+// latitudes, longitudes, windSpeeds, pressures, airTemperatures, windDirections, present, ids, names,
+// the number of strings, their references and the size of the arena followed by the arena itself
+void NOAA_StationColumns::Write(std::string *result) const {
+	WriteBlock(latitudes, result);
+	WriteBlock(longitudes, result);
+	WriteBlock(windSpeeds, result);
+	WriteBlock(pressures, result);
+	WriteBlock(airTemperatures, result);
+	WriteBlock(windDirections, result);
+	WriteBlock(present, result);
+	WriteBlock(ids, result);
+	WriteBlock(names, result);
+
+	uint32_t stringCount = (uint32_t)stringOffsets.size();
+	result->append((const char *)&stringCount, sizeof(stringCount));
+	WriteBlock(stringOffsets, result);
+
+	uint32_t arenaSize = (uint32_t)arena.size();
+	result->append((const char *)&arenaSize, sizeof(arenaSize));
+	result->append(arena);
+}
+
+bool NOAA_StationColumns::Read(const char *data, size_t size, uint32_t count) {
+	Clear();
+
+	const char *end = data + size;
+	uint32_t stringCount = 0;
+	uint32_t arenaSize = 0;
+	bool success = ReadBlock(&data, end, count, &latitudes) && ReadBlock(&data, end, count, &longitudes) &&
+		ReadBlock(&data, end, count, &windSpeeds) && ReadBlock(&data, end, count, &pressures) &&
+		ReadBlock(&data, end, count, &airTemperatures) && ReadBlock(&data, end, count, &windDirections) &&
+		ReadBlock(&data, end, count, &present) && ReadBlock(&data, end, count, &ids) &&
+		ReadBlock(&data, end, count, &names) && ((size_t)(end - data) >= sizeof(stringCount));
+
+	if (success) {
+		memcpy(&stringCount, data, sizeof(stringCount));
+		data += sizeof(stringCount);
+		success = ReadBlock(&data, end, stringCount, &stringOffsets) && ((size_t)(end - data) >= sizeof(arenaSize));
+	}
+	if (success) {
+		memcpy(&arenaSize, data, sizeof(arenaSize));
+		data += sizeof(arenaSize);
+		success = ((size_t)(end - data) == arenaSize);
+	}
+	if (success) {
+		arena.assign(data, arenaSize);
+	}
+
+	// Every reference must stay within the arena and the string table
+	for (size_t i = 0; (success) && (i < stringOffsets.size()); i++) {
+		success = ((uint64_t)stringOffsets[i].offset + stringOffsets[i].length <= arena.size());
+	}
+	for (size_t i = 0; (success) && (i < count); i++) {
+		success = (ids[i] < stringCount) && (names[i] < stringCount);
+	}
+
+	if (!success) {
+		Clear();
+	}
+	return success;
+}
+
+uint32_t NOAA_StationColumns::Intern(const std::string& value) {
+	auto it = interned.find(value);
+	if (it != interned.end()) {
+		return it->second;
+	}
+
+	StringRef string;
+	string.offset = (uint32_t)arena.size();
+	string.length = (uint32_t)value.size();
+	arena.append(value);
+
+	uint32_t result = (uint32_t)stringOffsets.size();
+	stringOffsets.push_back(string);
+	interned.emplace(value, result);
+	return result;
+}
+
+std::string NOAA_StationColumns::String(uint32_t string) const {
+	const StringRef& ref = stringOffsets[string];
+	return std::string(arena.data() + ref.offset, ref.length);
+}
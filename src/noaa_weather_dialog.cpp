@@ -31,63 +31,37 @@
 wxBitmap pluginBitmap;
 
 // Constructor and destructor implementation
-NOAA_Plugin_Dialog::NOAA_Plugin_Dialog( wxWindow* parent, const wxString jsonResponse) : NOAA_Plugin_DialogBase(parent) {
+// The initial layers have already been extracted from the response by the plugin
+NOAA_Plugin_Dialog::NOAA_Plugin_Dialog( wxWindow* parent, const NOAA_Forecast& forecastData,
+	const std::vector<std::string>& availableLayers, const std::vector<char>& forecastResponse) :
+	NOAA_Plugin_DialogBase(parent), forecast(forecastData), available(availableLayers), response(forecastResponse) {
 	// Set the dialog's icon
 	wxIcon icon;
 	icon.CopyFromBitmap(pluginBitmap);
 	NOAA_Plugin_Dialog::SetIcon(icon);
 
-	// Populate the grid
-	wxJSONReader reader;
-	wxJSONValue root;
-	wxJSONValue values;
-	reader.Parse(jsonResponse, &root);
-
-	values = root["properties"]["temperature"]["values"];
-	// resize the grid with the correct number of rows.
-	dataGrid->AppendRows(values.Size() - dataGrid->GetNumberRows());
-
-	// Set row labels for date/time, insert cell values for temperature
-	for (int i = 0; i < values.Size(); i++) {
-		dataGrid->SetRowLabelValue(i, values[i]["validTime"].AsString());
-		// Don't need more than 2 decimal places !!
-		dataGrid->SetCellValue(i, 0, wxString::Format("%0.2f", values[i]["value"].AsDouble()));
-	}
-
-	// insert cell values for wind direction
-	values = root["properties"]["windDirection"]["values"];
-	for (int i = 0; i < values.Size(); i++) {
-		for (int j = 0; j < dataGrid->GetNumberRows(); j++) {
-			if (dataGrid->GetRowLabelValue(j) == values[i]["validTime"].AsString()) {
-				dataGrid->SetCellValue(j, 1, std::to_string(values[i]["value"].AsInt()));
-			}
+	// The grid reads the forecast through a table, so cells are only formatted when they are painted
+	table = new NOAA_ForecastTable(&forecast);
+	for (const auto& it : GetLayerNames()) {
+		int layer = forecast.FindLayer(it);
+		if (layer >= 0) {
+			table->ShowLayer(layer, true);
 		}
 	}
+	dataGrid->SetTable(table, true);
 
-	// and wind speed
-	values = root["properties"]["windSpeed"]["values"];
-	for (int i = 0; i < values.Size(); i++) {
-		for (int j = 0; j < dataGrid->GetNumberRows(); j++) {
-			if (dataGrid->GetRowLabelValue(j) == values[i]["validTime"].AsString()) {
-				// Don't need more than 2 decimal places !!
-				dataGrid->SetCellValue(j, 2, wxString::Format("%0.2f", values[i]["value"].AsDouble()));
-			}
-		}
-
-		// Trim the date/time display
-		// Existing format is "2021-12-05T17:00:00+00:00/PT1H"
-		// /PT1H I think means Period Time 1 hour, ie the next valid period
-		for (int j = 0; j < dataGrid->GetNumberRows(); j++) {
-			wxString label = wxString::Format("%s %s", dataGrid->GetRowLabelValue(j).Mid(0, 10),
-			dataGrid->GetRowLabelValue(j).Mid(11, 5));
-			dataGrid->SetRowLabelValue(j, label);
-		}
-	}
+	// Right click a column heading to choose the layers to display
+	dataGrid->Bind(wxEVT_GRID_LABEL_RIGHT_CLICK, &NOAA_Plugin_Dialog::OnLabelRightClick, this);
 }
 
 NOAA_Plugin_Dialog::~NOAA_Plugin_Dialog() {
 }
 
+// The forecast layers initially displayed by the dialog, in column order
+std::vector<std::string> NOAA_Plugin_Dialog::GetLayerNames(void) {
+	return { "temperature", "windDirection", "windSpeed" };
+}
+
 void NOAA_Plugin_Dialog::OnInit(wxInitDialogEvent& event) {
 
 	wxSize newSize = this->GetSize();
@@ -97,10 +71,63 @@ void NOAA_Plugin_Dialog::OnInit(wxInitDialogEvent& event) {
 	Fit();
 
 	// After we've fitted in everything adjust the dataGrid column widths
-	int colWidth = (int)((dataGrid->GetSize().GetWidth() - dataGrid->GetRowLabelSize() - wxSystemSettings::GetMetric(wxSYS_VSCROLL_X, NULL)) / 3);
-	dataGrid->SetColSize(0, colWidth);
-	dataGrid->SetColSize(1, colWidth);
-	dataGrid->SetColSize(2, colWidth);
+	if (dataGrid->GetNumberCols() > 0) {
+		int colWidth = (int)((dataGrid->GetSize().GetWidth() - dataGrid->GetRowLabelSize() - wxSystemSettings::GetMetric(wxSYS_VSCROLL_X, NULL)) / dataGrid->GetNumberCols());
+		for (int i = 0; i < dataGrid->GetNumberCols(); i++) {
+			dataGrid->SetColSize(i, colWidth);
+		}
+	}
+}
+
+// Show a menu of every layer in the response, toggling the one selected.
+// A layer that hasn't been extracted yet is extracted the first time it is shown
+void NOAA_Plugin_Dialog::OnLabelRightClick(wxGridEvent& event) {
+
+	if (available.empty()) {
+		return;
+	}
+
+	wxMenu menu;
+	for (size_t i = 0; i < available.size(); i++) {
+		int layer = forecast.FindLayer(available[i]);
+		wxString title = (layer >= 0) ? NOAA_ForecastTable::GetLayerTitle(forecast, layer) :
+			NOAA_ForecastTable::GetLayerTitle(available[i], std::string());
+		wxMenuItem *menuItem = menu.AppendCheckItem(wxID_HIGHEST + 1 + (int)i, title);
+		menuItem->Check((layer >= 0) && (table->IsLayerShown(layer)));
+	}
+
+	int id = dataGrid->GetPopupMenuSelectionFromUser(menu);
+	if (id == wxID_NONE) {
+		return;
+	}
+
+	const std::string& name = available[id - wxID_HIGHEST - 1];
+	int layer = forecast.FindLayer(name);
+	if (layer < 0) {
+		layer = ExtractLayer(name);
+		if (layer < 0) {
+			return;
+		}
+	}
+	table->ShowLayer(layer, !table->IsLayerShown(layer));
+	dataGrid->ForceRefresh();
+}
+
+int NOAA_Plugin_Dialog::ExtractLayer(const std::string& name) {
+	NOAA_Forecast extracted;
+	std::string error;
+	if ((!ExtractForecastLayers(response.data(), response.size(), std::vector<std::string>(1, name), &extracted, &error)) ||
+		(extracted.Layers() != 1)) {
+		wxLogMessage("NOAA Weather Plugin, Error extracting forecast layer %s: %s", name, error);
+		return -1;
+	}
+
+	// The new layer may extend the hourly axis
+	int previousRows = table->GetNumberRows();
+	int layer = (int)forecast.AddLayer(extracted, 0);
+	forecast.Build();
+	table->HoursChanged(previousRows);
+	return layer;
 }
 
 void NOAA_Plugin_Dialog::OnClose(wxCommandEvent &event) {
@@ -0,0 +1,477 @@
+// Copyright(C) 2025 by Steven Adler
+//
+// This file is part of NOAA Weather plugin for OpenCPN.
+//
+// NOAA Weather plugin for OpenCPN is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// NOAA Weather plugin for OpenCPN is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with the NOAA Weather plugin for OpenCPN. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "noaa_weather_download.h"
+
+// Seconds without receiving any data before an active download is abandoned. The watchdog is restarted
+// by every chunk or progress event, so slow links can take as long as they need while data is arriving
+#define DOWNLOAD_TIMEOUT 30
+
+// Seconds to wait for a cancelled download to report back before starting the next one
+#define CANCEL_TIMEOUT 2
+
+// Seconds after the last cached response before the cache index is written
+#define CACHE_FLUSH_DELAY 5
+
+NOAA_DownloadManager::NOAA_DownloadManager() : watchdog(this) {
+	sequence = 0;
+	active = false;
+	cancelling = false;
+	activeHandle = 0;
+	activeHttpStatus = 0;
+	activeNotModified = false;
+	activeMaxAge = 0;
+	activeStarted = 0;
+	cache = NULL;
+	statistics = NULL;
+
+	Connect(wxEVT_DOWNLOAD_EVENT, (wxObjectEventFunction)(wxEventFunction)&NOAA_DownloadManager::OnDownloadEvent);
+	Connect(wxEVT_TIMER, wxTimerEventHandler(NOAA_DownloadManager::OnTimer));
+#ifdef NOAA_USE_WEBREQUEST
+	Bind(wxEVT_WEBREQUEST_STATE, &NOAA_DownloadManager::OnRequestState, this);
+	Bind(wxEVT_WEBREQUEST_DATA, &NOAA_DownloadManager::OnRequestData, this);
+#endif
+}
+
+NOAA_DownloadManager::~NOAA_DownloadManager() {
+	CancelAll();
+#ifdef NOAA_USE_WEBREQUEST
+	Unbind(wxEVT_WEBREQUEST_DATA, &NOAA_DownloadManager::OnRequestData, this);
+	Unbind(wxEVT_WEBREQUEST_STATE, &NOAA_DownloadManager::OnRequestState, this);
+#endif
+	Disconnect(wxEVT_TIMER, wxTimerEventHandler(NOAA_DownloadManager::OnTimer));
+	Disconnect(wxEVT_DOWNLOAD_EVENT, (wxObjectEventFunction)(wxEventFunction)&NOAA_DownloadManager::OnDownloadEvent);
+}
+
+long NOAA_DownloadManager::Enqueue(const wxString& url, DOWNLOAD_PRIORITY priority, NOAA_DownloadCallback callback) {
+	return Enqueue(url, wxEmptyString, priority, callback);
+}
+
+long NOAA_DownloadManager::Enqueue(const wxString& url, const wxString& fileName, DOWNLOAD_PRIORITY priority, NOAA_DownloadCallback callback) {
+	DownloadJob job;
+	job.url = url;
+	job.fileName = fileName;
+	job.temporary = fileName.IsEmpty();
+	job.callback = callback;
+	job.cacheable = false;
+	job.maxAge = 0;
+	return Queue(job, priority);
+}
+
+long NOAA_DownloadManager::EnqueueCached(const wxString& url, long long maxAge, long long maxStale, DOWNLOAD_PRIORITY priority, NOAA_DownloadCallback callback) {
+	DownloadJob job;
+	job.url = url;
+	job.temporary = true;
+	job.callback = callback;
+	job.cacheable = true;
+	job.maxAge = maxAge;
+
+	if (cache != NULL) {
+		NOAA_DownloadResult result;
+		CacheEntry entry;
+		CACHE_STATUS cacheStatus = cache->Lookup(url, (long long)wxDateTime::Now().GetTicks(), maxStale, &result.response, &entry);
+		if (statistics != NULL) {
+			statistics->Increment((cacheStatus == CACHE_FRESH) ? COUNTER_CACHE_FRESH :
+				(cacheStatus == CACHE_STALE) ? COUNTER_CACHE_STALE : COUNTER_CACHE_MISS);
+		}
+
+		// Too old to show, the caller waits for the server. A 304 still returns the cached body
+		if (cacheStatus == CACHE_EXPIRED) {
+			job.eTag = entry.eTag;
+			job.lastModified = entry.lastModified;
+		}
+
+		if ((cacheStatus == CACHE_FRESH) || (cacheStatus == CACHE_STALE)) {
+			result.id = ++sequence;
+			result.url = url;
+			result.status = DOWNLOAD_COMPLETE;
+			result.errorCode = OCPN_DL_NO_ERROR;
+			result.httpStatus = 0;
+			if (callback) {
+				CallAfter([callback, result]() { callback(result); });
+			}
+
+			// Revalidate a stale copy in the background, the refreshed copy is used next time
+			if ((cacheStatus == CACHE_STALE) && (!IsPending(url))) {
+				job.callback = nullptr;
+				job.eTag = entry.eTag;
+				job.lastModified = entry.lastModified;
+				Queue(job, PRIORITY_BACKGROUND);
+			}
+			return result.id;
+		}
+	}
+	return Queue(job, priority);
+}
+
+long NOAA_DownloadManager::Queue(DownloadJob& job, DOWNLOAD_PRIORITY priority) {
+	job.id = ++sequence;
+	queue[std::make_pair((int)priority, job.id)] = job;
+	StartNext();
+	return job.id;
+}
+
+bool NOAA_DownloadManager::IsPending(const wxString& url) const {
+	if ((active) && (!cancelling) && (activeJob.url == url)) {
+		return true;
+	}
+	for (const auto& it : queue) {
+		if (it.second.url == url) {
+			return true;
+		}
+	}
+	return false;
+}
+
+bool NOAA_DownloadManager::Cancel(long id) {
+	// Still queued, simply remove it
+	for (auto it = queue.begin(); it != queue.end(); ++it) {
+		if (it->second.id == id) {
+			DownloadJob job = it->second;
+			queue.erase(it);
+			Post(job, DOWNLOAD_CANCELLED, OCPN_DL_ABORTED);
+			return true;
+		}
+	}
+
+	// The active download is aborted, the next download starts once OpenCPN confirms the abort
+	if ((active) && (!cancelling) && (activeJob.id == id)) {
+		Abort();
+		Post(activeJob, DOWNLOAD_CANCELLED, OCPN_DL_ABORTED);
+		return true;
+	}
+	return false;
+}
+
+void NOAA_DownloadManager::CancelAll(void) {
+	queue.clear();
+	watchdog.Stop();
+	// The cache writes any pending index changes when it is closed
+	cacheFlush.Cancel();
+
+	if ((active) && (!cancelling)) {
+		Abort();
+		watchdog.Stop();
+		if ((activeJob.temporary) && (!activeJob.fileName.IsEmpty())) {
+			wxRemoveFile(activeJob.fileName);
+		}
+	}
+	active = false;
+	cancelling = false;
+#ifdef NOAA_USE_WEBREQUEST
+	activeRequest = wxWebRequest();
+	activeResponse.clear();
+#endif
+
+	// Discard any callbacks that have been posted but not yet run
+	DeletePendingEvents();
+}
+
+bool NOAA_DownloadManager::IsBusy(void) const {
+	return (active) || (!queue.empty());
+}
+
+void NOAA_DownloadManager::StartNext(void) {
+	while ((!active) && (!queue.empty())) {
+		activeJob = queue.begin()->second;
+		queue.erase(queue.begin());
+
+		activeHttpStatus = 0;
+		activeNotModified = false;
+		activeMaxAge = activeJob.maxAge;
+		activeETag.Clear();
+		activeLastModified.Clear();
+
+		bool started;
+#ifdef NOAA_USE_WEBREQUEST
+		started = (activeJob.temporary) ? StartRequest() : StartFile();
+#else
+		started = StartFile();
+#endif
+
+		if (started) {
+			active = true;
+			cancelling = false;
+			activeStarted = NOAA_Statistics::Now();
+			watchdog.Start(DOWNLOAD_TIMEOUT * 1000, wxTIMER_ONE_SHOT);
+		}
+	}
+}
+
+bool NOAA_DownloadManager::StartFile(void) {
+	if (activeJob.temporary) {
+		activeJob.fileName = wxFileName::CreateTempFileName("noaa");
+	}
+
+	wxURI uri(activeJob.url);
+	_OCPN_DLStatus returnCode = OCPN_downloadFileBackground(uri.BuildURI(), activeJob.fileName, this, &activeHandle);
+
+	if ((returnCode == OCPN_DL_STARTED) || (returnCode == OCPN_DL_NO_ERROR)) {
+		return true;
+	}
+
+	wxLogMessage("NOAA Weather Plugin, Error %d starting download of URL: %s", returnCode, activeJob.url);
+	Post(activeJob, DOWNLOAD_FAILED, returnCode);
+	return false;
+}
+
+#ifdef NOAA_USE_WEBREQUEST
+bool NOAA_DownloadManager::StartRequest(void) {
+	activeResponse.clear();
+
+	wxURI uri(activeJob.url);
+	activeRequest = wxWebSession::GetDefault().CreateRequest(this, uri.BuildURI(), (int)activeJob.id);
+	if (!activeRequest.IsOk()) {
+		wxLogMessage("NOAA Weather Plugin, Error creating request for URL: %s", activeJob.url);
+		Post(activeJob, DOWNLOAD_FAILED, OCPN_DL_FAILED);
+		return false;
+	}
+
+	// The NWS api rejects requests without a User-Agent
+	activeRequest.SetHeader("User-Agent", "OpenCPN NOAA Weather Plugin");
+
+	// Conditional request, the server replies 304 if our cached copy is still current
+	if (!activeJob.eTag.IsEmpty()) {
+		activeRequest.SetHeader("If-None-Match", activeJob.eTag);
+	}
+	if (!activeJob.lastModified.IsEmpty()) {
+		activeRequest.SetHeader("If-Modified-Since", activeJob.lastModified);
+	}
+
+	// Don't let wxWidgets buffer the response, the data events append it to activeResponse
+	activeRequest.SetStorage(wxWebRequest::Storage_None);
+	activeRequest.Start();
+	return true;
+}
+#endif
+
+void NOAA_DownloadManager::Abort(void) {
+#ifdef NOAA_USE_WEBREQUEST
+	if (activeRequest.IsOk()) {
+		activeRequest.Cancel();
+	}
+	else {
+		OCPN_cancelDownloadFileBackground(activeHandle);
+	}
+#else
+	OCPN_cancelDownloadFileBackground(activeHandle);
+#endif
+	cancelling = true;
+	watchdog.Start(CANCEL_TIMEOUT * 1000, wxTIMER_ONE_SHOT);
+}
+
+void NOAA_DownloadManager::Complete(DOWNLOAD_STATUS status, int errorCode) {
+	watchdog.Stop();
+	active = false;
+
+	if ((statistics != NULL) && (!cancelling) && (status == DOWNLOAD_COMPLETE)) {
+		statistics->Record(STAT_DOWNLOAD, NOAA_Statistics::Now() - activeStarted);
+	}
+
+	if (cancelling) {
+		// The callback has already been told the download was cancelled
+		cancelling = false;
+		if ((activeJob.temporary) && (!activeJob.fileName.IsEmpty())) {
+			wxRemoveFile(activeJob.fileName);
+		}
+	}
+	else {
+		Post(activeJob, status, errorCode);
+	}
+
+#ifdef NOAA_USE_WEBREQUEST
+	activeRequest = wxWebRequest();
+	activeResponse.clear();
+#endif
+	StartNext();
+}
+
+void NOAA_DownloadManager::Post(const DownloadJob& job, DOWNLOAD_STATUS status, int errorCode) {
+	NOAA_DownloadResult result;
+	result.id = job.id;
+	result.url = job.url;
+	result.status = status;
+	result.errorCode = errorCode;
+	// Cancelled jobs may never have been the active transfer
+	result.httpStatus = (status == DOWNLOAD_CANCELLED) ? 0 : activeHttpStatus;
+
+	if ((job.temporary) && (job.fileName.IsEmpty())) {
+#ifdef NOAA_USE_WEBREQUEST
+		// Received in memory, hand over the buffer without copying it
+		if (status == DOWNLOAD_COMPLETE) {
+			result.response.swap(activeResponse);
+		}
+#endif
+	}
+	else if (job.temporary) {
+		// Read the response as raw bytes and clean up the temporary file
+		if ((status == DOWNLOAD_COMPLETE) && (wxFileExists(job.fileName))) {
+			wxFile dataFile;
+			if (dataFile.Open(job.fileName, wxFile::read)) {
+				result.response.resize(dataFile.Length());
+				if ((result.response.size() > 0) &&
+					(dataFile.Read(result.response.data(), result.response.size()) != (ssize_t)result.response.size())) {
+					result.response.clear();
+				}
+			}
+		}
+		if (status != DOWNLOAD_CANCELLED) {
+			wxRemoveFile(job.fileName);
+		}
+	}
+	else {
+		result.fileName = job.fileName;
+	}
+
+	// Keep a copy of cacheable responses, a 304 only refreshes the existing copy
+	if ((job.cacheable) && (cache != NULL) && (status == DOWNLOAD_COMPLETE)) {
+		long long now = (long long)wxDateTime::Now().GetTicks();
+		if (activeNotModified) {
+			if (statistics != NULL) {
+				statistics->Increment(COUNTER_CACHE_NOT_MODIFIED);
+			}
+			cache->Revalidate(job.url, now, activeMaxAge);
+			// Evicted (or deleted) since the conditional request was made, there is nothing to deliver
+			if (!cache->Read(job.url, now, &result.response)) {
+				wxLogMessage("NOAA Weather Plugin, Cached response no longer available: %s", job.url);
+				status = DOWNLOAD_FAILED;
+				result.status = status;
+				result.errorCode = OCPN_DL_FAILED;
+			}
+			else if (activeMaxAge == CACHE_NO_STORE) {
+				cache->Store(job.url, now, activeMaxAge, wxEmptyString, wxEmptyString, result.response);
+			}
+		}
+		else {
+			cache->Store(job.url, now, activeMaxAge, activeETag, activeLastModified, result.response);
+		}
+		NOAA_ResponseCache *responseCache = cache;
+		cacheFlush.Defer(CACHE_FLUSH_DELAY * 1000, [responseCache]() { responseCache->Flush(); });
+	}
+
+	if ((statistics != NULL) && (status == DOWNLOAD_COMPLETE)) {
+		statistics->Record(STAT_DOWNLOAD_BYTES, result.fileName.IsEmpty() ? result.response.size() :
+			(uint64_t)wxFileName::GetSize(result.fileName).GetValue());
+	}
+	if ((statistics != NULL) && (status == DOWNLOAD_FAILED)) {
+		statistics->Increment(COUNTER_DOWNLOAD_FAILED);
+	}
+
+	// Always deliver the result from the main event loop, never from within Enqueue or Cancel,
+	// so callbacks are free to queue further downloads
+	NOAA_DownloadCallback callback = job.callback;
+	if (callback) {
+		CallAfter([callback, result]() { callback(result); });
+	}
+}
+
+void NOAA_DownloadManager::OnDownloadEvent(OCPN_downloadEvent& event) {
+	if (!active) {
+		return;
+	}
+
+	// Still receiving data
+	if (event.getDLEventCondition() == OCPN_DL_EVENT_TYPE_PROGRESS) {
+		if (!cancelling) {
+			watchdog.Start(DOWNLOAD_TIMEOUT * 1000, wxTIMER_ONE_SHOT);
+		}
+		return;
+	}
+
+	if (event.getDLEventCondition() != OCPN_DL_EVENT_TYPE_END) {
+		return;
+	}
+
+#ifdef NOAA_USE_WEBREQUEST
+	// Not a transfer started by OpenCPN's downloader
+	if (activeRequest.IsOk()) {
+		return;
+	}
+#endif
+
+	if ((event.getDLEventStatus() == OCPN_DL_NO_ERROR) && (wxFileExists(activeJob.fileName))) {
+		Complete(DOWNLOAD_COMPLETE, OCPN_DL_NO_ERROR);
+	}
+	else {
+		wxLogMessage("NOAA Weather Plugin, Error %d downloading URL: %s", event.getDLEventStatus(), activeJob.url);
+		Complete(DOWNLOAD_FAILED, event.getDLEventStatus());
+	}
+}
+
+void NOAA_DownloadManager::OnTimer(wxTimerEvent& event) {
+	if (!active) {
+		return;
+	}
+
+	if (cancelling) {
+		wxLogMessage("NOAA Weather Plugin, Cancelled download did not complete: %s", activeJob.url);
+		Complete(DOWNLOAD_CANCELLED, OCPN_DL_ABORTED);
+	}
+	else {
+		wxLogMessage("NOAA Weather Plugin, Download stalled: %s", activeJob.url);
+		Abort();
+		Post(activeJob, DOWNLOAD_FAILED, OCPN_DL_FAILED);
+	}
+}
+
+#ifdef NOAA_USE_WEBREQUEST
+void NOAA_DownloadManager::OnRequestState(wxWebRequestEvent& event) {
+	// Ignore stragglers from requests that have already been abandoned
+	if ((!active) || (!activeRequest.IsOk()) || (event.GetRequest().GetId() != (int)activeJob.id)) {
+		return;
+	}
+
+	switch (event.GetState()) {
+		case wxWebRequest::State_Completed:
+			activeHttpStatus = event.GetResponse().GetStatus();
+			if (event.GetResponse().GetStatus() < 400) {
+				const wxWebResponse& response = event.GetResponse();
+				activeNotModified = (response.GetStatus() == 304);
+				activeMaxAge = NOAA_ResponseCache::ParseMaxAge(response.GetHeader("Cache-Control"), activeJob.maxAge);
+				activeETag = response.GetHeader("ETag");
+				activeLastModified = response.GetHeader("Last-Modified");
+				Complete(DOWNLOAD_COMPLETE, OCPN_DL_NO_ERROR);
+			}
+			else {
+				wxLogMessage("NOAA Weather Plugin, HTTP status %d downloading URL: %s", event.GetResponse().GetStatus(), activeJob.url);
+				Complete(DOWNLOAD_FAILED, OCPN_DL_FAILED);
+			}
+			break;
+		case wxWebRequest::State_Failed:
+		case wxWebRequest::State_Unauthorized:
+			wxLogMessage("NOAA Weather Plugin, Error %s downloading URL: %s", event.GetErrorDescription(), activeJob.url);
+			Complete(DOWNLOAD_FAILED, OCPN_DL_FAILED);
+			break;
+		case wxWebRequest::State_Cancelled:
+			Complete(DOWNLOAD_CANCELLED, OCPN_DL_ABORTED);
+			break;
+		default:
+			break;
+	}
+}
+
+void NOAA_DownloadManager::OnRequestData(wxWebRequestEvent& event) {
+	if ((!active) || (cancelling) || (!activeRequest.IsOk()) || (event.GetRequest().GetId() != (int)activeJob.id)) {
+		return;
+	}
+
+	const char *data = (const char *)event.GetDataBuffer();
+	activeResponse.insert(activeResponse.end(), data, data + event.GetDataSize());
+	watchdog.Start(DOWNLOAD_TIMEOUT * 1000, wxTIMER_ONE_SHOT);
+}
+#endif
@@ -0,0 +1,581 @@
+// Copyright(C) 2025 by Steven Adler
+//
+// This file is part of NOAA Weather plugin for OpenCPN.
+//
+// NOAA Weather plugin for OpenCPN is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// NOAA Weather plugin for OpenCPN is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with the NOAA Weather plugin for OpenCPN. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "noaa_weather_extractor.h"
+
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+// Objects and arrays nested deeper than this are rejected rather than risk exhausting the stack
+#define JSON_MAX_DEPTH 64
+
+// A string read in place, such as an object member's name. It points into the document unless the string
+// contains escape sequences, so comparing it allocates nothing. Only valid while its member is being visited
+typedef struct _jsontext {
+	const char *data;
+	size_t length;
+
+	bool Equals(const char *text, size_t textLength) const {
+		return (length == textLength) && (memcmp(data, text, length) == 0);
+	}
+	bool operator==(const char *text) const { return Equals(text, strlen(text)); }
+	bool operator!=(const char *text) const { return !Equals(text, strlen(text)); }
+	bool operator==(const std::string& text) const { return Equals(text.data(), text.size()); }
+	std::string ToString(void) const { return std::string(data, length); }
+} JsonText;
+
+// Minimal pull scanner over a JSON document. Values are either decoded or skipped in place,
+// nothing is allocated for the parts of the document that are skipped
+class JsonScanner {
+
+public:
+	JsonScanner(const char *data, size_t length) {
+		start = data;
+		position = data;
+		end = data + length;
+		// Ignore a UTF-8 byte order mark
+		if ((length >= 3) && (memcmp(data, "\xEF\xBB\xBF", 3) == 0)) {
+			position += 3;
+		}
+	}
+
+	// Consume the character if it is next, ignoring whitespace
+	bool Consume(char c) {
+		SkipWhitespace();
+		if ((position < end) && (*position == c)) {
+			position++;
+			return true;
+		}
+		return false;
+	}
+
+	bool Peek(char c) {
+		SkipWhitespace();
+		return (position < end) && (*position == c);
+	}
+
+	bool PeekNumber(void) {
+		SkipWhitespace();
+		return (position < end) && ((*position == '-') || ((*position >= '0') && (*position <= '9')));
+	}
+
+	bool AtEnd(void) {
+		SkipWhitespace();
+		return position == end;
+	}
+
+	bool Fail(const char *message) {
+		if (error.empty()) {
+			error = std::string(message) + " at offset " + std::to_string((long long)(position - start));
+		}
+		return false;
+	}
+
+	// Visit each member of an object, the visitor is positioned at the member's value
+	template <typename Visitor> bool ReadObject(Visitor visitor) {
+		if (!Consume('{')) {
+			return Fail("Expected an object");
+		}
+		if (Consume('}')) {
+			return true;
+		}
+		// Only used by names with escape sequences
+		std::string decoded;
+		do {
+			JsonText key = JsonText();
+			if (!ReadText(&key, &decoded)) {
+				return false;
+			}
+			if (!Consume(':')) {
+				return Fail("Expected ':'");
+			}
+			if (!visitor(key)) {
+				return false;
+			}
+		} while (Consume(','));
+		return (Consume('}')) || (Fail("Expected '}'"));
+	}
+
+	// Visit each element of an array
+	template <typename Visitor> bool ReadArray(Visitor visitor) {
+		if (!Consume('[')) {
+			return Fail("Expected an array");
+		}
+		if (Consume(']')) {
+			return true;
+		}
+		do {
+			if (!visitor()) {
+				return false;
+			}
+		} while (Consume(','));
+		return (Consume(']')) || (Fail("Expected ']'"));
+	}
+
+	// Read a string in place, decoding it into the buffer only if it contains escape sequences
+	bool ReadText(JsonText *key, std::string *decoded) {
+		SkipWhitespace();
+		const char *quote = position;
+		if (!Consume('"')) {
+			return Fail("Expected a string");
+		}
+		const char *run = position;
+		while ((position < end) && (*position != '"') && (*position != '\\')) {
+			position++;
+		}
+		if ((position < end) && (*position == '"')) {
+			key->data = run;
+			key->length = position - run;
+			position++;
+			return true;
+		}
+
+		position = quote;
+		if (!ReadString(decoded)) {
+			return false;
+		}
+		key->data = decoded->data();
+		key->length = decoded->size();
+		return true;
+	}
+
+	bool ReadString(std::string *value) {
+		if (!Consume('"')) {
+			return Fail("Expected a string");
+		}
+		value->clear();
+
+		while (position < end) {
+			// Copy runs of plain characters in one go
+			const char *run = position;
+			while ((position < end) && (*position != '"') && (*position != '\\')) {
+				position++;
+			}
+			value->append(run, position - run);
+
+			if (position == end) {
+				break;
+			}
+			if (*position == '"') {
+				position++;
+				return true;
+			}
+
+			// Escape sequence
+			position++;
+			if (position == end) {
+				break;
+			}
+			switch (*position++) {
+				case '"': value->push_back('"'); break;
+				case '\\': value->push_back('\\'); break;
+				case '/': value->push_back('/'); break;
+				case 'b': value->push_back('\b'); break;
+				case 'f': value->push_back('\f'); break;
+				case 'n': value->push_back('\n'); break;
+				case 'r': value->push_back('\r'); break;
+				case 't': value->push_back('\t'); break;
+				case 'u': {
+					unsigned int codePoint;
+					if (!ReadHex(&codePoint)) {
+						return Fail("Invalid unicode escape");
+					}
+					// Combine surrogate pairs
+					if ((codePoint >= 0xD800) && (codePoint <= 0xDBFF) && (end - position >= 6) &&
+						(position[0] == '\\') && (position[1] == 'u')) {
+						position += 2;
+						unsigned int low;
+						if ((!ReadHex(&low)) || (low < 0xDC00) || (low > 0xDFFF)) {
+							return Fail("Invalid surrogate pair");
+						}
+						codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + (low - 0xDC00);
+					}
+					AppendUtf8(codePoint, value);
+					break;
+				}
+				default:
+					return Fail("Invalid escape");
+			}
+		}
+		return Fail("Unterminated string");
+	}
+
+	// Locale independent number parsing
+	bool ReadNumber(double *value) {
+		SkipWhitespace();
+		const char *number = position;
+		bool negative = false;
+		if ((position < end) && (*position == '-')) {
+			negative = true;
+			position++;
+		}
+
+		unsigned long long mantissa = 0;
+		int exponent = 0;
+		int digits = 0;
+		while ((position < end) && (*position >= '0') && (*position <= '9')) {
+			if (mantissa < 1000000000000000000ULL) {
+				mantissa = (mantissa * 10) + (*position - '0');
+			}
+			else {
+				exponent++;
+			}
+			position++;
+			digits++;
+		}
+		if ((position < end) && (*position == '.')) {
+			position++;
+			while ((position < end) && (*position >= '0') && (*position <= '9')) {
+				if (mantissa < 1000000000000000000ULL) {
+					mantissa = (mantissa * 10) + (*position - '0');
+					exponent--;
+				}
+				position++;
+				digits++;
+			}
+		}
+		if (digits == 0) {
+			position = number;
+			return Fail("Expected a number");
+		}
+		if ((position < end) && ((*position == 'e') || (*position == 'E'))) {
+			position++;
+			bool negativeExponent = false;
+			if ((position < end) && ((*position == '+') || (*position == '-'))) {
+				negativeExponent = (*position == '-');
+				position++;
+			}
+			int explicitExponent = 0;
+			if ((position == end) || (*position < '0') || (*position > '9')) {
+				return Fail("Invalid exponent");
+			}
+			while ((position < end) && (*position >= '0') && (*position <= '9')) {
+				if (explicitExponent < 10000) {
+					explicitExponent = (explicitExponent * 10) + (*position - '0');
+				}
+				position++;
+			}
+			exponent += negativeExponent ? -explicitExponent : explicitExponent;
+		}
+
+		// Dividing by an exact power of ten is more accurate than multiplying by its inverse
+		double result = (double)mantissa;
+		if (exponent < 0) {
+			result /= pow(10.0, -exponent);
+		}
+		else if (exponent > 0) {
+			result *= pow(10.0, exponent);
+		}
+		*value = negative ? -result : result;
+		return true;
+	}
+
+	bool ReadLiteral(const char *literal) {
+		SkipWhitespace();
+		size_t length = strlen(literal);
+		if (((size_t)(end - position) < length) || (memcmp(position, literal, length) != 0)) {
+			return Fail("Invalid literal");
+		}
+		position += length;
+		return true;
+	}
+
+	// Skip over any value without decoding it
+	bool SkipValue(int depth = 0) {
+		if (depth > JSON_MAX_DEPTH) {
+			return Fail("Nesting too deep");
+		}
+		SkipWhitespace();
+		if (position == end) {
+			return Fail("Unexpected end of data");
+		}
+
+		switch (*position) {
+			case '{':
+				return ReadObject([this, depth](const JsonText&) { return SkipValue(depth + 1); });
+			case '[':
+				return ReadArray([this, depth]() { return SkipValue(depth + 1); });
+			case '"':
+				return SkipString();
+			case 't':
+				return ReadLiteral("true");
+			case 'f':
+				return ReadLiteral("false");
+			case 'n':
+				return ReadLiteral("null");
+			default: {
+				double number;
+				return ReadNumber(&number);
+			}
+		}
+	}
+
+	std::string error;
+
+private:
+	void SkipWhitespace(void) {
+		while ((position < end) && ((*position == ' ') || (*position == '\n') || (*position == '\r') || (*position == '\t'))) {
+			position++;
+		}
+	}
+
+	bool SkipString(void) {
+		position++;
+		while (position < end) {
+			if (*position == '\\') {
+				position += 2;
+				continue;
+			}
+			if (*position == '"') {
+				position++;
+				return true;
+			}
+			position++;
+		}
+		position = end;
+		return Fail("Unterminated string");
+	}
+
+	bool ReadHex(unsigned int *value) {
+		if (end - position < 4) {
+			return false;
+		}
+		*value = 0;
+		for (int i = 0; i < 4; i++) {
+			char c = *position++;
+			*value <<= 4;
+			if ((c >= '0') && (c <= '9')) {
+				*value |= c - '0';
+			}
+			else if ((c >= 'a') && (c <= 'f')) {
+				*value |= c - 'a' + 10;
+			}
+			else if ((c >= 'A') && (c <= 'F')) {
+				*value |= c - 'A' + 10;
+			}
+			else {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	static void AppendUtf8(unsigned int codePoint, std::string *value) {
+		if (codePoint < 0x80) {
+			value->push_back((char)codePoint);
+		}
+		else if (codePoint < 0x800) {
+			value->push_back((char)(0xC0 | (codePoint >> 6)));
+			value->push_back((char)(0x80 | (codePoint & 0x3F)));
+		}
+		else if (codePoint < 0x10000) {
+			value->push_back((char)(0xE0 | (codePoint >> 12)));
+			value->push_back((char)(0x80 | ((codePoint >> 6) & 0x3F)));
+			value->push_back((char)(0x80 | (codePoint & 0x3F)));
+		}
+		else {
+			value->push_back((char)(0xF0 | (codePoint >> 18)));
+			value->push_back((char)(0x80 | ((codePoint >> 12) & 0x3F)));
+			value->push_back((char)(0x80 | ((codePoint >> 6) & 0x3F)));
+			value->push_back((char)(0x80 | (codePoint & 0x3F)));
+		}
+	}
+
+	const char *start;
+	const char *position;
+	const char *end;
+};
+
+// Read one element of a layer's "values" array, {"validTime": "...", "value": 1.5}.
+// Elements whose value is not a number (eg. the weather or hazards layers) are skipped
+static bool ReadForecastValue(JsonScanner *scanner, bool *numeric, ForecastValue *value) {
+	JsonText validTime = JsonText();
+	std::string decoded;
+	bool hasTime = false;
+	*numeric = false;
+
+	if (!scanner->Peek('{')) {
+		return scanner->SkipValue();
+	}
+
+	bool success = scanner->ReadObject([scanner, &validTime, &decoded, &hasTime, numeric, value](const JsonText& key) {
+		if (key == "validTime") {
+			hasTime = true;
+			return scanner->ReadText(&validTime, &decoded);
+		}
+		if (key == "value") {
+			if (scanner->Peek('n')) {
+				*numeric = true;
+				value->value = std::numeric_limits<double>::quiet_NaN();
+				return scanner->ReadLiteral("null");
+			}
+			if (scanner->PeekNumber()) {
+				*numeric = true;
+				return scanner->ReadNumber(&value->value);
+			}
+			return scanner->SkipValue();
+		}
+		return scanner->SkipValue();
+	});
+
+	if ((success) && (*numeric)) {
+		*numeric = (hasTime) && (ParseValidTime(validTime.data, validTime.length, &value->start, &value->duration));
+	}
+	return success;
+}
+
+// Read a layer object, {"uom": "wmoUnit:degC", "values": [...]}.
+// If layer is negative, the layer is only added to the forecast once a numeric value is found
+static bool ReadForecastLayer(JsonScanner *scanner, const JsonText& name, int layer, NOAA_Forecast *forecast) {
+	if (!scanner->Peek('{')) {
+		return scanner->SkipValue();
+	}
+
+	std::string unit;
+	bool success = scanner->ReadObject([scanner, &name, &layer, &unit, forecast](const JsonText& key) {
+		if (key == "uom") {
+			if (!scanner->ReadString(&unit)) {
+				return false;
+			}
+			if (layer >= 0) {
+				forecast->SetLayerUnit(layer, unit);
+			}
+			return true;
+		}
+		if ((key == "values") && (scanner->Peek('['))) {
+			return scanner->ReadArray([scanner, &name, &layer, &unit, forecast]() {
+				ForecastValue value;
+				bool numeric;
+				if (!ReadForecastValue(scanner, &numeric, &value)) {
+					return false;
+				}
+				if (numeric) {
+					if (layer < 0) {
+						layer = (int)forecast->AddLayer(name.ToString(), std::vector<ForecastValue>());
+						forecast->SetLayerUnit(layer, unit);
+					}
+					forecast->AddValue(layer, value);
+				}
+				return true;
+			});
+		}
+		return scanner->SkipValue();
+	});
+	return success;
+}
+
+// Skip a layer object that wasn't requested, noting whether its first value is numeric
+// so the layer can be offered for extraction later
+static bool ProbeForecastLayer(JsonScanner *scanner, bool *numeric) {
+	*numeric = false;
+	if (!scanner->Peek('{')) {
+		return scanner->SkipValue();
+	}
+
+	return scanner->ReadObject([scanner, numeric](const JsonText& key) {
+		if ((key == "values") && (scanner->Peek('['))) {
+			bool first = true;
+			return scanner->ReadArray([scanner, numeric, &first]() {
+				if (!first) {
+					return scanner->SkipValue();
+				}
+				first = false;
+				ForecastValue value;
+				return ReadForecastValue(scanner, numeric, &value);
+			});
+		}
+		return scanner->SkipValue();
+	});
+}
+
+static int FindLayer(const NOAA_Forecast *forecast, const JsonText& name) {
+	for (size_t i = 0; i < forecast->Layers(); i++) {
+		if (name == forecast->LayerName(i)) {
+			return (int)i;
+		}
+	}
+	return -1;
+}
+
+bool ExtractForecastLayers(const char *data, size_t length, const std::vector<std::string>& layers,
+	NOAA_Forecast *forecast, std::string *error, std::vector<std::string> *available) {
+
+	forecast->Clear();
+	for (const auto& it : layers) {
+		forecast->AddLayer(it, std::vector<ForecastValue>());
+	}
+	if (available != NULL) {
+		available->clear();
+	}
+
+	JsonScanner scanner(data, length);
+
+	bool success = scanner.ReadObject([&scanner, &layers, forecast, available](const JsonText& key) {
+		if (key != "properties") {
+			return scanner.SkipValue();
+		}
+		return scanner.ReadObject([&scanner, &layers, forecast, available](const JsonText& key) {
+			int layer = -1;
+			if (!layers.empty()) {
+				layer = FindLayer(forecast, key);
+				if (layer < 0) {
+					if (available == NULL) {
+						return scanner.SkipValue();
+					}
+					bool numeric;
+					if (!ProbeForecastLayer(&scanner, &numeric)) {
+						return false;
+					}
+					if (numeric) {
+						available->push_back(key.ToString());
+					}
+					return true;
+				}
+			}
+
+			size_t before = forecast->Layers();
+			if (!ReadForecastLayer(&scanner, key, layer, forecast)) {
+				return false;
+			}
+			// Requested layers are listed when present, the others once a numeric value is found
+			if ((available != NULL) && ((layer >= 0) || (forecast->Layers() > before))) {
+				available->push_back(key.ToString());
+			}
+			return true;
+		});
+	});
+
+	if ((success) && (!scanner.AtEnd())) {
+		success = scanner.Fail("Unexpected data after the document");
+	}
+
+	if (!success) {
+		if (error != NULL) {
+			*error = scanner.error;
+		}
+		forecast->Clear();
+		if (available != NULL) {
+			available->clear();
+		}
+		return false;
+	}
+
+	forecast->Build();
+	return true;
+}
@@ -0,0 +1,243 @@
+// Copyright(C) 2025 by Steven Adler
+//
+// This file is part of NOAA Weather plugin for OpenCPN.
+//
+// NOAA Weather plugin for OpenCPN is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// NOAA Weather plugin for OpenCPN is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with the NOAA Weather plugin for OpenCPN. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "noaa_weather_forecast.h"
+
+#include <cmath>
+#include <climits>
+#include <limits>
+#include <algorithm>
+
+// Read exactly count digits
+static bool ReadDigits(const char **position, const char *end, int count, int *value) {
+	*value = 0;
+	for (int i = 0; i < count; i++) {
+		if ((*position >= end) || (**position < '0') || (**position > '9')) {
+			return false;
+		}
+		*value = (*value * 10) + (**position - '0');
+		(*position)++;
+	}
+	return true;
+}
+
+static bool Expect(const char **position, const char *end, char c) {
+	if ((*position >= end) || (**position != c)) {
+		return false;
+	}
+	(*position)++;
+	return true;
+}
+
+// Days since 1970-01-01 of a date in the proleptic Gregorian calendar
+static long long DaysFromCivil(int year, int month, int day) {
+	year -= (month <= 2) ? 1 : 0;
+	long long era = (year >= 0 ? year : year - 399) / 400;
+	long long yearOfEra = year - (era * 400);
+	long long dayOfYear = ((153 * (month + (month > 2 ? -3 : 9))) + 2) / 5 + day - 1;
+	long long dayOfEra = (yearOfEra * 365) + (yearOfEra / 4) - (yearOfEra / 100) + dayOfYear;
+	return (era * 146097) + dayOfEra - 719468;
+}
+
+bool ParseIsoDateTime(const char *text, size_t length, long long *seconds) {
+	const char *position = text;
+	const char *end = text + length;
+	int year, month, day, hour, minute, second = 0;
+
+	if ((!ReadDigits(&position, end, 4, &year)) || (!Expect(&position, end, '-')) ||
+		(!ReadDigits(&position, end, 2, &month)) || (!Expect(&position, end, '-')) ||
+		(!ReadDigits(&position, end, 2, &day)) || (!Expect(&position, end, 'T')) ||
+		(!ReadDigits(&position, end, 2, &hour)) || (!Expect(&position, end, ':')) ||
+		(!ReadDigits(&position, end, 2, &minute))) {
+		return false;
+	}
+
+	// Seconds are optional
+	if ((position < end) && (*position == ':')) {
+		position++;
+		if (!ReadDigits(&position, end, 2, &second)) {
+			return false;
+		}
+	}
+
+	if ((month < 1) || (month > 12) || (day < 1) || (day > 31) || (hour > 23) || (minute > 59) || (second > 60)) {
+		return false;
+	}
+
+	long long offset = 0;
+	if ((position < end) && ((*position == '+') || (*position == '-'))) {
+		int sign = (*position == '-') ? -1 : 1;
+		int offsetHours, offsetMinutes = 0;
+		position++;
+		if (!ReadDigits(&position, end, 2, &offsetHours)) {
+			return false;
+		}
+		if ((position < end) && (*position == ':')) {
+			position++;
+		}
+		if ((position < end) && (!ReadDigits(&position, end, 2, &offsetMinutes))) {
+			return false;
+		}
+		offset = sign * ((offsetHours * 3600LL) + (offsetMinutes * 60LL));
+	}
+	else if ((position < end) && (*position == 'Z')) {
+		position++;
+	}
+
+	if (position != end) {
+		return false;
+	}
+
+	*seconds = (DaysFromCivil(year, month, day) * 86400LL) + (hour * 3600LL) + (minute * 60LL) + second - offset;
+	return true;
+}
+
+bool ParseIsoDuration(const char *text, size_t length, long long *seconds) {
+	const char *position = text;
+	const char *end = text + length;
+
+	if (!Expect(&position, end, 'P')) {
+		return false;
+	}
+
+	bool time = false;
+	bool any = false;
+	long long total = 0;
+
+	while (position < end) {
+		if (*position == 'T') {
+			if (time) {
+				return false;
+			}
+			time = true;
+			position++;
+			continue;
+		}
+
+		long long value = 0;
+		const char *digits = position;
+		while ((position < end) && (*position >= '0') && (*position <= '9')) {
+			value = (value * 10) + (*position - '0');
+			if (value > INT_MAX) {
+				return false;
+			}
+			position++;
+		}
+		if ((position == digits) || (position == end)) {
+			return false;
+		}
+
+		switch (*position) {
+			case 'W': if (time) return false; total += value * 7 * 86400; break;
+			case 'D': if (time) return false; total += value * 86400; break;
+			case 'H': if (!time) return false; total += value * 3600; break;
+			case 'M': if (!time) return false; total += value * 60; break;
+			case 'S': if (!time) return false; total += value; break;
+			// Years and months have no fixed length and are not used by NWS
+			default: return false;
+		}
+		position++;
+		any = true;
+	}
+
+	*seconds = total;
+	return any;
+}
+
+bool ParseValidTime(const char *text, size_t length, long long *start, long long *duration) {
+	size_t separator = 0;
+	while ((separator < length) && (text[separator] != '/')) {
+		separator++;
+	}
+	if (separator == length) {
+		return false;
+	}
+
+	return (ParseIsoDateTime(text, separator, start)) &&
+		(ParseIsoDuration(text + separator + 1, length - separator - 1, duration)) && (*duration > 0);
+}
+
+NOAA_Forecast::NOAA_Forecast() {
+	Clear();
+}
+
+void NOAA_Forecast::Clear(void) {
+	layers.clear();
+	origin = 0;
+	hours = 0;
+}
+
+size_t NOAA_Forecast::AddLayer(const std::string& name, const std::vector<ForecastValue>& values) {
+	ForecastLayer layer;
+	layer.name = name;
+	layer.values = values;
+	layers.push_back(layer);
+	return layers.size() - 1;
+}
+
+size_t NOAA_Forecast::AddLayer(const NOAA_Forecast& source, size_t layer) {
+	size_t result = AddLayer(source.layers[layer].name, source.layers[layer].values);
+	layers[result].unit = source.layers[layer].unit;
+	return result;
+}
+
+void NOAA_Forecast::AddValue(size_t layer, const ForecastValue& value) {
+	layers[layer].values.push_back(value);
+}
+
+int NOAA_Forecast::FindLayer(const std::string& name) const {
+	for (size_t i = 0; i < layers.size(); i++) {
+		if (layers[i].name == name) {
+			return (int)i;
+		}
+	}
+	return -1;
+}
+
+void NOAA_Forecast::Build(void) {
+	// The axis spans the earliest start to the latest end of any interval, aligned to the hour
+	long long first = LLONG_MAX;
+	long long last = LLONG_MIN;
+	for (const auto& layer : layers) {
+		for (const auto& value : layer.values) {
+			first = std::min(first, value.start);
+			last = std::max(last, value.start + value.duration);
+		}
+	}
+
+	if (first >= last) {
+		origin = 0;
+		hours = 0;
+	}
+	else {
+		origin = first - (((first % FORECAST_STEP) + FORECAST_STEP) % FORECAST_STEP);
+		hours = (size_t)std::min<long long>((last - origin + FORECAST_STEP - 1) / FORECAST_STEP, FORECAST_MAX_HOURS);
+	}
+
+	// Each interval is written directly to the hours it covers, there is no searching for matching times
+	for (auto& layer : layers) {
+		layer.hourly.assign(hours, std::numeric_limits<double>::quiet_NaN());
+		for (const auto& value : layer.values) {
+			long long hour = (value.start - origin) / FORECAST_STEP;
+			long long endHour = (value.start + value.duration - origin + FORECAST_STEP - 1) / FORECAST_STEP;
+			for (long long i = std::max(hour, 0LL); i < std::min(endHour, (long long)hours); i++) {
+				layer.hourly[(size_t)i] = value.value;
+			}
+		}
+	}
+}
@@ -0,0 +1,187 @@
+// Copyright(C) 2025 by Steven Adler
+//
+// This file is part of NOAA Weather plugin for OpenCPN.
+//
+// NOAA Weather plugin for OpenCPN is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// NOAA Weather plugin for OpenCPN is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with the NOAA Weather plugin for OpenCPN. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "noaa_weather_history.h"
+
+// NDBC_Tokenizer, ParseColumn
+#include "noaa_weather_parser.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+// Days since 1970-01-01 of a proleptic Gregorian date
+static int64_t DaysFromCivil(int year, int month, int day) {
+	year -= (month <= 2) ? 1 : 0;
+	int64_t era = ((year >= 0) ? year : year - 399) / 400;
+	int64_t yearOfEra = year - (era * 400);
+	int64_t dayOfYear = ((153 * (month + ((month > 2) ? -3 : 9))) + 2) / 5 + day - 1;
+	int64_t dayOfEra = (yearOfEra * 365) + (yearOfEra / 4) - (yearOfEra / 100) + dayOfYear;
+	return (era * 146097) + dayOfEra - 719468;
+}
+
+int64_t UtcSeconds(int year, int month, int day, int hour, int minute) {
+	return (DaysFromCivil(year, month, day) * 86400) + (hour * 3600) + (minute * 60);
+}
+
+NOAA_StationHistory::NOAA_StationHistory(size_t capacity) {
+	this->capacity = (capacity > 0) ? capacity : 1;
+	first = 0;
+	count = 0;
+}
+
+void NOAA_StationHistory::Clear(void) {
+	first = 0;
+	count = 0;
+}
+
+void NOAA_StationHistory::Append(int64_t time, const float *record) {
+	// The buffers are allocated on first use, a station without observations costs nothing
+	if (times.empty()) {
+		times.resize(capacity);
+		for (int i = 0; i < REALTIME_COLUMNS; i++) {
+			values[i].resize(capacity);
+		}
+	}
+
+	size_t slot;
+	if (count < capacity) {
+		slot = Slot(count);
+		count++;
+	}
+	else {
+		slot = first;
+		first = (first + 1) % capacity;
+	}
+
+	times[slot] = time;
+	for (int i = 0; i < REALTIME_COLUMNS; i++) {
+		values[i][slot] = record[i];
+	}
+}
+
+size_t NOAA_StationHistory::Update(const char *data, size_t length) {
+	const float missing = std::numeric_limits<float>::quiet_NaN();
+	int64_t latest = LatestTime();
+	bool empty = Empty();
+
+	// The new observations, newest first as in the file
+	std::vector<int64_t> newTimes;
+	std::vector<float> newValues;
+
+	NDBC_Tokenizer tokenizer(data, length);
+	while (tokenizer.NextLine()) {
+		if (tokenizer.IsHeader()) {
+			continue;
+		}
+
+		const char *column;
+		size_t columnLength;
+		int date[5];
+		int j = 0;
+		for (; (j < 5) && (tokenizer.NextColumn(&column, &columnLength)); j++) {
+			if (!ParseColumn(column, columnLength, &date[j])) {
+				break;
+			}
+		}
+		if (j < 5) {
+			continue;
+		}
+
+		int64_t time = UtcSeconds(date[0], date[1], date[2], date[3], date[4]);
+		if ((!empty) && (time <= latest)) {
+			// Everything from here on is already stored
+			break;
+		}
+
+		// Columns beyond the end of a short line are missing
+		float record[REALTIME_COLUMNS];
+		for (j = 0; j < REALTIME_COLUMNS; j++) {
+			double value;
+			record[j] = ((tokenizer.NextColumn(&column, &columnLength)) && (ParseColumn(column, columnLength, &value))) ? (float)value : missing;
+		}
+
+		newTimes.push_back(time);
+		newValues.insert(newValues.end(), record, record + REALTIME_COLUMNS);
+	}
+
+	// Only the newest observations fit if there are more than the capacity
+	size_t appended = std::min(newTimes.size(), capacity);
+	for (size_t i = appended; i > 0; i--) {
+		Append(newTimes[i - 1], &newValues[(i - 1) * REALTIME_COLUMNS]);
+	}
+	return appended;
+}
+
+bool NOAA_StationHistory::Change(REALTIME_COLUMN column, int64_t period, float *latest, float *change) const {
+	// The latest reported value
+	size_t i = count;
+	while ((i > 0) && (std::isnan(Value(i - 1, column)))) {
+		i--;
+	}
+	if (i == 0) {
+		return false;
+	}
+	size_t newest = i - 1;
+	int64_t target = Time(newest) - period;
+
+	// The reported value nearest to, but no later than, the start of the period
+	for (i = newest; i > 0; i--) {
+		if ((Time(i - 1) <= target) && (!std::isnan(Value(i - 1, column)))) {
+			*latest = Value(newest, column);
+			*change = *latest - Value(i - 1, column);
+			return true;
+		}
+	}
+	return false;
+}
+
+NOAA_HistoryStore::NOAA_HistoryStore(size_t stations) {
+	maxStations = (stations > 0) ? stations : 1;
+	sequence = 0;
+}
+
+NOAA_StationHistory& NOAA_HistoryStore::Get(const std::string& id) {
+	sequence++;
+
+	auto it = histories.find(id);
+	if (it == histories.end()) {
+		// A handful of stations, so a linear scan for the least recently used is sufficient
+		if (histories.size() >= maxStations) {
+			auto oldest = std::min_element(histories.begin(), histories.end(),
+				[](const std::pair<const std::string, Entry>& a, const std::pair<const std::string, Entry>& b) {
+					return a.second.used < b.second.used;
+				});
+			histories.erase(oldest);
+		}
+		Entry entry = Entry();
+		it = histories.insert(std::make_pair(id, entry)).first;
+	}
+
+	it->second.used = sequence;
+	return it->second.history;
+}
+
+NOAA_StationHistory *NOAA_HistoryStore::Find(const std::string& id) {
+	auto it = histories.find(id);
+	if (it == histories.end()) {
+		return NULL;
+	}
+	it->second.used = ++sequence;
+	return &it->second.history;
+}
@@ -0,0 +1,103 @@
+// Copyright(C) 2025 by Steven Adler
+//
+// This file is part of NOAA Weather plugin for OpenCPN.
+//
+// NOAA Weather plugin for OpenCPN is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// NOAA Weather plugin for OpenCPN is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with the NOAA Weather plugin for OpenCPN. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "noaa_weather_hittest.h"
+
+#include <algorithm>
+
+NOAA_HitTest::NOAA_HitTest(int bucketSize) : bucketSize(bucketSize) {
+	columns = 0;
+	rows = 0;
+}
+
+void NOAA_HitTest::Reset(int width, int height, int largest) {
+	if (largest > 0) {
+		bucketSize = largest;
+	}
+	columns = std::max(1, (width + bucketSize - 1) / bucketSize);
+	rows = std::max(1, (height + bucketSize - 1) / bucketSize);
+
+	// Vectors retain their capacity, so nothing is allocated once the first frames have been drawn
+	buckets.assign(columns * rows, -1);
+	nodes.clear();
+	icons.clear();
+}
+
+void NOAA_HitTest::Add(unsigned int index, int x, int y, int width, int height) {
+	Icon icon;
+	icon.index = index;
+	icon.left = x;
+	icon.top = y;
+	icon.right = x + width;
+	icon.bottom = y + height;
+
+	// Ignore icons that are entirely off the canvas
+	int firstColumn = std::max(0, icon.left / bucketSize);
+	int lastColumn = std::min(columns - 1, (icon.right - 1) / bucketSize);
+	int firstRow = std::max(0, icon.top / bucketSize);
+	int lastRow = std::min(rows - 1, (icon.bottom - 1) / bucketSize);
+
+	if ((icon.right <= 0) || (icon.bottom <= 0) || (firstColumn > lastColumn) || (firstRow > lastRow)) {
+		return;
+	}
+
+	unsigned int iconIndex = (unsigned int)icons.size();
+	icons.push_back(icon);
+
+	for (int row = firstRow; row <= lastRow; row++) {
+		for (int column = firstColumn; column <= lastColumn; column++) {
+			int bucket = (row * columns) + column;
+			Node node;
+			node.icon = iconIndex;
+			node.next = buckets[bucket];
+			buckets[bucket] = (int)nodes.size();
+			nodes.push_back(node);
+		}
+	}
+}
+
+bool NOAA_HitTest::Find(int x, int y, unsigned int *index) const {
+	if ((x < 0) || (y < 0) || (buckets.empty())) {
+		return false;
+	}
+
+	int column = x / bucketSize;
+	int row = y / bucketSize;
+	if ((column >= columns) || (row >= rows)) {
+		return false;
+	}
+
+	bool found = false;
+	long long nearest = 0;
+
+	for (int n = buckets[(row * columns) + column]; n != -1; n = nodes[n].next) {
+		const Icon& icon = icons[nodes[n].icon];
+		if ((x >= icon.left) && (x < icon.right) && (y >= icon.top) && (y < icon.bottom)) {
+			// Compare squared distances to the icon centre, doubled to stay in integers
+			long long dx = (2LL * x) - (icon.left + icon.right);
+			long long dy = (2LL * y) - (icon.top + icon.bottom);
+			long long distance = (dx * dx) + (dy * dy);
+			if ((!found) || (distance < nearest)) {
+				found = true;
+				nearest = distance;
+				*index = icon.index;
+			}
+		}
+	}
+	return found;
+}
@@ -0,0 +1,94 @@
+// Copyright(C) 2025 by Steven Adler
+//
+// This file is part of NOAA Weather plugin for OpenCPN.
+//
+// NOAA Weather plugin for OpenCPN is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// NOAA Weather plugin for OpenCPN is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with the NOAA Weather plugin for OpenCPN. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "noaa_weather_icons.h"
+
+#include <algorithm>
+
+// The icon sizes, a raster is never created at any other size
+static const int iconSizes[] = { 16, 20, 24, 32, 40, 48, 64, 96 };
+
+NOAA_IconCache::NOAA_IconCache(NOAA_GLRenderer *renderer) {
+	this->renderer = renderer;
+	sequence = 0;
+}
+
+int NOAA_IconCache::AddIcon(const wxString& svgFile) {
+	svgFiles.push_back(svgFile);
+	return (int)svgFiles.size() - 1;
+}
+
+int NOAA_IconCache::SelectSize(double chartScale, double scaleFactor) {
+	// Larger icons at harbour scales, smaller ones when zoomed out to ocean scales.
+	// By observation, chart scales range from about 1:100,000 to 1:5,000,000 and beyond
+	int size = (chartScale < 200000) ? 32 : (chartScale < 2000000) ? 24 : 20;
+
+	if (scaleFactor > 1.0) {
+		size = (int)((size * scaleFactor) + 0.5);
+	}
+
+	for (auto it : iconSizes) {
+		if (it >= size) {
+			return it;
+		}
+	}
+	return iconSizes[(sizeof(iconSizes) / sizeof(iconSizes[0])) - 1];
+}
+
+const IconRaster& NOAA_IconCache::Get(int icon, int size) {
+	sequence++;
+
+	for (auto& it : rasters) {
+		if ((it.icon == icon) && (it.size == size)) {
+			it.used = sequence;
+			return it;
+		}
+	}
+
+	// The cache holds a handful of rasters, so a linear scan for the least recently used is sufficient
+	if (rasters.size() >= ICON_CACHE_CAPACITY) {
+		auto oldest = std::min_element(rasters.begin(), rasters.end(),
+			[](const IconRaster& a, const IconRaster& b) { return a.used < b.used; });
+		released.push_back(*oldest);
+		released.back().bitmap = wxNullBitmap;
+		rasters.erase(oldest);
+	}
+
+	IconRaster raster;
+	raster.icon = icon;
+	raster.size = size;
+	raster.used = sequence;
+	raster.bitmap = GetBitmapFromSVGFile(svgFiles[icon], size, size);
+	if (!raster.bitmap.IsOk()) {
+		wxLogMessage("NOAA Weather Plugin, Error rasterizing icon: %s", svgFiles[icon]);
+	}
+
+	auto slot = std::find_if(released.begin(), released.end(),
+		[size](const IconRaster& a) { return a.size == size; });
+	if (slot != released.end()) {
+		raster.symbol = slot->symbol;
+		renderer->ReplaceSymbol(raster.symbol, raster.bitmap);
+		released.erase(slot);
+	}
+	else {
+		raster.symbol = renderer->AddSymbol(raster.bitmap);
+	}
+
+	rasters.push_back(raster);
+	return rasters.back();
+}
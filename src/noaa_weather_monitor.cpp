@@ -0,0 +1,126 @@
+// Copyright(C) 2025 by Steven Adler
+//
+// This file is part of NOAA Weather plugin for OpenCPN.
+//
+// NOAA Weather plugin for OpenCPN is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// NOAA Weather plugin for OpenCPN is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with the NOAA Weather plugin for OpenCPN. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "noaa_weather_monitor.h"
+
+#include <algorithm>
+#include <cmath>
+
+#define MONITOR_PI 3.14159265358979323846
+
+NOAA_PositionMonitor::NOAA_PositionMonitor(double cellDistance, int confirmations, long long forecastAge) {
+	this->cellDistance = cellDistance;
+	this->confirmations = (confirmations > 0) ? confirmations : 1;
+	this->forecastAge = forecastAge;
+	Reset();
+}
+
+void NOAA_PositionMonitor::Reset(void) {
+	anchored = false;
+	anchorLatitude = 0;
+	anchorLongitude = 0;
+	forecastTime = 0;
+	moved = 0;
+	active.clear();
+	entering.clear();
+	leaving.clear();
+}
+
+double NOAA_PositionMonitor::Distance(double latitude0, double longitude0, double latitude1, double longitude1) {
+	double longitude = std::fabs(longitude1 - longitude0);
+	if (longitude > 180.0) {
+		longitude = 360.0 - longitude;
+	}
+	double x = longitude * std::cos(((latitude0 + latitude1) / 2.0) * MONITOR_PI / 180.0) * 111.32;
+	double y = (latitude1 - latitude0) * 110.57;
+	return std::sqrt((x * x) + (y * y));
+}
+
+void NOAA_PositionMonitor::Update(double latitude, double longitude, const std::vector<std::string>& alerts,
+	long long now, MonitorUpdate *update) {
+
+	update->forecast = false;
+	update->raised.clear();
+	update->cleared.clear();
+
+	// No fix
+	if ((std::isnan(latitude)) || (std::isnan(longitude))) {
+		return;
+	}
+
+	// The first fix establishes the cell straight away, a move to another cell must be confirmed
+	if (!anchored) {
+		moved = confirmations;
+	}
+	else if (Distance(anchorLatitude, anchorLongitude, latitude, longitude) > cellDistance) {
+		moved++;
+	}
+	else {
+		moved = 0;
+	}
+
+	if (moved >= confirmations) {
+		anchored = true;
+		anchorLatitude = latitude;
+		anchorLongitude = longitude;
+		forecastTime = now;
+		moved = 0;
+		update->forecast = true;
+	}
+	else if ((anchored) && (now - forecastTime >= forecastAge)) {
+		forecastTime = now;
+		update->forecast = true;
+	}
+
+	// Alerts the vessel has entered, raised once they have applied for enough consecutive fixes
+	for (const auto& it : alerts) {
+		leaving.erase(it);
+		if (active.count(it) == 0) {
+			if (++entering[it] >= confirmations) {
+				entering.erase(it);
+				active.insert(it);
+				update->raised.push_back(it);
+			}
+		}
+	}
+
+	// Alerts no longer applying at this fix, either left behind or expired
+	for (auto it = entering.begin(); it != entering.end();) {
+		if (std::find(alerts.begin(), alerts.end(), it->first) == alerts.end()) {
+			it = entering.erase(it);
+		}
+		else {
+			++it;
+		}
+	}
+
+	for (auto it = active.begin(); it != active.end();) {
+		if (std::find(alerts.begin(), alerts.end(), *it) != alerts.end()) {
+			++it;
+			continue;
+		}
+		if (++leaving[*it] >= confirmations) {
+			leaving.erase(*it);
+			update->cleared.push_back(*it);
+			it = active.erase(it);
+		}
+		else {
+			++it;
+		}
+	}
+}
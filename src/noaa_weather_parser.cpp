@@ -0,0 +1,329 @@
+// Copyright(C) 2025 by Steven Adler
+//
+// This file is part of NOAA Weather plugin for OpenCPN.
+//
+// NOAA Weather plugin for OpenCPN is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// NOAA Weather plugin for OpenCPN is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with the NOAA Weather plugin for OpenCPN. If not, see <https://www.gnu.org/licenses/>.
+//
+
+// Reference Information
+// https://www.ndbc.noaa.gov/faq/measdes.shtml
+// https://www.ndbc.noaa.gov/docs/ndbc_web_data_guide.pdf
+
+#include "noaa_weather_parser.h"
+#include "noaa_weather_columns.h"
+
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+// Column positions in latest_obs.txt
+// #STN       LAT      LON  YYYY MM DD hh mm WDIR WSPD   GST WVHT  DPD APD MWD   PRES  PTDY  ATMP  WTMP  DEWP  VIS   TIDE
+// #text      deg      deg   yr mo day hr mn degT  m/s   m/s   m   sec sec degT   hPa   hPa  degC  degC  degC  nmi     ft
+// 13001    12.000  -23.000 2025 04 07 15 00 356   6.8   8.0   MM  MM   MM  MM 1011.1    MM  23.3  24.0    MM   MM     MM
+typedef enum _latestobscolumn {
+	LATEST_OBS_STATION = 0,
+	LATEST_OBS_LATITUDE = 1,
+	LATEST_OBS_LONGITUDE = 2,
+	LATEST_OBS_WIND_DIRECTION = 8,
+	LATEST_OBS_WIND_SPEED = 9,
+	LATEST_OBS_PRESSURE = 15,
+	LATEST_OBS_AIR_TEMPERATURE = 17,
+	LATEST_OBS_LAST = LATEST_OBS_AIR_TEMPERATURE
+} LATEST_OBS_COLUMN;
+
+// Field positions in station_table.txt, fields are separated by '|'
+// # STATION_ID | OWNER | TTYPE | HULL | NAME | PAYLOAD | LOCATION | TIMEZONE | FORECAST | NOTE
+// 13002|PR|Atlas Buoy||NE Extension||21.000 N 23.000 W (21&#176;0'0" N 23&#176;0'0" W)|| |
+typedef enum _stationtablefield {
+	STATION_TABLE_STATION = 0,
+	STATION_TABLE_NAME = 4,
+	STATION_TABLE_LOCATION = 6,
+	STATION_TABLE_LAST = STATION_TABLE_LOCATION
+} STATION_TABLE_FIELD;
+
+bool IsReported(double value) {
+	return !std::isnan(value);
+}
+
+bool IsReported(int direction) {
+	return direction != NDBC_MISSING_DIRECTION;
+}
+
+void ClearObservation(BuoyData *buoy) {
+	const double missing = std::numeric_limits<double>::quiet_NaN();
+	buoy->windSpeed = missing;
+	buoy->windDirection = NDBC_MISSING_DIRECTION;
+	buoy->barometricPressure = missing;
+	buoy->airTemperature = missing;
+}
+
+NDBC_Tokenizer::NDBC_Tokenizer(const char *data, size_t length) {
+	position = data;
+	lineStart = data;
+	lineEnd = data;
+	end = data + length;
+}
+
+bool NDBC_Tokenizer::NextLine(void) {
+	// Skip the remainder of the current line and its terminator(s)
+	position = lineEnd;
+	while ((position < end) && ((*position == '\n') || (*position == '\r'))) {
+		position++;
+	}
+	if (position >= end) {
+		lineStart = lineEnd = end;
+		return false;
+	}
+
+	lineStart = position;
+	lineEnd = position;
+	while ((lineEnd < end) && (*lineEnd != '\n') && (*lineEnd != '\r')) {
+		lineEnd++;
+	}
+	return true;
+}
+
+bool NDBC_Tokenizer::NextColumn(const char **column, size_t *length) {
+	while ((position < lineEnd) && ((*position == ' ') || (*position == '\t'))) {
+		position++;
+	}
+	if (position >= lineEnd) {
+		return false;
+	}
+
+	const char *start = position;
+	while ((position < lineEnd) && (*position != ' ') && (*position != '\t')) {
+		position++;
+	}
+	*column = start;
+	*length = position - start;
+	return true;
+}
+
+bool NDBC_Tokenizer::IsHeader(void) const {
+	return (lineStart < lineEnd) && (*lineStart == '#');
+}
+
+bool ParseColumn(const char *column, size_t length, double *value) {
+	// Powers of ten used to scale the fractional digits
+	static const double scale[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9,
+		1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18 };
+
+	const char *p = column;
+	const char *last = column + length;
+	bool negative = false;
+
+	if ((p < last) && ((*p == '-') || (*p == '+'))) {
+		negative = (*p == '-');
+		p++;
+	}
+
+	unsigned long long mantissa = 0;
+	int digits = 0;
+	int fractionDigits = 0;
+	bool fraction = false;
+
+	for (; p < last; p++) {
+		if ((*p >= '0') && (*p <= '9')) {
+			// NDBC values never approach this precision, treat as malformed
+			if (digits == 18) {
+				return false;
+			}
+			mantissa = (mantissa * 10) + (*p - '0');
+			digits++;
+			if (fraction) {
+				fractionDigits++;
+			}
+		}
+		else if ((*p == '.') && (!fraction)) {
+			fraction = true;
+		}
+		else {
+			// Includes "MM", the NDBC notation for a missing value
+			return false;
+		}
+	}
+
+	if (digits == 0) {
+		return false;
+	}
+
+	double result = (double)mantissa / scale[fractionDigits];
+	*value = negative ? -result : result;
+	return true;
+}
+
+bool ParseColumn(const char *column, size_t length, int *value) {
+	double result;
+	if (ParseColumn(column, length, &result)) {
+		*value = (int)result;
+		return true;
+	}
+	return false;
+}
+
+size_t ParseScheduledReports(const char *data, size_t length, NOAA_StationColumns *buoys) {
+	NDBC_Tokenizer tokenizer(data, length);
+	const double missing = std::numeric_limits<double>::quiet_NaN();
+	size_t count = 0;
+
+	// Roughly 80 to 120 characters per station line
+	buoys->Reserve(buoys->Size() + (length / 80));
+
+	// Reused for every line, the strings keep their capacity
+	BuoyData buoy;
+
+	while (tokenizer.NextLine()) {
+		// Skip the two header lines (and any others NDBC may add)
+		if (tokenizer.IsHeader()) {
+			continue;
+		}
+
+		buoy.id.clear();
+		buoy.latitude = missing;
+		buoy.longitude = missing;
+		ClearObservation(&buoy);
+
+		const char *column;
+		size_t columnLength;
+		int j = 0;
+
+		while ((j <= LATEST_OBS_LAST) && (tokenizer.NextColumn(&column, &columnLength))) {
+			switch (j) {
+				case LATEST_OBS_STATION:
+					buoy.id.assign(column, columnLength);
+					break;
+				case LATEST_OBS_LATITUDE:
+					ParseColumn(column, columnLength, &buoy.latitude);
+					break;
+				case LATEST_OBS_LONGITUDE:
+					ParseColumn(column, columnLength, &buoy.longitude);
+					break;
+				case LATEST_OBS_WIND_DIRECTION:
+					if (!ParseColumn(column, columnLength, &buoy.windDirection)) {
+						buoy.windDirection = NDBC_MISSING_DIRECTION;
+					}
+					break;
+				case LATEST_OBS_WIND_SPEED:
+					ParseColumn(column, columnLength, &buoy.windSpeed);
+					break;
+				case LATEST_OBS_PRESSURE:
+					ParseColumn(column, columnLength, &buoy.barometricPressure);
+					break;
+				case LATEST_OBS_AIR_TEMPERATURE:
+					ParseColumn(column, columnLength, &buoy.airTemperature);
+					break;
+				default:
+					break;
+			}
+			j++;
+		}
+
+		// A station without a position can't be displayed on the chart
+		if ((buoy.id.empty()) || (!IsReported(buoy.latitude)) || (!IsReported(buoy.longitude))) {
+			continue;
+		}
+
+		// latest_obs.txt doesn't include the station name, use the id (it is only stored once)
+		buoy.name = buoy.id;
+		buoys->Add(buoy);
+		count++;
+	}
+	return count;
+}
+
+// Parse a station table location, "21.000 N 23.000 W (21&#176;0'0" N 23&#176;0'0" W)"
+static bool ParseLocation(const char *location, size_t length, double *latitude, double *longitude) {
+	NDBC_Tokenizer tokenizer(location, length);
+	const char *column;
+	size_t columnLength;
+
+	if ((!tokenizer.NextLine()) ||
+		(!tokenizer.NextColumn(&column, &columnLength)) || (!ParseColumn(column, columnLength, latitude)) ||
+		(!tokenizer.NextColumn(&column, &columnLength)) || (columnLength != 1) || ((*column != 'N') && (*column != 'S'))) {
+		return false;
+	}
+	if (*column == 'S') {
+		*latitude = -*latitude;
+	}
+
+	if ((!tokenizer.NextColumn(&column, &columnLength)) || (!ParseColumn(column, columnLength, longitude)) ||
+		(!tokenizer.NextColumn(&column, &columnLength)) || (columnLength != 1) || ((*column != 'E') && (*column != 'W'))) {
+		return false;
+	}
+	if (*column == 'W') {
+		*longitude = -*longitude;
+	}
+	return true;
+}
+
+size_t ParseStationList(const char *data, size_t length, NOAA_StationColumns *buoys) {
+	const char *position = data;
+	const char *end = data + length;
+	size_t count = 0;
+	BuoyData buoy;
+
+	// Roughly 100 characters per station line
+	buoys->Reserve(buoys->Size() + (length / 100));
+
+	while (position < end) {
+		const char *lineEnd = position;
+		while ((lineEnd < end) && (*lineEnd != '\n') && (*lineEnd != '\r')) {
+			lineEnd++;
+		}
+
+		// Skip the two header lines and blank lines
+		if ((lineEnd > position) && (*position != '#')) {
+			buoy.id.clear();
+			buoy.name.clear();
+			ClearObservation(&buoy);
+			bool located = false;
+
+			const char *field = position;
+			for (int j = 0; (j <= STATION_TABLE_LAST) && (field <= lineEnd); j++) {
+				const char *fieldEnd = (const char *)memchr(field, '|', lineEnd - field);
+				if (fieldEnd == NULL) {
+					fieldEnd = lineEnd;
+				}
+
+				switch (j) {
+					case STATION_TABLE_STATION:
+						buoy.id.assign(field, fieldEnd - field);
+						break;
+					case STATION_TABLE_NAME:
+						buoy.name.assign(field, fieldEnd - field);
+						break;
+					case STATION_TABLE_LOCATION:
+						located = ParseLocation(field, fieldEnd - field, &buoy.latitude, &buoy.longitude);
+						break;
+					default:
+						break;
+				}
+				field = fieldEnd + 1;
+			}
+
+			// A station without a position can't be displayed on the chart
+			if ((!buoy.id.empty()) && (located)) {
+				buoys->Add(buoy);
+				count++;
+			}
+		}
+
+		position = lineEnd;
+		while ((position < end) && ((*position == '\n') || (*position == '\r'))) {
+			position++;
+		}
+	}
+	return count;
+}
@@ -15,7 +15,7 @@
 // You should have received a copy of the GNU General Public License
 // along with the NOAA Weather Plugin for OpenCPN. If not, see <https://www.gnu.org/licenses/>.
 //
-// This plugin has been developed independent of NOAA and 
+// This plugin has been developed independent of NOAA and
 // is not authorised for use by, nor affilited with NOAA
 
 //
@@ -23,7 +23,7 @@
 // Description: Retrieve NOAA Weather Forecasts and Alerts
 // Owner: twocanplugin@hotmail.com
 // Date: 6/12/2021
-// Version History: 
+// Version History:
 // 1.0 Initial Release
 // 1.1 02/04/2025 - Add National Data Buoy Center (NDBC) reports
 //
@@ -45,14 +45,38 @@ extern "C" DECL_EXP void destroy_pi(opencpn_plugin* p) {
 	delete p;
 }
 
-NOAA_Plugin::NOAA_Plugin(void *ppimgr) : opencpn_plugin_118(ppimgr) {
+NOAA_Plugin::NOAA_Plugin(void *ppimgr) : opencpn_plugin_118(ppimgr), iconCache(&glRenderer) {
 	
-	// Load the plugin bitmaps/icons 
+	// Load the plugin bitmaps/icons
 	wxString pluginFolder = GetPluginDataDir(PLUGIN_PACKAGE_NAME) + wxFileName::GetPathSeparator() + "data" + wxFileName::GetPathSeparator();
 	pluginBitmap = GetBitmapFromSVGFile(pluginFolder + "plugin_logo.svg", 32, 32);
 	
-	// BUG BUG This should be scaled dynamically based on the chart scale
-	buoyBitmap = GetBitmapFromSVGFile(pluginFolder + "buoy_icon.svg", 32, 32);
+	// The buoy icon is rasterized at the size for each chart scale as it is needed
+	buoyIcon = iconCache.AddIcon(pluginFolder + "buoy_icon.svg");
+
+	ndbcServer = NDBC_SERVER;
+	nwsServer = NWS_SERVER;
+
+	selectedStation = 0;
+
+	refreshInterval = REFRESH_INTERVAL_STATIONS;
+	refreshOffset = REFRESH_OFFSET;
+	statisticsInterval = STATISTICS_INTERVAL;
+	alertInterval = ALERT_REFRESH_INTERVAL;
+	alertsLoaded = false;
+	pendingZones = 0;
+	monitorEnabled = true;
+	prefetchEnabled = true;
+	prefetchConcurrency = PREFETCH_CONCURRENCY;
+	routeGeneration = 0;
+	routePending = 0;
+	routeSpeed = ROUTE_DEFAULT_SPEED;
+	windBarbs = false;
+
+	// No position until the first fix
+	currentLatitude = std::numeric_limits<double>::quiet_NaN();
+	currentLongitude = std::numeric_limits<double>::quiet_NaN();
+	currentSpeed = std::numeric_limits<double>::quiet_NaN();
 }
 
 NOAA_Plugin::~NOAA_Plugin(void) {
@@ -65,13 +89,27 @@ int NOAA_Plugin::Init(void) {
 	// Maintain a reference to the OpenCPN window to use as the parent for the dialog
 	parentWindow = GetOCPNCanvasWindow();
 
-	// Maintain a reference to the OpenCPN configuration object 
-	// BUG BUG No preferences dialog to set flag for either scheduled reports or realtime observations 
+	// Maintain a reference to the OpenCPN configuration object
+	// BUG BUG No preferences dialog to set flag for either scheduled reports or realtime observations
 	configSettings = GetOCPNConfigObject();
 	if (configSettings) {
 		configSettings->SetPath(_T("/PlugIns/NOAA"));
 		configSettings->Read(_T("Mode"), &useScheduled, true);
+		// The servers may be redirected, for example to a local server for testing
+		configSettings->Read(_T("NDBCServer"), &ndbcServer, NDBC_SERVER);
+		configSettings->Read(_T("NWSServer"), &nwsServer, NWS_SERVER);
+		// The station list rarely changes, the scheduled reports are updated every half hour
+		configSettings->Read(_T("RefreshInterval"), &refreshInterval, useScheduled ? REFRESH_INTERVAL_REPORTS : REFRESH_INTERVAL_STATIONS);
+		configSettings->Read(_T("RefreshOffset"), &refreshOffset, REFRESH_OFFSET);
+		configSettings->Read(_T("StatisticsInterval"), &statisticsInterval, STATISTICS_INTERVAL);
+		configSettings->Read(_T("AlertInterval"), &alertInterval, ALERT_REFRESH_INTERVAL);
+		configSettings->Read(_T("Monitor"), &monitorEnabled, true);
+		configSettings->Read(_T("Prefetch"), &prefetchEnabled, true);
+		configSettings->Read(_T("PrefetchConcurrency"), &prefetchConcurrency, PREFETCH_CONCURRENCY);
+		configSettings->Read(_T("RouteSpeed"), &routeSpeed, ROUTE_DEFAULT_SPEED);
+		configSettings->Read(_T("WindBarbs"), &windBarbs, false);
 	}
+	prefetchQueue.SetConcurrency(prefetchConcurrency);
 
 	// Add our context menu items, Requires INSTALLS_CONTEXTMENU_ITEMS
 	// BUG BUG Move wxID's to the header, so there is a central place to maintain the values
@@ -87,32 +125,77 @@ int NOAA_Plugin::Init(void) {
 	menuItem = new wxMenuItem(NULL, wxID_HIGHEST + 3, _T("NOAA Reports"), wxEmptyString, wxITEM_NORMAL, NULL);
 	noaaBuoyMenu = AddCanvasContextMenuItem(menuItem, this);
 
+	menuItem = new wxMenuItem(NULL, wxID_HIGHEST + 4, _T("NOAA Route Forecast"), wxEmptyString, wxITEM_NORMAL, NULL);
+	noaaRouteMenu = AddCanvasContextMenuItem(menuItem, this);
+
+	menuItem = new wxMenuItem(NULL, wxID_HIGHEST + 5, _T("NOAA Wind Barbs"), wxEmptyString, wxITEM_NORMAL, NULL);
+	noaaBarbMenu = AddCanvasContextMenuItem(menuItem, this);
+
 	// Only enable the Reports menu item when the cursor is actually positioned on a buoy
 	SetCanvasContextMenuItemGrey(noaaBuoyMenu, true);
 
-	// Download either the NOAA NDBC Station List or Scheduled Reports
-	// BUG BUG Should this be done everytime OpenCPN loads, at scheduled times or manually?
+	// Forecasts and alerts are cached so repeated requests don't wait on the network
+	if (responseCache.Open(GetDataFolder() + wxFileName::GetPathSeparator() + "cache", CACHE_SIZE)) {
+		downloadManager.SetCache(&responseCache);
+	}
+
+	downloadManager.SetStatistics(&statistics);
+	stationStore.SetStatistics(&statistics);
+	statisticsScheduler.Schedule(statisticsInterval * 60LL, 0, [this]() { PublishStatistics(false); });
+
+	LoadPointsCache();
+
+	// Draw the stations from the last session straight away, and if offline, that is all we have
+	LoadStationSnapshot();
+
+	// Download either the NOAA NDBC Station List or Scheduled Reports,
+	// in the background so that OpenCPN's startup is not delayed
 	if (OCPN_isOnline()) {
+		DownloadStations(PRIORITY_BACKGROUND);
+	}
 
-		if (useScheduled) {
-			// Download scheduled reports for all reporting stations
-			DownloadScheduledReports();
+	// and then keep them up to date
+	refreshScheduler.Schedule(refreshInterval * 60LL, refreshOffset * 60LL, [this]() {
+		if ((OCPN_isOnline()) && (!stationStore.IsBusy())) {
+			DownloadStations(PRIORITY_BACKGROUND);
 		}
-		else {
-			// The station list is used to retrieve realtime observations for an individual station
-			DownloadStationList();
+	});
+
+	// The active marine alerts, whose areas are checked locally as the vessel moves
+	alertScheduler.Schedule(alertInterval * 60LL, 0, [this]() {
+		if (OCPN_isOnline()) {
+			RefreshAlerts();
 		}
+	});
+	if (OCPN_isOnline()) {
+		RefreshAlerts();
 	}
 
 	// Notify OpenCPN what events we want to receive callbacks for
 	return (WANTS_CONFIG | INSTALLS_CONTEXTMENU_ITEMS | WANTS_NMEA_EVENTS |
-		WANTS_MOUSE_EVENTS | WANTS_CURSOR_LATLON | WANTS_OVERLAY_CALLBACK | 
-		WANTS_OPENGL_OVERLAY_CALLBACK | WANTS_ONPAINT_VIEWPORT);
+		WANTS_MOUSE_EVENTS | WANTS_CURSOR_LATLON | WANTS_OVERLAY_CALLBACK |
+		WANTS_OPENGL_OVERLAY_CALLBACK | WANTS_ONPAINT_VIEWPORT | WANTS_PLUGIN_MESSAGING);
 }
 
 // OpenCPN is either closing down, or we have been disabled from the Preferences Dialog
 bool NOAA_Plugin::DeInit(void) {
 
+	refreshScheduler.Cancel();
+	statisticsScheduler.Cancel();
+	alertScheduler.Cancel();
+	prefetchSettle.Cancel();
+	prefetchPacing.Cancel();
+	prefetchQueue.Clear();
+
+	// A refresh in progress is allowed to finish, it only takes a moment to parse the file
+	stationStore.Wait();
+
+	// Abandon any outstanding downloads, their callbacks must not run once we are unloaded
+	downloadManager.CancelAll();
+	downloadManager.SetCache(NULL);
+	downloadManager.SetStatistics(NULL);
+	responseCache.Close();
+
 	return true;
 }
 
@@ -127,7 +210,7 @@ int NOAA_Plugin::GetAPIVersionMinor() {
 	return OCPN_API_VERSION_MINOR;
 }
 
-// The plugin version numbers. 
+// The plugin version numbers.
 int NOAA_Plugin::GetPlugInVersionMajor() {
 
 	return PLUGIN_VERSION_MAJOR;
@@ -164,15 +247,76 @@ wxBitmap* NOAA_Plugin::GetPlugInBitmap() {
 // The current position is used as the basis for retrieving weather forecasts and alerts
 void NOAA_Plugin::SetPositionFix(PlugIn_Position_Fix &pfix) {
 
-	currentLatitude = pfix.Lat; 
-	currentLongitude = pfix.Lon; 
+	currentLatitude = pfix.Lat;
+	currentLongitude = pfix.Lon;
+	currentSpeed = pfix.Sog;
+
+	// Answered from the alert areas held locally, rather than asking the server at every fix
+	alertIndex.Query(currentLatitude, currentLongitude, &positionAlerts);
+
+	if (monitorEnabled) {
+		MonitorPosition();
+	}
+}
+
+// Act on the changes the monitor reports, which are already filtered for GPS jitter.
+// The forecast for a new cell is downloaded into the response cache, so it is ready when the menu is used
+void NOAA_Plugin::MonitorPosition(void) {
+
+	std::vector<std::string> alertIds;
+	for (auto it : positionAlerts) {
+		alertIds.push_back(alertIndex.Alert(it).id);
+	}
+
+	MonitorUpdate update;
+	positionMonitor.Update(currentLatitude, currentLongitude, alertIds, (long long)wxDateTime::Now().GetTicks(), &update);
+
+	if ((update.forecast) && (OCPN_isOnline())) {
+		RequestForecast(currentLatitude, currentLongitude, false);
+	}
+
+	for (const auto& it : update.raised) {
+		NotifyAlert(it);
+	}
+	for (const auto& it : update.cleared) {
+		wxLogMessage("NOAA Weather Plugin, Alert no longer applies: %s", wxString::FromUTF8(it.c_str()));
+	}
+}
+
+// Raise a non-modal notification for an alert the vessel has entered
+void NOAA_Plugin::NotifyAlert(const std::string& alertId) {
+
+	for (size_t i = 0; i < alertIndex.Size(); i++) {
+		const AlertData& alert = alertIndex.Alert((unsigned int)i);
+		if (alert.id == alertId) {
+			wxString title = wxString::FromUTF8(alert.event.c_str());
+			wxString headline = wxString::FromUTF8(alert.headline.c_str());
+			wxLogMessage("NOAA Weather Plugin, Alert now applies: %s, %s", title, headline);
+
+			wxNotificationMessage notification(title, headline, parentWindow, wxICON_WARNING);
+			notification.Show(wxNotificationMessage::Timeout_Auto);
+			return;
+		}
+	}
 }
 
-// Requires WANTS_CURSOR_LATLON 
-// Iterate over the list of visible stations and if hovering over a buoy, enable the context menu item
+// Requires WANTS_CURSOR_LATLON
+// If hovering over a buoy, enable the context menu item
 void NOAA_Plugin::SetCursorLatLon(double lat, double lon) {
 
-	if (IsUnderCursor(lat, lon, &id, &name)) {
+	// Only canvases that have been drawn have a view port and hit test
+	int canvasIndex = GetCanvasIndexUnderMouse();
+	if ((canvasIndex < 0) || (canvasIndex >= (int)canvases.size())) {
+		SetCanvasContextMenuItemGrey(noaaBuoyMenu, true);
+		return;
+	}
+
+	// Convert latitude and longitude to the pixel co-ordinates used when the icons were drawn
+	CanvasState& canvas = canvases[canvasIndex];
+	wxPoint point;
+	GetCanvasPixLL(&canvas.viewPort, &point, lat, lon);
+
+	if (IsUnderCursor(canvas, point, &id, &name)) {
 		SetCanvasContextMenuItemGrey(noaaBuoyMenu, false);
 	}
 	else {
@@ -181,17 +325,12 @@ void NOAA_Plugin::SetCursorLatLon(double lat, double lon) {
 }
 
 // Requires WANTS_ONPAINT_VIEWPORT
-// The view port (chart extent) is used to determine what buoys can be overlayed on the chart
+// Sent before a canvas is painted, but without saying which canvas. The render callbacks
+// keep each canvas' view port, here the icon for the new chart scale is rasterized ahead of painting
 void NOAA_Plugin::SetCurrentViewPort(PlugIn_ViewPort& vp) {
 
-	viewPort = vp;
-	visibleBuoys = FilterVisibleBuoys(vp);
-
-	// BUG BUG Should scale the buoy icon depending on vp.chart_scale
-	// By observation, scales ranges included: 
-	// 101415
-	// 812551
-	// 5050832
+	double scaleFactor = (GetOCPNCanvasWindow() != NULL) ? GetOCPNCanvasWindow()->GetContentScaleFactor() : 1.0;
+	iconCache.Get(buoyIcon, NOAA_IconCache::SelectSize(vp.chart_scale, scaleFactor));
 }
 
 // Requires WANTS_MOUSE_EVENTS
@@ -201,29 +340,19 @@ bool NOAA_Plugin::MouseEventHook(wxMouseEvent& event) {
 	// Only perform these actions if we have an Internet connection
 	if (OCPN_isOnline()) {
 
-		// BUG BUG Multi-canvas support??
-		if (GetCanvasIndexUnderMouse() == 0) {
-			double lat, lon;
+		// Each canvas has its own hit test, built when it was last drawn
+		int canvasIndex = GetCanvasIndexUnderMouse();
+		if ((canvasIndex >= 0) && (canvasIndex < (int)canvases.size())) {
 
 			// Handle a double click event to retrieve the weather observations from the buoy
 			if (event.LeftDClick()) {
 
-				// Convert Pixel Co-ordinates to latitude and longitude
-				GetCanvasLLPix(&viewPort, event.GetPosition(), &lat, &lon);
-
-				// Iterate over the visible station list and see if any buoys were the double click target
-				if (IsUnderCursor(lat, lon, &id, &name)) {
+				// See if any of the icons drawn in the last frame were the double click target
+				if (IsUnderCursor(canvases[canvasIndex], event.GetPosition(), &id, &name)) {
 
 					// Display the weather observation
 					if (useScheduled) {
-						std::string sid = id.ToStdString();
-						const auto p = std::find_if(visibleBuoys.begin(), visibleBuoys.end(),
-							[sid](const BuoyData& a) { return a.id == sid; });
-
-						if (p != visibleBuoys.end()) {
-							wxMessageBox(wxString::Format("Wind Direction: %d\nWind Speed %0.2f\nPressure: %0.2f\nTemperature: %0.2f",
-								p->windDirection, p->windSpeed, p->barometricPressure, p->airTemperature), p->id);
-						}
+						wxMessageBox(FormatObservation(selectedStations->buoys.Get(selectedStation)), id);
 					}
 					else {
 						DownloadRealtimeObservation(id, name);
@@ -240,86 +369,56 @@ bool NOAA_Plugin::MouseEventHook(wxMouseEvent& event) {
 // Handle context menu events
 void NOAA_Plugin::OnContextMenuItemCallback(int menuId) {
 
+	// Switch between the buoy icons and the wind barbs, drawn from the data already downloaded
+	if (menuId == noaaBarbMenu) {
+		windBarbs = !windBarbs;
+		if (configSettings) {
+			configSettings->SetPath(_T("/PlugIns/NOAA"));
+			configSettings->Write(_T("WindBarbs"), windBarbs);
+		}
+		OnStationsPublished();
+		return;
+	}
+
 	// Only perform these actions if we have an Internet connection
 	if (OCPN_isOnline()) {
 
 		// BUG BUG Should these menu items be greyed out if no Internet connection ?
 		if (menuId == noaaForecastMenu) {
 
-			// Obtain the correct station id & grids given our current position
-			wxString forecastUrl = GetForecastUrl(currentLatitude, currentLongitude);
-
-			if (forecastUrl.Length() > 0) {
-				// Once we have the url, can now retrieve the actual forecast
-				wxString jsonResponse = ExecuteQuery(forecastUrl);
-				wxJSONReader reader;
-				wxJSONValue root;
-
-				// Check for any JSON parsing errors
-				if (reader.Parse(jsonResponse, &root) > 0) {
-					wxLogMessage("NOAA Weather Plugin, Json parser error(s) in the following response:\n%s", jsonResponse);
-					for (auto it : reader.GetErrors()) {
-						wxLogMessage("NOAA Weather Plugin, Json parser error: %s", it);
-					}
-				}
-				else {
-					// Display the forecast values in a simple data grid
-					// BUG BUG Should this be a modal dialog?
-					NOAA_Plugin_Dialog* dialog = new NOAA_Plugin_Dialog(parentWindow, jsonResponse);
-					dialog->Show();
-				}
-			}
-			else {
-				wxMessageBox("Error retrieving forecast\nPlease check OpenCPN log",
-					_T(PLUGIN_COMMON_NAME), wxICON_ERROR);
-				wxLogMessage("NOAA Weather Plugin, Error retrieving forecast URL: %s", forecastUrl);
-			}
+			// Obtain the correct station id & grids given our current position,
+			// the forecast is displayed once both downloads complete
+			RequestForecast(currentLatitude, currentLongitude);
 		}
 
-		// Marine Weather Alerts can be retrieved directly given the vessel's current position.
-		// No need to retrieve the root object to determine the grid or station id.
+		// Marine Weather Alerts, from the alert areas if they have been downloaded,
+		// otherwise asking the server and displayed once the download completes
 		if (menuId == noaaAlertMenu) {
-			// Example URL https://api.weather.gov/alerts/active?point=47.606210,-122.33207
-			wxString url = wxString::Format("https://api.weather.gov/alerts/active?point=%07.4f,%08.4f", currentLatitude, currentLongitude);
-
-			wxString jsonResponse = ExecuteQuery(url);
-			wxJSONReader reader;
-			wxJSONValue root;
-
-			// Check for any JSON parsing errors
-			if (reader.Parse(jsonResponse, &root) > 0) {
-				wxLogMessage("NOAA Weather Plugin, Json parser error(s) in the following response:\n%s", jsonResponse);
-				for (auto it : reader.GetErrors()) {
-					wxLogMessage("NOAA Weather Plugin, Json parser error: %s", it);
+			if (alertsLoaded) {
+				std::vector<AlertData> alerts;
+				alertIndex.Query(currentLatitude, currentLongitude, &positionAlerts);
+				for (auto it : positionAlerts) {
+					alerts.push_back(alertIndex.Alert(it));
 				}
+				ShowAlerts(alerts);
 			}
 			else {
-				// If there are no warnings, the "features" array is empty
-				if (root["features"].IsArray() && (root["features"].Size() > 0)) {
-					wxMessageBox(root["features"][0]["properties"]["headline"].AsString() +
-						+"\n" + root["features"][0]["properties"]["description"].AsString(),
-						root["features"][0]["properties"]["event"].AsString(),
-						wxICON_WARNING);
-				}
-				else {
-					wxMessageBox("No alerts issued by NWS, but the prudent mariner will check other information sources",
-						_T(PLUGIN_COMMON_NAME), wxICON_INFORMATION);
-				}
+				RequestAlerts(currentLatitude, currentLongitude);
 			}
 		}
 
+		// Forecast at each waypoint of the active route, displayed once the cells along it are downloaded
+		if (menuId == noaaRouteMenu) {
+			RequestRouteForecast();
+		}
+
 		// Weather Reports
 		if (menuId == noaaBuoyMenu) {
 
-			// Iterate over the list of visible buoys and find the matching report
+			// The report of the station found under the cursor when the menu was opened
 			if (useScheduled) {
-				std::string sid = id.ToStdString();
-				const auto p = std::find_if(visibleBuoys.begin(), visibleBuoys.end(),
-					[sid](const BuoyData& a) { return a.id == sid; });
-
-				if (p != visibleBuoys.end()) {
-					wxMessageBox(wxString::Format("Wind Direction: %d\nWind Speed %0.2f\nPressure: %0.2f\nTemperature: %0.2f",
-						p->windDirection, p->windSpeed, p->barometricPressure, p->airTemperature), p->id);
+				if (selectedStations) {
+					wxMessageBox(FormatObservation(selectedStations->buoys.Get(selectedStation)), id);
 				}
 			}
 			else {
@@ -339,12 +438,36 @@ bool NOAA_Plugin::RenderOverlayMultiCanvas(wxDC& dc, PlugIn_ViewPort* vp,
 		if (dc.IsOk()) {
 
 			// Render the NDBC Buoys
-			if (canvasIndex == 0) {
-				for (auto it : visibleBuoys) {
-					wxPoint wxP;
-					GetCanvasPixLL(vp, &wxP, it.latitude, it.longitude);
-					dc.DrawBitmap(buoyBitmap, wxP.x, wxP.y, true);
+			CanvasState& canvas = UpdateCanvas(canvasIndex, *vp);
+			NOAA_StatisticsTimer timer(&statistics, STAT_RENDER_DC);
+			statistics.Record(STAT_FRAME_ICONS, canvas.visibleBuoys.size() + canvas.visibleClusters.size());
+			// The barbs are larger than the icons they replace, the hit test buckets match the largest footprint
+			int barbSize = canvas.buoySize * 3 / 2;
+			canvas.hitTest.Reset(vp->pix_width, vp->pix_height, windBarbs ? barbSize : canvas.buoySize);
+			canvas.renderedStations = canvas.visibleStations;
+			const wxBitmap& buoyBitmap = iconCache.Get(buoyIcon, canvas.buoySize).bitmap;
+			const NOAA_StationColumns& buoys = canvas.renderedStations->buoys;
+			barbBatch.Begin(GetNorthAngle(vp), BARB_OUTPUT_POLYGONS);
+			for (auto it : canvas.visibleBuoys) {
+				wxPoint wxP;
+				GetCanvasPixLL(vp, &wxP, buoys.Latitude(it), buoys.Longitude(it));
+				if (IsBarbDrawn(buoys, it)) {
+					barbBatch.Add(wxP.x, wxP.y, buoys.WindDirection(it), buoys.WindSpeed(it) * BARB_KNOTS_PER_MS, barbSize, buoys.Latitude(it) < 0);
+					canvas.hitTest.Add(it, wxP.x - (barbSize / 2), wxP.y - (barbSize / 2), barbSize, barbSize);
+					continue;
 				}
+				dc.DrawBitmap(buoyBitmap, wxP.x, wxP.y, true);
+				canvas.hitTest.Add(it, wxP.x, wxP.y, buoyBitmap.GetWidth(), buoyBitmap.GetHeight());
+			}
+			DrawBarbs(dc);
+			// Cluster markers are centred on the mean position of their stations
+			for (auto it : canvas.visibleClusters) {
+				const StationCluster& cluster = canvas.renderedStations->clusters.Cluster(canvas.clusterLevel, it);
+				const ClusterSymbol& clusterSymbol = GetClusterSymbol(cluster.count);
+				wxPoint wxP;
+				GetCanvasPixLL(vp, &wxP, cluster.latitude, cluster.longitude);
+				dc.DrawBitmap(clusterSymbol.bitmap, wxP.x - (clusterSymbol.bitmap.GetWidth() / 2),
+					wxP.y - (clusterSymbol.bitmap.GetHeight() / 2), true);
 			}
 			return true;
 		}
@@ -368,18 +491,43 @@ bool NOAA_Plugin::RenderGLOverlayMultiCanvas(wxGLContext* pcontext, PlugIn_ViewP
 
 		if (pcontext->IsOK()) {
 
-			NOAA_Graphics* glRenderer = new NOAA_Graphics();
-
-			if (canvasIndex == 0) {
-				// Render the NDBC Buoys
-				for (auto it : visibleBuoys) {
-					wxPoint wxP;
-					GetCanvasPixLL(vp, &wxP, it.latitude, it.longitude);
-					glRenderer->DrawBitmap(buoyBitmap, wxP.x, wxP.y, true);
+			// Render the NDBC Buoys, queued and then drawn from the texture atlas in a single batch
+			CanvasState& canvas = UpdateCanvas(canvasIndex, *vp);
+			NOAA_StatisticsTimer timer(&statistics, STAT_RENDER_GL);
+			statistics.Record(STAT_FRAME_ICONS, canvas.visibleBuoys.size() + canvas.visibleClusters.size());
+			// The barbs are larger than the icons they replace, the hit test buckets match the largest footprint
+			int barbSize = canvas.buoySize * 3 / 2;
+			canvas.hitTest.Reset(vp->pix_width, vp->pix_height, windBarbs ? barbSize : canvas.buoySize);
+			canvas.renderedStations = canvas.visibleStations;
+			// New cluster markers are added to the atlas before Begin uploads it
+			for (auto it : canvas.visibleClusters) {
+				GetClusterSymbol(canvas.renderedStations->clusters.Cluster(canvas.clusterLevel, it).count);
+			}
+			const IconRaster& buoyRaster = iconCache.Get(buoyIcon, canvas.buoySize);
+			const NOAA_StationColumns& buoys = canvas.renderedStations->buoys;
+			barbBatch.Begin(GetNorthAngle(vp), BARB_OUTPUT_LINES);
+			glRenderer.Begin(pcontext);
+			for (auto it : canvas.visibleBuoys) {
+				wxPoint wxP;
+				GetCanvasPixLL(vp, &wxP, buoys.Latitude(it), buoys.Longitude(it));
+				if (IsBarbDrawn(buoys, it)) {
+					barbBatch.Add(wxP.x, wxP.y, buoys.WindDirection(it), buoys.WindSpeed(it) * BARB_KNOTS_PER_MS, barbSize, buoys.Latitude(it) < 0);
+					canvas.hitTest.Add(it, wxP.x - (barbSize / 2), wxP.y - (barbSize / 2), barbSize, barbSize);
+					continue;
 				}
+				glRenderer.Add(buoyRaster.symbol, wxP.x, wxP.y);
+				canvas.hitTest.Add(it, wxP.x, wxP.y, buoyRaster.size, buoyRaster.size);
 			}
-
-			delete glRenderer;
+			for (auto it : canvas.visibleClusters) {
+				const StationCluster& cluster = canvas.renderedStations->clusters.Cluster(canvas.clusterLevel, it);
+				const ClusterSymbol& clusterSymbol = GetClusterSymbol(cluster.count);
+				wxPoint wxP;
+				GetCanvasPixLL(vp, &wxP, cluster.latitude, cluster.longitude);
+				glRenderer.Add(clusterSymbol.symbol, wxP.x - (clusterSymbol.bitmap.GetWidth() / 2),
+					wxP.y - (clusterSymbol.bitmap.GetHeight() / 2));
+			}
+			glRenderer.Flush();
+			glRenderer.DrawGeometry(barbBatch.Lines(), barbBatch.Triangles(), BARB_COLOUR, BARB_LINE_WIDTH);
 
 			return true;
 		}
@@ -394,108 +542,256 @@ bool NOAA_Plugin::RenderGLOverlayMultiCanvas(wxGLContext* pcontext, PlugIn_ViewP
 	}
 }
 
-// Generated a filtered list of stations that are bounded within the View Port
-std::vector<BuoyData> NOAA_Plugin::FilterVisibleBuoys(const PlugIn_ViewPort &vp) {
+// A station is drawn as a wind barb when they are enabled and it reported both the wind speed and direction
+bool NOAA_Plugin::IsBarbDrawn(const NOAA_StationColumns& buoys, unsigned int index) const {
+	return (windBarbs) && (buoys.IsReported(index, OBSERVATION_WIND_SPEED)) && (buoys.IsReported(index, OBSERVATION_WIND_DIRECTION));
+}
 
-	std::vector<BuoyData> results;
-	for (auto it : allBuoys) { 
-		if ((it.latitude >= vp.lat_min) && (it.latitude <= vp.lat_max)) {
-			if ((it.longitude >= vp.lon_min) && (it.longitude <= vp.lon_max)) {
-				results.push_back(it);
-			}
-		}
+// Screen angle of true north (radians, clockwise from up), measured at the centre of the view port
+// so the barbs follow a rotated chart and the convergence of the meridians of the projection
+double NOAA_Plugin::GetNorthAngle(PlugIn_ViewPort* vp) {
+	double offset = (vp->lat_max - vp->lat_min) / 4.0;
+	if (offset <= 0) {
+		return 0;
 	}
-	return results;
+	double northLatitude = wxMin(vp->clat + offset, 89.0);
+	wxPoint centre;
+	wxPoint north;
+	GetCanvasPixLL(vp, &centre, vp->clat, vp->clon);
+	GetCanvasPixLL(vp, &north, northLatitude, vp->clon);
+	if ((north.x == centre.x) && (north.y == centre.y)) {
+		return 0;
+	}
+	return atan2((double)(north.x - centre.x), (double)(centre.y - north.y));
 }
 
-// Determine if any buoy is under the cursor
-// BUG BUG Is the 'wiggle' factor sufficient ? 
-// Could calculate based on the chart scale and the pixel size of the icon
-bool NOAA_Plugin::IsUnderCursor(double lat, double lon, wxString *id, wxString *name) {
-
-	for (auto it : visibleBuoys) { 
-		if ((it.latitude >= lat - 0.15) && (it.latitude <= lat + 0.15)) {
-			if ((it.longitude >= lon - 0.15) && (it.longitude <= lon + 0.15)) {
-				*id = it.id;
-				*name = it.name;
-				return true;
-			}
-		}
+// Draw the frame's barbs with a transparent brush for the staffs and feathers, all outlines in one call,
+// then the pennants filled in a second call
+void NOAA_Plugin::DrawBarbs(wxDC& dc) {
+	if (barbBatch.Size() == 0) {
+		return;
 	}
-	return false;
+
+	const std::vector<float>& outlines = barbBatch.Outlines();
+	const std::vector<int>& counts = barbBatch.OutlineCounts();
+	barbPoints.resize(outlines.size() / 2);
+	for (size_t i = 0; i < barbPoints.size(); i++) {
+		barbPoints[i] = wxPoint(wxRound(outlines[2 * i]), wxRound(outlines[(2 * i) + 1]));
+	}
+	dc.SetPen(wxPen(BARB_COLOUR, wxRound(BARB_LINE_WIDTH)));
+	dc.SetBrush(*wxTRANSPARENT_BRUSH);
+	dc.DrawPolyPolygon((int)counts.size(), counts.data(), barbPoints.data());
+
+	const std::vector<float>& triangles = barbBatch.Triangles();
+	if (triangles.empty()) {
+		return;
+	}
+	barbPoints.resize(triangles.size() / 2);
+	for (size_t i = 0; i < barbPoints.size(); i++) {
+		barbPoints[i] = wxPoint(wxRound(triangles[2 * i]), wxRound(triangles[(2 * i) + 1]));
+	}
+	barbCounts.assign(barbPoints.size() / 3, 3);
+	dc.SetBrush(wxBrush(BARB_COLOUR));
+	dc.DrawPolyPolygon((int)barbCounts.size(), barbCounts.data(), barbPoints.data());
 }
 
-// Extract Latitude and Longitude as doubles from the station list file (see below). The string has the Unicode degree character
-// 12.000 N 23.000 W (12&#176;0'0" N 23&#176;0'0" W)
-void NOAA_Plugin::ParsePosition(wxString location, double* latitude, double* longitude) {
-	
-	wxRegEx re("([0-9]{1,2}.[0-9]{3})\\s(N|S)\\s([0-9]{1,3}.[0-9]{3})\\s(E|W)*");
+// The state of a canvas, created with an empty view port the first time the canvas is drawn
+CanvasState& NOAA_Plugin::GetCanvasState(int canvasIndex) {
+
+	while ((int)canvases.size() <= canvasIndex) {
+		CanvasState canvas;
+		canvas.viewPort.lat_min = canvas.viewPort.lat_max = 0;
+		canvas.viewPort.lon_min = canvas.viewPort.lon_max = 0;
+		canvas.viewPort.pix_width = canvas.viewPort.pix_height = 0;
+		canvas.viewPort.chart_scale = 0;
+		canvas.viewPort.rotation = 0;
+		canvas.clusterLevel = -1;
+		canvas.buoySize = NOAA_IconCache::SelectSize(0, 1.0);
+		canvases.push_back(canvas);
+	}
+	return canvases[canvasIndex];
+}
 
-	if (re.Matches(location)) {
+static bool IsSameViewPort(const PlugIn_ViewPort& a, const PlugIn_ViewPort& b) {
+	return (a.lat_min == b.lat_min) && (a.lat_max == b.lat_max) && (a.lon_min == b.lon_min) && (a.lon_max == b.lon_max) &&
+		(a.pix_width == b.pix_width) && (a.pix_height == b.pix_height) && (a.chart_scale == b.chart_scale) && (a.rotation == b.rotation);
+}
+
+// Called by the render callbacks. A canvas' stations are only refiltered when its own view port
+// or the station data has changed, so painting one canvas never refilters another
+CanvasState& NOAA_Plugin::UpdateCanvas(int canvasIndex, const PlugIn_ViewPort& vp) {
+
+	CanvasState& canvas = GetCanvasState(canvasIndex);
+	if ((IsSameViewPort(canvas.viewPort, vp)) && (canvas.visibleStations == stationStore.Get())) {
+		return canvas;
+	}
+
+	canvas.viewPort = vp;
+	FilterVisibleBuoys(canvas);
+
+	// Restarted by every change, so nothing is prefetched while the chart is being dragged or zoomed
+	if ((prefetchEnabled) && (!useScheduled)) {
+		prefetchSettle.Defer(PREFETCH_SETTLE, [this]() { PrefetchVisible(); });
+	}
+
+	wxWindow *window = GetCanvasByIndex(canvasIndex);
+	double scaleFactor = (window != NULL) ? window->GetContentScaleFactor() : 1.0;
+	canvas.buoySize = NOAA_IconCache::SelectSize(vp.chart_scale, scaleFactor);
+	return canvas;
+}
+
+// Generate a filtered list of stations that are bounded within the canvas' View Port
+// The spatial index only visits the grid cells overlapping the view port and
+// correctly handles view ports that cross the antimeridian.
+// Picks up the latest station data, the indices are only valid for that data
+// When zoomed out the stations are replaced by the clusters of the pyramid level whose cells are
+// at least CLUSTER_MINIMUM_PIXELS wide, so at most one marker is drawn per cell whatever the number of stations
+void NOAA_Plugin::FilterVisibleBuoys(CanvasState& canvas) {
+
+	NOAA_StatisticsTimer timer(&statistics, STAT_FILTER);
+	const PlugIn_ViewPort& vp = canvas.viewPort;
+	canvas.visibleStations = stationStore.Get();
+	canvas.visibleClusters.clear();
+
+	// Pixels per degree of longitude, independent of the chart's projection and rotation
+	double lonSpan = vp.lon_max - vp.lon_min;
+	if (lonSpan < 0) {
+		lonSpan += 360.0;
+	}
+	canvas.clusterLevel = ((lonSpan > 0) && (vp.pix_width > 0)) ?
+		NOAA_ClusterPyramid::SelectLevel(vp.pix_width / lonSpan, CLUSTER_MINIMUM_PIXELS) : -1;
 
-		re.GetMatch(location, 1).ToDouble(latitude);
-		if (re.GetMatch(location, 2) == 'S') {
-			*latitude *= -1;
+	if (canvas.clusterLevel < 0) {
+		canvas.visibleStations->index.Query(vp.lat_min, vp.lat_max, vp.lon_min, vp.lon_max, &canvas.visibleBuoys);
+		return;
+	}
+
+	// Stations alone in their cluster are still drawn (and can be selected) individually
+	std::vector<unsigned int> clusters;
+	canvas.visibleStations->clusters.Query(canvas.clusterLevel, vp.lat_min, vp.lat_max, vp.lon_min, vp.lon_max, &clusters);
+	canvas.visibleBuoys.clear();
+	for (auto it : clusters) {
+		const StationCluster& cluster = canvas.visibleStations->clusters.Cluster(canvas.clusterLevel, it);
+		if (cluster.count == 1) {
+			canvas.visibleBuoys.push_back(cluster.station);
+		}
+		else {
+			canvas.visibleClusters.push_back(it);
 		}
+	}
+}
 
-		re.GetMatch(location, 3).ToDouble(longitude);
-		if (re.GetMatch(location, 4) == 'W') {
-			*longitude *= -1;
+// Cluster marker showing the number of stations. Above ten the count is rounded down to
+// one of a few bands, so only a handful of markers are ever rasterized and added to the atlas
+const ClusterSymbol& NOAA_Plugin::GetClusterSymbol(unsigned int count) {
+
+	static const unsigned int bands[] = { 1000, 500, 200, 100, 50, 20, 10 };
+	wxString label = wxString::Format("%u", count);
+	for (auto band : bands) {
+		if (count >= band) {
+			label = wxString::Format("%u+", band);
+			break;
 		}
 	}
-	else {
-		// Register an error, perhaps in case NOAA changes the format
-		wxLogMessage("NOAA Weather Plugin, Error parsing station list position: %s", location);
+
+	auto it = clusterSymbols.find(label);
+	if (it != clusterSymbols.end()) {
+		return it->second;
 	}
-}
 
+	// Draw onto a transparent image, so the marker is blended the same way as the buoy icon
+	wxImage image(CLUSTER_SYMBOL_SIZE, CLUSTER_SYMBOL_SIZE);
+	image.InitAlpha();
+	memset(image.GetAlpha(), 0, CLUSTER_SYMBOL_SIZE * CLUSTER_SYMBOL_SIZE);
+
+	wxGraphicsContext *gc = wxGraphicsContext::Create(image);
+	if (gc != NULL) {
+		gc->SetPen(wxPen(*wxWHITE, 2));
+		gc->SetBrush(wxBrush(wxColour(0, 84, 147)));
+		gc->DrawEllipse(1, 1, CLUSTER_SYMBOL_SIZE - 2, CLUSTER_SYMBOL_SIZE - 2);
+		gc->SetFont(wxFont(label.Length() > 3 ? 7 : 9, wxFONTFAMILY_SWISS, wxFONTSTYLE_NORMAL, wxFONTWEIGHT_BOLD), *wxWHITE);
+		double width, height;
+		gc->GetTextExtent(label, &width, &height);
+		gc->DrawText(label, (CLUSTER_SYMBOL_SIZE - width) / 2, (CLUSTER_SYMBOL_SIZE - height) / 2);
+		// The image is only updated when the context is destroyed
+		delete gc;
+	}
 
-// Download the National Data Buoy Centre Station List
-// This is a superset of all weather observations and the station id serves
-// as a reference to locate each station's realtime observations
-bool NOAA_Plugin::DownloadStationList(void) {
+	ClusterSymbol clusterSymbol;
+	clusterSymbol.bitmap = wxBitmap(image);
+	clusterSymbol.symbol = glRenderer.AddSymbol(clusterSymbol.bitmap);
+	return clusterSymbols.insert(std::make_pair(label, clusterSymbol)).first->second;
+}
 
-	// Download the file
-	wxString fileName = wxStandardPaths::Get().GetDocumentsDir() + wxFileName::GetPathSeparator() + "station_table.txt";
-	if (DownloadFile("https://www.ndbc.noaa.gov/data/stations/station_table.txt", fileName)) {
+// Determine if any buoy is under the cursor
+// Uses the icon footprints recorded when the last frame was drawn, so the hit area
+// matches the bitmap at every chart scale. Overlapping icons resolve to the nearest.
+// The station found is remembered, so its scheduled report can be shown without searching for it
+bool NOAA_Plugin::IsUnderCursor(CanvasState& canvas, const wxPoint& point, wxString *id, wxString *name) {
+
+	unsigned int index;
+	if (canvas.hitTest.Find(point.x, point.y, &index)) {
+		*id = canvas.renderedStations->buoys.Id(index);
+		*name = canvas.renderedStations->buoys.Name(index);
+		selectedStations = canvas.renderedStations;
+		selectedStation = index;
+		return true;
+	}
+	return false;
+}
 
-		// Parse the file and populate the list of stations
-		wxTextFile textFile;
-		textFile.Open(fileName);
+// Download either the National Data Buoy Centre Station List or the Scheduled Reports.
+// The station list is a superset of all weather observations and the station id serves
+// as a reference to locate each station's realtime observations.
+// The scheduled reports include the latest observation from every reporting station.
+void NOAA_Plugin::DownloadStations(DOWNLOAD_PRIORITY priority) {
+
+	wxString url = ndbcServer + (useScheduled ? "/data/latest_obs/latest_obs.txt" : "/data/stations/station_table.txt");
+	downloadManager.Enqueue(url, priority, [this, priority](const NOAA_DownloadResult& result) {
+		if (CheckDownload(result, priority == PRIORITY_USER)) {
+			std::vector<char> data(result.response);
+			RefreshStations(data);
+		}
+	});
+}
 
-		wxString line;
-		BuoyData buoy;
+// Parse the downloaded file on a worker thread, the new stations are drawn once they are published
+void NOAA_Plugin::RefreshStations(std::vector<char>& data) {
 
-		// Read past the first two lines which are headers
-		textFile.GetFirstLine();
-		textFile.GetNextLine();
+	wxFileName fileName(GetSnapshotFileName());
+	if (!fileName.Mkdir(wxS_DIR_DEFAULT, wxPATH_MKDIR_FULL)) {
+		wxLogMessage("NOAA Weather Plugin, Error creating snapshot folder: %s", fileName.GetPath());
+	}
 
-		// Read remaining lines one by one, until the end of the file
-		while (!textFile.Eof()) {
-			line = textFile.GetNextLine();
+	wxString snapshotFile = fileName.GetFullPath();
+	bool started = stationStore.Refresh(data, useScheduled ? SNAPSHOT_SCHEDULED_REPORTS : SNAPSHOT_STATION_LIST,
+		std::string(snapshotFile.utf8_str()), [this, snapshotFile](NOAA_StationDataPtr stations, bool saved) {
+			// Runs on the worker thread, wxLog is thread safe but everything else waits for the main event loop
+			if (!stations) {
+				wxLogMessage("NOAA Weather Plugin, No stations in the download, keeping the previous stations");
+				return;
+			}
+			wxLogMessage("NOAA Weather Plugin, Parsed %lu stations", (unsigned long)stations->buoys.Size());
+			if (!saved) {
+				wxLogMessage("NOAA Weather Plugin, Error saving snapshot: %s", snapshotFile);
+			}
+			downloadManager.CallAfter([this]() { OnStationsPublished(); });
+		});
 
-			// Process each line of station data, extracting the Id, Name and Location
-			// Each element is separated by the '|' character. For example:
-			// 13002|PR|Atlas Buoy||NE Extension||21.000 N 23.000 W (21&#176;0'0" N 23&#176;0'0" W)|| |
+	if (!started) {
+		wxLogMessage("NOAA Weather Plugin, Station refresh already in progress");
+	}
+}
 
-			wxStringTokenizer tokenizer(line, "|");
+// New station data has been published, redraw every canvas. Each canvas refilters the new data when it is painted
+void NOAA_Plugin::OnStationsPublished(void) {
 
-			buoy.id = tokenizer.GetNextToken();
-			// Skip the next few tokens
-			tokenizer.GetNextToken();
-			tokenizer.GetNextToken();
-			tokenizer.GetNextToken();
-			buoy.name = tokenizer.GetNextToken();
-			tokenizer.GetNextToken();
-			// Parse the location data	
-			ParsePosition(tokenizer.GetNextToken(), &buoy.latitude, &buoy.longitude);
-			//ParsePosition(tokenizer.GetNextToken().ToStdString(), &buoy.latitude, &buoy.longitude);
-			allBuoys.push_back(buoy);
+	for (int i = 0; i < GetCanvasCount(); i++) {
+		wxWindow *canvas = GetCanvasByIndex(i);
+		if (canvas != NULL) {
+			RequestRefresh(canvas);
 		}
-		textFile.Close();
-		return true;
 	}
-	return false;
 }
 
 // Given a station id from the station list retrieve the realtime observations
@@ -504,222 +800,842 @@ bool NOAA_Plugin::DownloadStationList(void) {
 // the different types of reports have file extensions different to .txt
 void NOAA_Plugin::DownloadRealtimeObservation(wxString id, wxString name) {
 
+	// Usually the observations have already been prefetched
+	NOAA_StationHistory *history = histories.Find(id.ToStdString());
+	if ((history != NULL) && (!history->Empty()) &&
+		(prefetchQueue.IsFresh(id.ToStdString(), (long long)(NOAA_Statistics::Now() / 1000)))) {
+		statistics.Increment(COUNTER_PREFETCH_HIT);
+		ShowStationHistory(id, *history);
+		return;
+	}
+
 	// Construct the URL
-	wxString url = "https://www.ndbc.noaa.gov/data/realtime2/";
+	wxString url = ndbcServer + "/data/realtime2/";
 	url.append(id);
 	url.append(".txt");
 
 	wxLogMessage("NOAA Weather Plugin, Downloading Station: %s, url: %s", id, url);
 
-	// Regular Expression to parse realtime observations
-	wxRegEx regex("(\\b(MM)|([A-Z0-9]{4,6})|((-?\\d+\\.)?\\d+)\\b)");
-
-	// BUG BUG Could download as a file and process similarly to scheduled reports
-	// Fetch the station's realtime  weather observation
-	wxString data = ExecuteQuery(url);
-
-	if (data.Length() > 0) {
-		BuoyData buoy;
-		wxStringTokenizer tokenizer(data, "\n\r");
-
-		// Read past the first two lines which are headers
-		tokenizer.GetNextToken();
-		tokenizer.GetNextToken();
-
-		// Read the next line which contains the last reported realtime observation
-		// BUG BUG Could read subsequent lines to display a history
-		wxString line = tokenizer.GetNextToken();
-		
-		// A sample looks like the following. Annoyingly, spaces are used to align it on a text page
-		// #YY  MM DD hh mm WDIR WSPD GST  WVHT   DPD   APD MWD   PRES  ATMP  WTMP  DEWP  VIS PTDY  TIDE
-		// #yr  mo dy hr mn degT m/s   m/s   m     sec   sec degT  hPa  degC  degC  degC   nmi  hPa    ft
-		// 2025 04 04 05 00  27  3.7   MM    MM    MM    MM  MM     MM  30.2    MM    MM   MM   MM    MM
-
-		wxString remainder;
-		remainder = line;
-		// Loop through each matching group
-		int j = 0;
-		
-		while (regex.Matches(remainder)) {
-
-			size_t start, len;
-			regex.GetMatch(&start, &len, 0);
-
-			// Populate the buoy data
-			if (j == 5) {
-				regex.GetMatch(remainder, 1).ToInt(&buoy.windDirection);
+	// Fetch the station's realtime weather observation, displayed once the download completes
+	downloadManager.Enqueue(url, PRIORITY_USER, [this, id](const NOAA_DownloadResult& result) {
+		if (result.status == DOWNLOAD_CANCELLED) {
+			return;
+		}
+		if ((result.status == DOWNLOAD_COMPLETE) && (!result.response.empty())) {
+			ShowRealtimeObservation(id, result.response);
+		}
+		else {
+			wxMessageBox("This buoy does not support weather observations", _T(PLUGIN_COMMON_NAME), wxICON_INFORMATION);
+		}
+	});
+}
+
+// Display the most recent observation from a station's realtime observations.
+// The whole file is merged into the station's history, only the observations newer than
+// those already held are parsed, and the latest observation is shown with the pressure tendency
+void NOAA_Plugin::ShowRealtimeObservation(const wxString& id, const std::vector<char>& data) {
+
+	// A sample looks like the following, newest first. Annoyingly, spaces are used to align it on a text page
+	// #YY  MM DD hh mm WDIR WSPD GST  WVHT   DPD   APD MWD   PRES  ATMP  WTMP  DEWP  VIS PTDY  TIDE
+	// #yr  mo dy hr mn degT m/s   m/s   m     sec   sec degT  hPa  degC  degC  degC   nmi  hPa    ft
+	// 2025 04 04 05 00  27  3.7   MM    MM    MM    MM  MM     MM  30.2    MM    MM   MM   MM    MM
+	uint64_t parseStart = NOAA_Statistics::Now();
+	NOAA_StationHistory& history = histories.Get(id.ToStdString());
+	size_t appended = history.Update(data.data(), data.size());
+	statistics.Record(STAT_PARSE_REALTIME, NOAA_Statistics::Now() - parseStart);
+
+	// So the prefetcher doesn't fetch it again
+	prefetchQueue.Satisfied(id.ToStdString(), !history.Empty(), (long long)(NOAA_Statistics::Now() / 1000));
+
+	if (history.Empty()) {
+		wxMessageBox("This buoy does not support weather observations", _T(PLUGIN_COMMON_NAME), wxICON_INFORMATION);
+		return;
+	}
+
+	wxLogMessage("NOAA Weather Plugin, Station %s, %lu new observations, %lu held", id,
+		(unsigned long)appended, (unsigned long)history.Size());
+
+	ShowStationHistory(id, history);
+}
+
+// The latest observation held for a station, with the pressure tendency
+void NOAA_Plugin::ShowStationHistory(const wxString& id, const NOAA_StationHistory& history) {
+
+	size_t latest = history.Size() - 1;
+	BuoyData buoy;
+	ClearObservation(&buoy);
+	float windDirection = history.Value(latest, REALTIME_WIND_DIRECTION);
+	buoy.windDirection = std::isnan(windDirection) ? NDBC_MISSING_DIRECTION : (int)windDirection;
+	buoy.windSpeed = history.Value(latest, REALTIME_WIND_SPEED);
+	buoy.barometricPressure = history.Value(latest, REALTIME_PRESSURE);
+	buoy.airTemperature = history.Value(latest, REALTIME_AIR_TEMPERATURE);
+
+	wxString observation = FormatObservation(buoy);
+	float pressure, tendency;
+	if (history.Change(REALTIME_PRESSURE, 3 * 3600, &pressure, &tendency)) {
+		observation += wxString::Format("\nPressure Tendency (3 hours): %+0.1f", tendency);
+	}
+	wxMessageBox(observation, id);
+}
+
+// Once the view ports have settled, queue the realtime observations of the stations in view, nearest the
+// vessel first, so double clicking one of them shows its observations without waiting on the download.
+// Zoomed out, only the stations drawn on their own rather than in a cluster are prefetched
+void NOAA_Plugin::PrefetchVisible(void) {
+
+	if ((useScheduled) || (!OCPN_isOnline())) {
+		return;
+	}
+
+	// The five day files share the realtime2 format but are a tenth of the size, and hold far more
+	// than the latest observation and its three hour pressure tendency need
+	std::string baseUrl(wxString(ndbcServer + "/data/5day2/").utf8_str());
+	std::vector<PrefetchRequest> requests;
+	for (const auto& canvas : canvases) {
+		if ((canvas.viewPort.pix_width == 0) || (!canvas.visibleStations)) {
+			continue;
+		}
+
+		// Without a position fix, the stations nearest the centre of the view are fetched first
+		double latitude = std::isnan(currentLatitude) ? canvas.viewPort.clat : currentLatitude;
+		double longitude = std::isnan(currentLongitude) ? canvas.viewPort.clon : currentLongitude;
+
+		const NOAA_StationColumns& buoys = canvas.visibleStations->buoys;
+		for (auto it : canvas.visibleBuoys) {
+			PrefetchRequest request;
+			request.key = buoys.Id(it);
+			request.url = baseUrl + request.key + "_5day.txt";
+			request.distance = NOAA_PositionMonitor::Distance(latitude, longitude, buoys.Latitude(it), buoys.Longitude(it));
+			requests.push_back(request);
+		}
+	}
+
+	prefetchQueue.SetWanted(requests, PREFETCH_STATIONS, (long long)(NOAA_Statistics::Now() / 1000));
+	StartPrefetches();
+}
+
+// Start as many of the queued prefetches as the concurrency and per host limits allow, and come back
+// when the next one may start. The downloads are background priority so the user's requests go first
+void NOAA_Plugin::StartPrefetches(void) {
+
+	long long now = (long long)(NOAA_Statistics::Now() / 1000);
+	PrefetchRequest request;
+	while (prefetchQueue.Next(now, &request)) {
+		std::string key = request.key;
+		downloadManager.Enqueue(wxString::FromUTF8(request.url.c_str()), PRIORITY_BACKGROUND, [this, key](const NOAA_DownloadResult& result) {
+			bool success = false;
+			if ((result.status == DOWNLOAD_COMPLETE) && (!result.response.empty())) {
+				uint64_t parseStart = NOAA_Statistics::Now();
+				NOAA_StationHistory& history = histories.Get(key);
+				history.Update(result.response.data(), result.response.size());
+				statistics.Record(STAT_PARSE_REALTIME, NOAA_Statistics::Now() - parseStart);
+				success = !history.Empty();
 			}
-			if (j == 6) {
-				regex.GetMatch(remainder, 1).ToDouble(&buoy.windSpeed);
+			if (success) {
+				statistics.Increment(COUNTER_PREFETCHED);
 			}
-			if (j == 12) {
-				regex.GetMatch(remainder, 1).ToDouble(&buoy.barometricPressure);
+			prefetchQueue.Complete(key, success, (long long)(NOAA_Statistics::Now() / 1000));
+			StartPrefetches();
+		});
+	}
+
+	long long delay = prefetchQueue.Delay(now);
+	if (delay >= 0) {
+		prefetchPacing.Defer(delay, [this]() { StartPrefetches(); });
+	}
+}
+
+// Read a file as raw bytes
+bool NOAA_Plugin::ReadDataFile(const wxString& fileName, std::vector<char> *buffer) {
+
+	wxFile dataFile;
+	if (!dataFile.Open(fileName, wxFile::read)) {
+		wxLogMessage("NOAA Weather Plugin, Error opening %s", fileName);
+		return false;
+	}
+
+	buffer->resize(dataFile.Length());
+	if ((buffer->size() > 0) && (dataFile.Read(buffer->data(), buffer->size()) != (ssize_t)buffer->size())) {
+		wxLogMessage("NOAA Weather Plugin, Error reading %s", fileName);
+		return false;
+	}
+	return true;
+}
+
+// Scheduled reports and the station list are kept in separate snapshots so switching modes doesn't mix them up
+wxString NOAA_Plugin::GetSnapshotFileName(void) {
+
+	return wxFileName(GetDataFolder(), useScheduled ? "observations.bin" : "stations.bin").GetFullPath();
+}
+
+// Folder for the plugin's snapshots and cached responses
+wxString NOAA_Plugin::GetDataFolder(void) {
+
+	wxFileName folder = wxFileName::DirName(*GetpPrivateApplicationDataLocation());
+	folder.AppendDir("plugins");
+	folder.AppendDir(PLUGIN_PACKAGE_NAME);
+	return folder.GetPath();
+}
+
+// Load the snapshot saved from the last successful download
+bool NOAA_Plugin::LoadStationSnapshot(void) {
+
+	wxString fileName = GetSnapshotFileName();
+	if (!wxFileExists(fileName)) {
+		return false;
+	}
+
+	SnapshotInfo info;
+	NOAA_StationColumns buoys;
+	if ((!LoadSnapshot(std::string(fileName.utf8_str()), &info, &buoys)) ||
+		(info.content != (useScheduled ? SNAPSHOT_SCHEDULED_REPORTS : SNAPSHOT_STATION_LIST))) {
+		wxLogMessage("NOAA Weather Plugin, Ignoring invalid snapshot: %s", fileName);
+		return false;
+	}
+
+	unsigned long count = (unsigned long)buoys.Size();
+	stationStore.Publish(NOAA_StationStore::Build(info.content, info.sourceHash, buoys));
+
+	wxLogMessage("NOAA Weather Plugin, Loaded %lu stations from snapshot created %s", count,
+		wxDateTime((time_t)info.created).FormatISOCombined());
+	return true;
+}
+
+// BUG BUG Add Date Time fields
+// BUG BUG Format using user's speed and temperature units
+// Format an observation for display, values not reported by the station are shown as "MM"
+wxString NOAA_Plugin::FormatObservation(const BuoyData& buoy) {
+
+	wxString windDirection = IsReported(buoy.windDirection) ? wxString::Format("%d", buoy.windDirection) : wxString("MM");
+	wxString windSpeed = IsReported(buoy.windSpeed) ? wxString::Format("%0.2f", buoy.windSpeed) : wxString("MM");
+	wxString pressure = IsReported(buoy.barometricPressure) ? wxString::Format("%0.2f", buoy.barometricPressure) : wxString("MM");
+	wxString temperature = IsReported(buoy.airTemperature) ? wxString::Format("%0.2f", buoy.airTemperature) : wxString("MM");
+
+	return wxString::Format("Wind Direction: %s\nWind Speed %s\nPressure: %s\nTemperature: %s",
+		windDirection, windSpeed, pressure, temperature);
+}
+
+// Check the outcome of a download. Errors are always logged, but only reported
+// to the user if they initiated the download
+bool NOAA_Plugin::CheckDownload(const NOAA_DownloadResult& result, bool notifyUser) {
+
+	if (result.status == DOWNLOAD_COMPLETE) {
+		wxLogMessage("NOAA Weather Plugin, Successfully downloaded %s", result.url);
+		return true;
+	}
+
+	if (result.status == DOWNLOAD_FAILED) {
+		wxLogMessage("NOAA Weather Plugin, Error %d downloading URL: %s", result.errorCode, result.url);
+		if (notifyUser) {
+			wxMessageBox(wxString::Format("Download error, Please review log for further details"),
+				_T(PLUGIN_COMMON_NAME), wxICON_ERROR);
+		}
+	}
+	return false;
+}
+
+// Parse a JSON response, logging any errors
+// The response is parsed directly from the downloaded bytes
+bool NOAA_Plugin::ParseJson(const std::vector<char>& jsonResponse, wxJSONValue *root) {
+
+	wxJSONReader reader;
+	wxMemoryInputStream stream(jsonResponse.data(), jsonResponse.size());
+
+	// Check for any JSON parsing errors
+	if (reader.Parse(stream, root) > 0) {
+		wxLogMessage("NOAA Weather Plugin, Json parser error(s) in the following response:\n%s",
+			wxString::FromUTF8(jsonResponse.data(), jsonResponse.size()));
+		for (auto it : reader.GetErrors()) {
+			wxLogMessage("NOAA Weather Plugin, Json parser error: %s", it);
+		}
+		return false;
+	}
+	return true;
+}
+
+// Retrieve the url from NOAA from which to find a forecast given a vessel's position,
+// and once known, retrieve and display the forecast itself
+// Unless displayed, the forecast is only downloaded into the response cache, in the background and without reporting errors
+void NOAA_Plugin::RequestForecast(const double &latitude, const double &longitude, bool display) {
+
+	// Nearby positions share a forecast grid cell, so usually the url is already known
+	std::string gridUrl;
+	if (pointsCache.Find(latitude, longitude, (long long)wxDateTime::Now().GetTicks(), POINTS_MAX_AGE, &gridUrl)) {
+		statistics.Increment(COUNTER_POINTS_HIT);
+		RequestGridData(wxString::FromUTF8(gridUrl.c_str()), display);
+		return;
+	}
+	statistics.Increment(COUNTER_POINTS_MISS);
+
+	// NWS redirects requests with more than four decimal places
+	wxString url = wxString::Format("%s/points/%.4f,%.4f", nwsServer, latitude, longitude);
+
+	// The lookup is timed from the request to the parsed response, including any time spent queued
+	uint64_t lookupStart = NOAA_Statistics::Now();
+	downloadManager.Enqueue(url, display ? PRIORITY_USER : PRIORITY_BACKGROUND, [this, latitude, longitude, lookupStart, display](const NOAA_DownloadResult& result) {
+		if (!CheckDownload(result, display)) {
+			return;
+		}
+
+		wxString forecastUrl = wxEmptyString;
+		wxJSONValue root;
+		if (ParseJson(result.response, &root)) {
+			if (root["properties"].HasMember("forecastGridData")) {
+				forecastUrl = root["properties"]["forecastGridData"].AsString();
 			}
-			if (j == 13) {
-				regex.GetMatch(remainder, 1).ToDouble(&buoy.airTemperature);
+		}
+		statistics.Record(STAT_POINTS_LOOKUP, NOAA_Statistics::Now() - lookupStart);
+
+		if (forecastUrl.Length() > 0) {
+			pointsCache.Add(latitude, longitude, (long long)wxDateTime::Now().GetTicks(), std::string(forecastUrl.utf8_str()));
+			SavePointsCache();
+
+			// Once we have the url, can now retrieve the actual forecast
+			RequestGridData(forecastUrl, display);
+		}
+		else {
+			if (display) {
+				wxMessageBox("Error retrieving forecast\nPlease check OpenCPN log",
+					_T(PLUGIN_COMMON_NAME), wxICON_ERROR);
 			}
-			remainder = remainder.Mid(start + len);
-			j++;
+			wxLogMessage("NOAA Weather Plugin, Error retrieving forecast URL: %s", result.url);
 		}
-		wxMessageBox(wxString::Format("Wind Direction: %d\nWind Speed %0.2f\nPressure: %0.2f\nTemperature: %0.2f",
-			buoy.windDirection, buoy.windSpeed, buoy.barometricPressure, buoy.airTemperature), id);
+	});
+}
+
+// The waypoints of the active route still to be reached, starting from the vessel's position
+bool NOAA_Plugin::GetActiveRouteWaypoints(std::vector<RouteWaypoint> *waypoints) {
+
+	waypoints->clear();
+	wxString routeGuid = GetActiveRouteGUID();
+	if (routeGuid.IsEmpty()) {
+		return false;
 	}
-	else {
-		wxMessageBox("This buoy does not support weather observations",_T(PLUGIN_COMMON_NAME), wxICON_INFORMATION);
+
+	std::unique_ptr<PlugIn_Route_Ex> route = GetRouteEx_Plugin(routeGuid);
+	if ((!route) || (route->pWaypointList == NULL)) {
+		return false;
 	}
+
+	std::vector<RouteWaypoint> routeWaypoints;
+	std::vector<wxString> guids;
+	for (Plugin_WaypointExList::compatibility_iterator node = route->pWaypointList->GetFirst(); node; node = node->GetNext()) {
+		PlugIn_Waypoint_Ex *routeWaypoint = node->GetData();
+		RouteWaypoint waypoint;
+		waypoint.name = routeWaypoint->m_MarkName.IsEmpty() ? wxString::Format("WP %lu", (unsigned long)(routeWaypoints.size() + 1)).ToStdString() :
+			std::string(routeWaypoint->m_MarkName.utf8_str());
+		waypoint.latitude = routeWaypoint->m_lat;
+		waypoint.longitude = routeWaypoint->m_lon;
+		routeWaypoints.push_back(waypoint);
+		guids.push_back(routeWaypoint->m_GUID);
+	}
+
+	// Underway, the route starts from the vessel towards the active waypoint
+	auto active = std::find(guids.begin(), guids.end(), GetActiveWaypointGUID());
+	size_t first = 0;
+	if ((active != guids.end()) && (!std::isnan(currentLatitude)) && (!std::isnan(currentLongitude))) {
+		first = active - guids.begin();
+		RouteWaypoint vessel;
+		vessel.name = "Vessel";
+		vessel.latitude = currentLatitude;
+		vessel.longitude = currentLongitude;
+		waypoints->push_back(vessel);
+	}
+	waypoints->insert(waypoints->end(), routeWaypoints.begin() + first, routeWaypoints.end());
+	return waypoints->size() >= 2;
 }
 
-// BUG BUG Add Date Time fields
-// BUG BUG Format using user's speed and temperature units
-// Download scheduled reports
-// The format of this data is slightly different to a realtime obsservation as it includes the station id
-bool NOAA_Plugin::DownloadScheduledReports(void) {
+// Sample the active route and find the forecast cell of each sample. Cells not in the points cache
+// are looked up first, then the forecast of each distinct cell is downloaded, each only once.
+// The cells of earlier requests are kept, so after a route is edited only the cells it has moved into are downloaded
+void NOAA_Plugin::RequestRouteForecast(void) {
+
+	std::vector<RouteWaypoint> waypoints;
+	if (!GetActiveRouteWaypoints(&waypoints)) {
+		wxMessageBox("Activate a route to see the forecast along it", _T(PLUGIN_COMMON_NAME), wxICON_INFORMATION);
+		return;
+	}
 
-	// Download the file, Should probably name the file using some data time information
-	wxString fileName = wxStandardPaths::Get().GetDocumentsDir() + wxFileName::GetPathSeparator() + "observations.txt";
-	if (DownloadFile("https://www.ndbc.noaa.gov/data/latest_obs/latest_obs.txt", fileName)) {
+	double speed = ((!std::isnan(currentSpeed)) && (currentSpeed >= ROUTE_MINIMUM_SPEED)) ? currentSpeed : routeSpeed;
+	long long now = (long long)wxDateTime::Now().GetTicks();
+	routeForecast.Plan(waypoints, speed, now);
 
-		// The weather observations are in the following format. Annoyingly, spaces are used to align it on a text page
-		// #STN       LAT      LON  YYYY MM DD hh mm WDIR WSPD   GST WVHT  DPD APD MWD   PRES  PTDY  ATMP  WTMP  DEWP  VIS   TIDE
-		// #text      deg      deg   yr mo day hr mn degT  m/s   m/s   m   sec sec degT   hPa   hPa  degC  degC  degC  nmi     ft
-		// 13001    12.000  -23.000 2025 04 07 15 00 356   6.8   8.0   MM  MM   MM  MM 1011.1    MM  23.3  24.0    MM   MM     MM
+	long generation = ++routeGeneration;
+	routePending = 0;
 
-		// Parse the file and extract the weather observations
-		wxTextFile textFile;
-		textFile.Open(fileName);
+	for (auto it = routeUncovered.begin(); it != routeUncovered.end(); ) {
+		it = (now - it->second >= ROUTE_UNCOVERED_AGE) ? routeUncovered.erase(it) : std::next(it);
+	}
 
-		wxString line;
-		wxString remainder;
-		BuoyData buoy;
-		allBuoys.clear();
+	std::set<std::string> lookups;
+	for (size_t i = 0; i < routeForecast.Samples(); i++) {
+		double latitude = routeForecast.SampleLatitude(i);
+		double longitude = routeForecast.SampleLongitude(i);
+		std::string gridUrl;
+		std::string position(wxString::Format("%.2f,%.2f", latitude, longitude).ToStdString());
+		if ((!pointsCache.Find(latitude, longitude, now, POINTS_MAX_AGE, &gridUrl)) &&
+			(routeUncovered.count(position) == 0) && (lookups.insert(position).second)) {
+			statistics.Increment(COUNTER_POINTS_MISS);
+			LookupRouteCell(latitude, longitude, generation);
+		}
+	}
 
-		// Regular Expression to parse weather observations
-		wxRegEx regex("(\\b(MM)|([A-Z0-9]{4,6})|((-?\\d+\\.)?\\d+)\\b)");
+	if (routePending == 0) {
+		FetchRouteCells(generation);
+	}
+}
 
-		// Read past the first two lines which are headers
-		textFile.GetFirstLine();
-		textFile.GetNextLine();
+// Find the forecast cell of a sample, positions off the coast often have none
+void NOAA_Plugin::LookupRouteCell(double latitude, double longitude, long generation) {
 
-		// Read remaining lines one by one, until the end of the file
-		while (!textFile.Eof()) {
-			line = textFile.GetNextLine();
+	routePending++;
+	wxString url = wxString::Format("%s/points/%.4f,%.4f", nwsServer, latitude, longitude);
+	downloadManager.Enqueue(url, PRIORITY_USER, [this, latitude, longitude, generation](const NOAA_DownloadResult& result) {
+		if (generation != routeGeneration) {
+			return;
+		}
 
-			remainder = line;
-			// Loop through each matching group
-			int j = 0;
+		wxJSONValue root;
+		if ((result.status == DOWNLOAD_COMPLETE) && (ParseJson(result.response, &root)) &&
+			(root["properties"].HasMember("forecastGridData"))) {
+			pointsCache.Add(latitude, longitude, (long long)wxDateTime::Now().GetTicks(),
+				std::string(root["properties"]["forecastGridData"].AsString().utf8_str()));
+		}
+		// The NWS answers 404 for positions outside its grids (eg. offshore), don't ask again on every request
+		else if ((result.status == DOWNLOAD_COMPLETE) || ((result.status == DOWNLOAD_FAILED) && (result.httpStatus == 404))) {
+			routeUncovered[wxString::Format("%.2f,%.2f", latitude, longitude).ToStdString()] = (long long)wxDateTime::Now().GetTicks();
+		}
 
-			while (regex.Matches(remainder)) {
+		if (--routePending == 0) {
+			SavePointsCache();
+			FetchRouteCells(generation);
+		}
+	});
+}
 
-				size_t start, len;
-				regex.GetMatch(&start, &len, 0);
+// Download the forecast of each distinct cell along the route that isn't already held
+void NOAA_Plugin::FetchRouteCells(long generation) {
 
-				// Populate the buoy data
-				if (j == 0) {
-					buoy.id = regex.GetMatch(remainder, 1);
-				}
-				if (j == 1) {
-					regex.GetMatch(remainder, 1).ToDouble(&buoy.latitude);
-				}
-				if (j == 2) {
-					regex.GetMatch(remainder, 1).ToDouble(&buoy.longitude);
-				}
-				if (j == 8) {
-					regex.GetMatch(remainder, 1).ToInt(&buoy.windDirection);
-				}
-				if (j == 9) {
-					regex.GetMatch(remainder, 1).ToDouble(&buoy.windSpeed);
-				}
-				if (j == 15) {
-					regex.GetMatch(remainder, 1).ToDouble(&buoy.barometricPressure);
+	long long now = (long long)wxDateTime::Now().GetTicks();
+	for (size_t i = 0; i < routeForecast.Samples(); i++) {
+		std::string gridUrl;
+		if (pointsCache.Find(routeForecast.SampleLatitude(i), routeForecast.SampleLongitude(i), now, POINTS_MAX_AGE, &gridUrl)) {
+			routeForecast.SetCell(i, gridUrl);
+		}
+	}
+
+	routePending = 0;
+	for (const auto& it : routeForecast.Cells()) {
+		if (routeForecast.HasForecast(it, now, CACHE_AGE_FORECAST)) {
+			continue;
+		}
+
+		routePending++;
+		std::string key = it;
+		downloadManager.EnqueueCached(wxString::FromUTF8(key.c_str()), CACHE_AGE_FORECAST, CACHE_STALE_FORECAST, PRIORITY_USER, [this, key, generation](const NOAA_DownloadResult& result) {
+			if (generation != routeGeneration) {
+				return;
+			}
+
+			if (CheckDownload(result, false)) {
+				NOAA_Forecast forecast;
+				std::string error;
+				uint64_t parseStart = NOAA_Statistics::Now();
+				if (ExtractForecastLayers(result.response.data(), result.response.size(), NOAA_RouteForecast::GetLayerNames(), &forecast, &error)) {
+					routeForecast.SetForecast(key, forecast, (long long)wxDateTime::Now().GetTicks());
 				}
-				if (j == 17) {
-					regex.GetMatch(remainder, 1).ToDouble(&buoy.airTemperature);
+				else {
+					wxLogMessage("NOAA Weather Plugin, Error parsing route forecast %s: %s", result.url, wxString::FromUTF8(error.c_str()));
 				}
-				allBuoys.push_back(buoy);
-				remainder = remainder.Mid(start + len);
-				j++;
+				statistics.Record(STAT_PARSE_FORECAST, NOAA_Statistics::Now() - parseStart);
+			}
+
+			if (--routePending == 0) {
+				ShowRouteForecast();
+			}
+		});
+	}
+
+	if (routePending == 0) {
+		ShowRouteForecast();
+	}
+}
+
+// One line per waypoint, its ETA and the forecast for then
+void NOAA_Plugin::ShowRouteForecast(void) {
+
+	std::vector<RouteForecastRow> rows;
+	routeForecast.Compute(&rows);
+
+	wxString degrees = wxString::FromUTF8("\xC2\xB0");
+	wxString message;
+	for (const auto& it : rows) {
+		wxString wind = "No forecast";
+		if (!std::isnan(it.windSpeed)) {
+			wind = std::isnan(it.windDirection) ? wxString::Format("%.0f kn", it.windSpeed) :
+				wxString::Format("%03.0f%s %.0f kn", it.windDirection, degrees, it.windSpeed);
+			if (!std::isnan(it.windGust)) {
+				wind += wxString::Format(", gusts %.0f kn", it.windGust);
 			}
 		}
-		textFile.Close();
-		return true;
+		if (!std::isnan(it.temperature)) {
+			wind += wxString::Format(", %.0f%sC", it.temperature, degrees);
+		}
+
+		message += wxString::Format("%s  %s  %.1f nm\n    %s", wxString::FromUTF8(it.name.c_str()),
+			wxDateTime((time_t)it.eta).Format("%a %H:%M"), it.distance, wind);
+		if (!std::isnan(it.legWindSpeed)) {
+			message += wxString::Format("\n    Next leg up to %.0f kn", it.legWindSpeed);
+		}
+		message += "\n";
 	}
-	return false;
+	wxMessageBox(message, _T("NOAA Route Forecast"), wxICON_INFORMATION);
 }
 
-// Retrieve a file such as the station list or scheduled reports from the NOAA NDBC Web Site
-// BUG BUG Could refactor ExecuteQuery  rather than duplicate code....
-bool NOAA_Plugin::DownloadFile(wxString url, wxString filename) {
+// Retrieve and display the forecast for a grid cell
+void NOAA_Plugin::RequestGridData(const wxString& url, bool display) {
 
-	// Download and save the file to a specified location
-	wxURI uri(url);
+	downloadManager.EnqueueCached(url, CACHE_AGE_FORECAST, CACHE_STALE_FORECAST, display ? PRIORITY_USER : PRIORITY_BACKGROUND, [this, display](const NOAA_DownloadResult& result) {
+		if ((!CheckDownload(result, display)) || (!display)) {
+			return;
+		}
 
-	_OCPN_DLStatus returnCode = OCPN_downloadFile(uri.BuildURI(), filename,
-		_T(PLUGIN_COMMON_NAME), wxEmptyString, pluginBitmap, NULL,
-		OCPN_DLDS_ELAPSED_TIME | OCPN_DLDS_AUTO_CLOSE, 10);
+		// Only the layers the dialog shows are extracted, the rest of the (large) response is skipped.
+		// The names of the other numeric layers are noted, so the dialog can extract them on demand
+		NOAA_Forecast forecast;
+		std::string error;
+		std::vector<std::string> available;
+		uint64_t parseStart = NOAA_Statistics::Now();
+		bool parsed = ExtractForecastLayers(result.response.data(), result.response.size(),
+			NOAA_Plugin_Dialog::GetLayerNames(), &forecast, &error, &available);
+		statistics.Record(STAT_PARSE_FORECAST, NOAA_Statistics::Now() - parseStart);
+		if (!parsed) {
+			wxLogMessage("NOAA Weather Plugin, Error parsing forecast: %s, %s", result.url, error);
+			wxMessageBox("Error retrieving forecast\nPlease check OpenCPN log",
+				_T(PLUGIN_COMMON_NAME), wxICON_ERROR);
+			return;
+		}
 
+		// Display the forecast values in a simple data grid
+		// BUG BUG Should this be a modal dialog?
+		NOAA_StatisticsTimer timer(&statistics, STAT_DIALOG);
+		NOAA_Plugin_Dialog* dialog = new NOAA_Plugin_Dialog(parentWindow, forecast, available, result.response);
+		dialog->Show();
+	});
+}
 
-	if (returnCode == OCPN_DL_NO_ERROR) {
-		wxLogMessage("NOAA Weather Plugin, Successfully downloaded %s to %s", url, filename);
-		return true;
+// The points cache is small, so it is simply rewritten whenever it changes
+void NOAA_Plugin::LoadPointsCache(void) {
+
+	wxString fileName = wxFileName(GetDataFolder(), "points.txt").GetFullPath();
+	std::vector<char> buffer;
+	if ((wxFileExists(fileName)) && (ReadDataFile(fileName, &buffer))) {
+		if (pointsCache.Deserialize(buffer.data(), buffer.size())) {
+			pointsCache.Expire((long long)wxDateTime::Now().GetTicks(), POINTS_MAX_AGE);
+		}
 	}
-	else {
-		wxLogMessage("NOAA Weather Plugin, Error %d downloading URL: %s", returnCode, url);
-		wxMessageBox(wxString::Format("Download error, Please review log for further details"),
-			_T(PLUGIN_COMMON_NAME), wxICON_ERROR);
+}
+
+void NOAA_Plugin::SavePointsCache(void) {
+
+	wxFileName fileName(GetDataFolder(), "points.txt");
+	if (!fileName.Mkdir(wxS_DIR_DEFAULT, wxPATH_MKDIR_FULL)) {
+		return;
+	}
+
+	std::string data = pointsCache.Serialize();
+	wxFile pointsFile;
+	if ((!pointsFile.Create(fileName.GetFullPath(), true)) || (pointsFile.Write(data.data(), data.size()) != data.size())) {
+		wxLogMessage("NOAA Weather Plugin, Error saving %s", fileName.GetFullPath());
 	}
-	return false;
 }
 
-// Retrieve the url from NOAA from which to find a forecast given a vessel's position
-wxString NOAA_Plugin::GetForecastUrl(const double &latitude, const double &longitude) {
+// wxJSON keeps whole numbers as integers
+static double ReadNumber(const wxJSONValue& value) {
 
-	wxString url = wxString::Format("https://api.weather.gov/points/%f,%f", latitude, longitude);
-	wxString response = wxEmptyString;
+	if (value.IsDouble()) {
+		return value.AsDouble();
+	}
+	if (value.IsInt()) {
+		return value.AsInt();
+	}
+	if (value.IsLong()) {
+		return value.AsLong();
+	}
+	return std::numeric_limits<double>::quiet_NaN();
+}
 
-	wxString jsonResponse = ExecuteQuery(url);
-	
-	wxJSONReader reader;
-	wxJSONValue root;
+// Append the polygons of a GeoJSON Polygon or MultiPolygon geometry
+static void ReadGeometry(const wxJSONValue& geometry, std::vector<AlertPolygon> *polygons) {
 
-	// Check for any JSON parsing errors
-	if (reader.Parse(jsonResponse, &root) > 0) {
-			wxLogMessage("NOAA Weather Plugin, Json parser error(s) in the following response:\n%s", jsonResponse);
-			for (auto it : reader.GetErrors()) {
-				wxLogMessage("NOAA Weather Plugin, Json parser error: %s", it);
+	wxJSONValue coordinates = geometry.ItemAt("coordinates");
+	wxString type = geometry.ItemAt("type").AsString();
+
+	// A Polygon is an array of rings, a MultiPolygon an array of Polygons
+	std::vector<wxJSONValue> sources;
+	if (type == "Polygon") {
+		sources.push_back(coordinates);
+	}
+	else if (type == "MultiPolygon") {
+		for (int i = 0; i < coordinates.Size(); i++) {
+			sources.push_back(coordinates.ItemAt(i));
+		}
+	}
+
+	for (const auto& source : sources) {
+		AlertPolygon polygon;
+		for (int i = 0; i < source.Size(); i++) {
+			wxJSONValue points = source.ItemAt(i);
+			AlertRing ring;
+			ring.reserve(points.Size() * 2);
+			for (int j = 0; j < points.Size(); j++) {
+				wxJSONValue point = points.ItemAt(j);
+				ring.push_back(ReadNumber(point.ItemAt(0)));
+				ring.push_back(ReadNumber(point.ItemAt(1)));
+			}
+			if (ring.size() >= 6) {
+				polygon.push_back(ring);
 			}
+		}
+		if (!polygon.empty()) {
+			polygons->push_back(polygon);
+		}
 	}
-	else {
-		if (root["properties"].HasMember("forecastGridData")) {
-			response = root["properties"]["forecastGridData"].AsString();
+}
+
+// Convert an alert feature, optionally returning the urls of the zones it affects
+static void ReadAlert(const wxJSONValue& feature, AlertData *alert, std::vector<std::string> *zones) {
+
+	wxJSONValue properties = feature.ItemAt("properties");
+	alert->id = std::string(properties.ItemAt("id").AsString().utf8_str());
+	alert->event = std::string(properties.ItemAt("event").AsString().utf8_str());
+	alert->severity = std::string(properties.ItemAt("severity").AsString().utf8_str());
+	alert->headline = std::string(properties.ItemAt("headline").AsString().utf8_str());
+	alert->description = std::string(properties.ItemAt("description").AsString().utf8_str());
+	alert->expires = std::string(properties.ItemAt("expires").AsString().utf8_str());
+
+	// The geometry is null for alerts issued by zone
+	wxJSONValue geometry = feature.ItemAt("geometry");
+	if (geometry.IsObject()) {
+		ReadGeometry(geometry, &alert->polygons);
+	}
+
+	wxJSONValue affectedZones = properties.ItemAt("affectedZones");
+	for (int i = 0; (zones != NULL) && (i < affectedZones.Size()); i++) {
+		zones->push_back(std::string(affectedZones.ItemAt(i).AsString().utf8_str()));
+	}
+}
+
+// Marine Weather Alerts can be retrieved directly given the vessel's current position.
+// No need to retrieve the root object to determine the grid or station id.
+void NOAA_Plugin::RequestAlerts(const double &latitude, const double &longitude) {
+
+	// Example URL https://api.weather.gov/alerts/active?point=47.606210,-122.33207
+	wxString url = wxString::Format("%s/alerts/active?point=%07.4f,%08.4f", nwsServer, latitude, longitude);
+
+	downloadManager.EnqueueCached(url, CACHE_AGE_ALERTS, CACHE_STALE_ALERTS, PRIORITY_USER, [this](const NOAA_DownloadResult& result) {
+		if (!CheckDownload(result, true)) {
+			return;
+		}
+
+		wxJSONValue root;
+		uint64_t parseStart = NOAA_Statistics::Now();
+		bool parsed = ParseJson(result.response, &root);
+		statistics.Record(STAT_PARSE_ALERTS, NOAA_Statistics::Now() - parseStart);
+		if (parsed) {
+			// If there are no warnings, the "features" array is empty
+			std::vector<AlertData> alerts;
+			for (int i = 0; (root["features"].IsArray()) && (i < root["features"].Size()); i++) {
+				AlertData alert;
+				ReadAlert(root["features"][i], &alert, NULL);
+				alerts.push_back(alert);
+			}
+			ShowAlerts(alerts);
+		}
+	});
+}
+
+// Display every alert applying to the vessel's position
+void NOAA_Plugin::ShowAlerts(const std::vector<AlertData>& alerts) {
+
+	if (alerts.empty()) {
+		wxMessageBox("No alerts issued by NWS, but the prudent mariner will check other information sources",
+			_T(PLUGIN_COMMON_NAME), wxICON_INFORMATION);
+		return;
+	}
+
+	wxString message;
+	for (const auto& it : alerts) {
+		if (!message.IsEmpty()) {
+			message += "\n\n";
 		}
+		message += wxString::FromUTF8(it.headline.c_str()) + "\n" + wxString::FromUTF8(it.description.c_str());
 	}
-	return response;
+	wxString title = (alerts.size() == 1) ? wxString::FromUTF8(alerts[0].event.c_str()) :
+		wxString::Format("%lu NOAA Alerts", (unsigned long)alerts.size());
+	wxMessageBox(message, title, wxICON_WARNING);
 }
 
-// Just a wrapper around the OpenCPN API which in turn wraps the wxCurl API
-wxString NOAA_Plugin::ExecuteQuery(const wxString endpoint) {
+// Download the active marine alerts in a single request. The alerts applying to the vessel
+// are then found locally from their areas, see SetPositionFix
+void NOAA_Plugin::RefreshAlerts(void) {
 
-	wxString response = wxEmptyString;
-	wxURI uri(endpoint);
-	wxString temporaryFileName = wxFileName::CreateTempFileName("tmp");
+	wxString url = wxString::Format("%s/alerts/active?status=actual&region_type=marine", nwsServer);
 
-	_OCPN_DLStatus returnCode = OCPN_downloadFile(uri.BuildURI(), temporaryFileName,
-		_T(PLUGIN_COMMON_NAME), wxEmptyString, pluginBitmap, NULL,
-		OCPN_DLDS_ELAPSED_TIME | OCPN_DLDS_AUTO_CLOSE, 10);
+	downloadManager.EnqueueCached(url, CACHE_AGE_ALERTS, CACHE_STALE_ALERTS, PRIORITY_BACKGROUND, [this](const NOAA_DownloadResult& result) {
+		if (!CheckDownload(result, false)) {
+			return;
+		}
+		OnAlertsDownloaded(result.response);
+	});
+}
+
+// Many marine alerts have no geometry of their own, only the forecast zones they affect.
+// Those zones' boundaries are downloaded (and cached for a week) and used as the alert's area
+void NOAA_Plugin::OnAlertsDownloaded(const std::vector<char>& response) {
 
-	if (returnCode == OCPN_DL_NO_ERROR) {
-		wxFile dataFile;
-		dataFile.Open(temporaryFileName, wxFile::read);
-		dataFile.ReadAll(&response);
+	wxJSONValue root;
+	uint64_t parseStart = NOAA_Statistics::Now();
+	bool parsed = ParseJson(response, &root);
+	if (!parsed) {
+		statistics.Record(STAT_PARSE_ALERTS, NOAA_Statistics::Now() - parseStart);
+		return;
 	}
-	else {
-		wxLogMessage("NOAA Weather Plugin, Error %d dowloading URL: %d", returnCode, endpoint);
-		wxMessageBox(wxString::Format("Download error, Please review log for further details"), 
-			_T(PLUGIN_COMMON_NAME), wxICON_ERROR);
+
+	activeAlerts.clear();
+	activeAlertZones.clear();
+	for (int i = 0; (root["features"].IsArray()) && (i < root["features"].Size()); i++) {
+		AlertData alert;
+		std::vector<std::string> zones;
+		ReadAlert(root["features"][i], &alert, &zones);
+		if (!alert.polygons.empty()) {
+			zones.clear();
+		}
+		activeAlerts.push_back(alert);
+		activeAlertZones.push_back(zones);
+	}
+	statistics.Record(STAT_PARSE_ALERTS, NOAA_Statistics::Now() - parseStart);
+
+	for (const auto& zones : activeAlertZones) {
+		for (const auto& it : zones) {
+			if (zonesRequested.insert(it).second) {
+				DownloadZone(wxString::FromUTF8(it.c_str()));
+			}
+		}
 	}
 
-	// Try to clean up...
-	wxRemoveFile(temporaryFileName);
+	// Build with the zones on hand, and again once the missing zones have been downloaded
+	BuildAlertIndex();
+}
+
+void NOAA_Plugin::DownloadZone(const wxString& url) {
+
+	pendingZones++;
+	downloadManager.EnqueueCached(url, CACHE_AGE_ZONES, CACHE_STALE_ZONES, PRIORITY_BACKGROUND, [this, url](const NOAA_DownloadResult& result) {
+		pendingZones--;
+		std::string key = std::string(url.utf8_str());
+
+		wxJSONValue root;
+		if ((CheckDownload(result, false)) && (ParseJson(result.response, &root))) {
+			ReadGeometry(root["geometry"], &zoneAreas[key]);
+		}
+		else {
+			// Try again at the next refresh
+			zonesRequested.erase(key);
+		}
 
-	return response;
-}
\ No newline at end of file
+		if (pendingZones == 0) {
+			BuildAlertIndex();
+		}
+	});
+}
+
+// Index the active alerts, using the zone boundaries for the alerts without a geometry.
+// Zones no active alert refers to any more are forgotten, they are downloaded again (usually from the cache) if needed
+void NOAA_Plugin::BuildAlertIndex(void) {
+
+	std::set<std::string> referenced;
+	for (const auto& zones : activeAlertZones) {
+		referenced.insert(zones.begin(), zones.end());
+	}
+	for (auto it = zoneAreas.begin(); it != zoneAreas.end(); ) {
+		it = (referenced.count(it->first) == 0) ? zoneAreas.erase(it) : std::next(it);
+	}
+	for (auto it = zonesRequested.begin(); it != zonesRequested.end(); ) {
+		it = (referenced.count(*it) == 0) ? zonesRequested.erase(it) : std::next(it);
+	}
+
+	std::vector<AlertData> alerts = activeAlerts;
+	for (size_t i = 0; i < alerts.size(); i++) {
+		for (const auto& it : activeAlertZones[i]) {
+			auto zone = zoneAreas.find(it);
+			if (zone != zoneAreas.end()) {
+				alerts[i].polygons.insert(alerts[i].polygons.end(), zone->second.begin(), zone->second.end());
+			}
+		}
+	}
+
+	alertIndex.Build(alerts);
+	alertsLoaded = true;
+	alertIndex.Query(currentLatitude, currentLongitude, &positionAlerts);
+
+	wxLogMessage("NOAA Weather Plugin, Indexed %lu alerts, %lu areas, %lu apply at the vessel's position",
+		(unsigned long)alertIndex.Size(), (unsigned long)alertIndex.PolygonCount(), (unsigned long)positionAlerts.size());
+}
+
+// Summarize the statistics as JSON, timers are in microseconds
+wxJSONValue NOAA_Plugin::GetStatistics(void) {
+
+	wxJSONValue root;
+	root["version"] = wxString::Format("%d.%d", PLUGIN_VERSION_MAJOR, PLUGIN_VERSION_MINOR);
+	root["uptime"] = (wxInt64)statistics.Uptime();
+
+	for (int i = 0; i < STAT_HISTOGRAMS; i++) {
+		HistogramSummary summary = statistics.Summarize((STATISTIC)i);
+		wxJSONValue histogram;
+		histogram["unit"] = wxString(NOAA_Statistics::Unit((STATISTIC)i));
+		histogram["count"] = (wxInt64)summary.count;
+		histogram["mean"] = (summary.count > 0) ? (double)summary.sum / summary.count : 0.0;
+		histogram["p50"] = (wxInt64)summary.p50;
+		histogram["p90"] = (wxInt64)summary.p90;
+		histogram["p99"] = (wxInt64)summary.p99;
+		histogram["max"] = (wxInt64)summary.maximum;
+		root["histograms"][NOAA_Statistics::Name((STATISTIC)i)] = histogram;
+	}
+
+	for (int i = 0; i < COUNTER_COUNT; i++) {
+		root["counters"][NOAA_Statistics::Name((COUNTER)i)] = (wxInt64)statistics.Counter((COUNTER)i);
+	}
+
+	// Fresh and stale hits both avoid waiting on the network
+	uint64_t cacheHits = statistics.Counter(COUNTER_CACHE_FRESH) + statistics.Counter(COUNTER_CACHE_STALE);
+	uint64_t cacheLookups = cacheHits + statistics.Counter(COUNTER_CACHE_MISS);
+	root["cacheHitRate"] = (cacheLookups > 0) ? (double)cacheHits / cacheLookups : 0.0;
+
+	uint64_t pointsLookups = statistics.Counter(COUNTER_POINTS_HIT) + statistics.Counter(COUNTER_POINTS_MISS);
+	root["pointsHitRate"] = (pointsLookups > 0) ? (double)statistics.Counter(COUNTER_POINTS_HIT) / pointsLookups : 0.0;
+
+	return root;
+}
+
+// Send the statistics to any plugin that is listening, and optionally log them
+void NOAA_Plugin::PublishStatistics(bool log) {
+
+	wxJSONWriter writer(log ? wxJSONWRITER_STYLED : wxJSONWRITER_NONE);
+	wxString json;
+	writer.Write(GetStatistics(), json);
+
+	if (log) {
+		wxLogMessage("NOAA Weather Plugin, Statistics:\n%s", json);
+	}
+	SendPluginMessage(STATISTICS_MESSAGE, json);
+}
+
+// Requires WANTS_PLUGIN_MESSAGING
+// Other plugins (or a monitoring tool) can ask for the statistics on demand
+void NOAA_Plugin::SetPluginMessage(wxString& message_id, wxString& message_body) {
+
+	if (message_id == STATISTICS_REQUEST) {
+		PublishStatistics(true);
+	}
+}
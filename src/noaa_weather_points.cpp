@@ -0,0 +1,118 @@
+// Copyright(C) 2025 by Steven Adler
+//
+// This file is part of NOAA Weather plugin for OpenCPN.
+//
+// NOAA Weather plugin for OpenCPN is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// NOAA Weather plugin for OpenCPN is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with the NOAA Weather plugin for OpenCPN. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "noaa_weather_points.h"
+
+// Longitude normalization
+#include "noaa_weather_spatial.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+// First line of the serialized cache, the resolution follows it
+#define POINTS_HEADER "#NOAA points 1"
+
+NOAA_PointsCache::NOAA_PointsCache(double cellSize) {
+	resolution = cellSize;
+}
+
+// Pack the row and column of the position's cell into a single key
+uint64_t NOAA_PointsCache::Key(double latitude, double longitude) const {
+	int32_t row = (int32_t)floor(latitude / resolution);
+	int32_t column = (int32_t)floor(NOAA_SpatialIndex::NormalizeLongitude(longitude) / resolution);
+	return ((uint64_t)(uint32_t)row << 32) | (uint32_t)column;
+}
+
+bool NOAA_PointsCache::Find(double latitude, double longitude, long long now, long long maxAge, std::string *url) const {
+	auto it = entries.find(Key(latitude, longitude));
+	if ((it == entries.end()) || (now - it->second.fetched > maxAge)) {
+		return false;
+	}
+	*url = it->second.url;
+	return true;
+}
+
+void NOAA_PointsCache::Add(double latitude, double longitude, long long now, const std::string& url) {
+	PointsEntry& entry = entries[Key(latitude, longitude)];
+	entry.fetched = now;
+	entry.url = url;
+}
+
+void NOAA_PointsCache::Expire(long long now, long long maxAge) {
+	for (auto it = entries.begin(); it != entries.end();) {
+		if (now - it->second.fetched > maxAge) {
+			it = entries.erase(it);
+		}
+		else {
+			++it;
+		}
+	}
+}
+
+// Each line is: key fetched url
+std::string NOAA_PointsCache::Serialize(void) const {
+	char line[64];
+	snprintf(line, sizeof(line), "%s %d\n", POINTS_HEADER, (int)lround(1.0 / resolution));
+	std::string data = line;
+
+	for (const auto& it : entries) {
+		snprintf(line, sizeof(line), "%llu %lld ", (unsigned long long)it.first, it.second.fetched);
+		data.append(line);
+		data.append(it.second.url);
+		data.push_back('\n');
+	}
+	return data;
+}
+
+bool NOAA_PointsCache::Deserialize(const char *data, size_t length) {
+	entries.clear();
+
+	std::string text(data, length);
+	size_t position = text.find('\n');
+	if (position == std::string::npos) {
+		return false;
+	}
+
+	// Discard entries quantized at a different resolution
+	char header[64];
+	snprintf(header, sizeof(header), "%s %d", POINTS_HEADER, (int)lround(1.0 / resolution));
+	if (text.compare(0, position, header) != 0) {
+		return false;
+	}
+
+	while (++position < text.size()) {
+		size_t end = text.find('\n', position);
+		if (end == std::string::npos) {
+			end = text.size();
+		}
+		std::string line = text.substr(position, end - position);
+
+		unsigned long long key;
+		long long fetched;
+		int offset = 0;
+		if ((sscanf(line.c_str(), "%llu %lld %n", &key, &fetched, &offset) >= 2) &&
+			(offset > 0) && ((size_t)offset < line.size())) {
+			PointsEntry& entry = entries[(uint64_t)key];
+			entry.fetched = fetched;
+			entry.url = line.substr(offset);
+		}
+		position = end;
+	}
+	return true;
+}
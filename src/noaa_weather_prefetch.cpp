@@ -0,0 +1,154 @@
+// Copyright(C) 2025 by Steven Adler
+//
+// This file is part of NOAA Weather plugin for OpenCPN.
+//
+// NOAA Weather plugin for OpenCPN is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// NOAA Weather plugin for OpenCPN is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with the NOAA Weather plugin for OpenCPN. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "noaa_weather_prefetch.h"
+
+#include <algorithm>
+#include <set>
+
+NOAA_PrefetchQueue::NOAA_PrefetchQueue(int concurrency, int hostConcurrency, long long hostInterval,
+	long long maxAge, long long retryDelay) : hostConcurrency(hostConcurrency), hostInterval(hostInterval),
+	maxAge(maxAge), retryDelay(retryDelay) {
+	SetConcurrency(concurrency);
+}
+
+void NOAA_PrefetchQueue::SetConcurrency(int requests) {
+	concurrency = (requests > 0) ? requests : 1;
+}
+
+void NOAA_PrefetchQueue::SetWanted(std::vector<PrefetchRequest>& requests, size_t limit, long long now) {
+
+	// Forget the stations that would be fetched again anyway, so the maps stay the size of a few view ports
+	for (auto it = fetched.begin(); it != fetched.end(); ) {
+		it = (now - it->second >= maxAge) ? fetched.erase(it) : std::next(it);
+	}
+	for (auto it = failed.begin(); it != failed.end(); ) {
+		it = (now - it->second >= retryDelay) ? failed.erase(it) : std::next(it);
+	}
+
+	std::sort(requests.begin(), requests.end(), [](const PrefetchRequest& a, const PrefetchRequest& b) {
+		return a.distance < b.distance;
+	});
+
+	// A station may be visible on more than one canvas
+	std::set<std::string> keys;
+	waiting.clear();
+	for (const auto& it : requests) {
+		if (waiting.size() >= limit) {
+			break;
+		}
+		if ((inFlight.count(it.key) > 0) || (fetched.count(it.key) > 0) || (failed.count(it.key) > 0) ||
+			(!keys.insert(it.key).second)) {
+			continue;
+		}
+		waiting.push_back(it);
+	}
+}
+
+long long NOAA_PrefetchQueue::HostDelay(const std::string& host, long long now) const {
+	auto it = hosts.find(host);
+	if (it == hosts.end()) {
+		return 0;
+	}
+	if (it->second.active >= hostConcurrency) {
+		return -1;
+	}
+	long long elapsed = now - it->second.lastStart;
+	return (elapsed >= hostInterval) ? 0 : hostInterval - elapsed;
+}
+
+bool NOAA_PrefetchQueue::Next(long long now, PrefetchRequest *request) {
+	if ((int)inFlight.size() >= concurrency) {
+		return false;
+	}
+
+	// The nearest station whose host will take another request now
+	for (auto it = waiting.begin(); it != waiting.end(); ++it) {
+		std::string host = Host(it->url);
+		if (HostDelay(host, now) != 0) {
+			continue;
+		}
+
+		HostState& state = hosts[host];
+		state.active++;
+		state.lastStart = now;
+		inFlight[it->key] = host;
+
+		*request = std::move(*it);
+		waiting.erase(it);
+		return true;
+	}
+	return false;
+}
+
+long long NOAA_PrefetchQueue::Delay(long long now) const {
+	if ((int)inFlight.size() >= concurrency) {
+		return -1;
+	}
+
+	long long delay = -1;
+	for (const auto& it : waiting) {
+		long long hostDelay = HostDelay(Host(it.url), now);
+		if ((hostDelay >= 0) && ((delay < 0) || (hostDelay < delay))) {
+			delay = hostDelay;
+		}
+	}
+	return delay;
+}
+
+void NOAA_PrefetchQueue::Complete(const std::string& key, bool success, long long now) {
+	auto it = inFlight.find(key);
+	if (it != inFlight.end()) {
+		auto host = hosts.find(it->second);
+		if ((host != hosts.end()) && (host->second.active > 0)) {
+			host->second.active--;
+		}
+		inFlight.erase(it);
+	}
+	Record(key, success, now);
+}
+
+void NOAA_PrefetchQueue::Satisfied(const std::string& key, bool success, long long now) {
+	waiting.erase(std::remove_if(waiting.begin(), waiting.end(), [&key](const PrefetchRequest& request) {
+		return request.key == key;
+	}), waiting.end());
+	Record(key, success, now);
+}
+
+void NOAA_PrefetchQueue::Record(const std::string& key, bool success, long long now) {
+	if (success) {
+		fetched[key] = now;
+		failed.erase(key);
+	}
+	else {
+		failed[key] = now;
+		fetched.erase(key);
+	}
+}
+
+bool NOAA_PrefetchQueue::IsFresh(const std::string& key, long long now) const {
+	auto it = fetched.find(key);
+	return (it != fetched.end()) && (now - it->second < maxAge);
+}
+
+std::string NOAA_PrefetchQueue::Host(const std::string& url) {
+	size_t start = url.find("://");
+	start = (start == std::string::npos) ? 0 : start + 3;
+	size_t end = url.find_first_of("/?#", start);
+	return url.substr(0, end);
+}
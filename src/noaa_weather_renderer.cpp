@@ -0,0 +1,328 @@
+// Copyright(C) 2025 by Steven Adler
+//
+// This file is part of NOAA Weather plugin for OpenCPN.
+//
+// NOAA Weather plugin for OpenCPN is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// NOAA Weather plugin for OpenCPN is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with the NOAA Weather plugin for OpenCPN. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "noaa_weather_renderer.h"
+
+#ifdef NOAA_BATCHED_GL
+#ifdef __WXMSW__
+#include <windows.h>
+#endif
+#ifdef __WXOSX__
+#include <OpenGL/gl.h>
+#else
+#include <GL/gl.h>
+#endif
+#endif
+
+// Width of the texture atlas, symbols are packed left to right in shelves
+#define ATLAS_WIDTH 256
+
+#ifdef NOAA_BATCHED_GL
+
+// Symbols are separated by a transparent border so neighbours never bleed into each other
+#define ATLAS_PADDING 1
+
+NOAA_GLRenderer::NOAA_GLRenderer() {
+	shelfX = ATLAS_PADDING;
+	shelfY = ATLAS_PADDING;
+	shelfHeight = 0;
+	atlasWidth = ATLAS_WIDTH;
+	atlasHeight = 0;
+	composed = false;
+	currentTexture = NULL;
+}
+
+NOAA_GLRenderer::~NOAA_GLRenderer() {
+	// The textures belong to OpenCPN's GL contexts and are released with them,
+	// there is no guarantee a context is current when the plugin is unloaded
+}
+
+// Every context's copy of the atlas needs uploading again
+void NOAA_GLRenderer::MarkDirty(void) {
+	composed = false;
+	for (auto& it : textures) {
+		it.second.dirty = true;
+	}
+}
+
+int NOAA_GLRenderer::AddSymbol(const wxBitmap& bitmap) {
+	Symbol symbol;
+	symbol.bitmap = bitmap;
+	symbol.width = bitmap.GetWidth();
+	symbol.height = bitmap.GetHeight();
+
+	// Start a new shelf if the symbol doesn't fit on the current one
+	if (shelfX + symbol.width + ATLAS_PADDING > atlasWidth) {
+		shelfX = ATLAS_PADDING;
+		shelfY += shelfHeight + ATLAS_PADDING;
+		shelfHeight = 0;
+	}
+
+	symbol.x = shelfX;
+	symbol.y = shelfY;
+	shelfX += symbol.width + ATLAS_PADDING;
+	shelfHeight = wxMax(shelfHeight, symbol.height);
+
+	// Keep the atlas height a power of two for older drivers
+	int required = shelfY + shelfHeight + ATLAS_PADDING;
+	atlasHeight = 1;
+	while (atlasHeight < required) {
+		atlasHeight <<= 1;
+	}
+
+	symbols.push_back(symbol);
+	MarkDirty();
+	return (int)symbols.size() - 1;
+}
+
+void NOAA_GLRenderer::ReplaceSymbol(int symbol, const wxBitmap& bitmap) {
+	Symbol& s = symbols[symbol];
+	if ((bitmap.GetWidth() > s.width) || (bitmap.GetHeight() > s.height)) {
+		wxLogDebug("NOAA Weather Plugin, Symbol %d too large to replace", symbol);
+		return;
+	}
+
+	s.bitmap = bitmap;
+	s.width = bitmap.GetWidth();
+	s.height = bitmap.GetHeight();
+	MarkDirty();
+}
+
+void NOAA_GLRenderer::Compose(void) {
+	// Compose the atlas as RGBA from each symbol's colour and alpha channels
+	pixels.assign(atlasWidth * atlasHeight * 4, 0);
+
+	for (const auto& it : symbols) {
+		if (!it.bitmap.IsOk()) {
+			continue;
+		}
+		wxImage image = it.bitmap.ConvertToImage();
+		if ((image.GetWidth() != it.width) || (image.GetHeight() != it.height)) {
+			continue;
+		}
+		const unsigned char *rgb = image.GetData();
+		const unsigned char *alpha = image.HasAlpha() ? image.GetAlpha() : NULL;
+
+		for (int y = 0; y < it.height; y++) {
+			for (int x = 0; x < it.width; x++) {
+				int source = (y * it.width) + x;
+				int destination = (((it.y + y) * atlasWidth) + it.x + x) * 4;
+				pixels[destination] = rgb[source * 3];
+				pixels[destination + 1] = rgb[(source * 3) + 1];
+				pixels[destination + 2] = rgb[(source * 3) + 2];
+				if (alpha != NULL) {
+					pixels[destination + 3] = alpha[source];
+				}
+				else if ((image.HasMask()) && (rgb[source * 3] == image.GetMaskRed()) &&
+					(rgb[(source * 3) + 1] == image.GetMaskGreen()) && (rgb[(source * 3) + 2] == image.GetMaskBlue())) {
+					pixels[destination + 3] = 0;
+				}
+				else {
+					pixels[destination + 3] = 255;
+				}
+			}
+		}
+	}
+
+	composed = true;
+}
+
+void NOAA_GLRenderer::Upload(ContextTexture& contextTexture) {
+	if (!composed) {
+		Compose();
+	}
+
+	if (contextTexture.texture == 0) {
+		GLuint name;
+		glGenTextures(1, &name);
+		contextTexture.texture = name;
+	}
+
+	glBindTexture(GL_TEXTURE_2D, contextTexture.texture);
+	// Symbols are drawn at their native size, so there is no need to filter
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, atlasWidth, atlasHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+
+	contextTexture.dirty = false;
+}
+
+void NOAA_GLRenderer::Begin(wxGLContext *context) {
+	auto it = textures.find(context);
+	if (it == textures.end()) {
+		ContextTexture contextTexture;
+		contextTexture.texture = 0;
+		contextTexture.dirty = true;
+		it = textures.insert(std::make_pair(context, contextTexture)).first;
+	}
+	currentTexture = &it->second;
+	vertices.clear();
+}
+
+void NOAA_GLRenderer::Add(int symbol, int x, int y) {
+	const Symbol& s = symbols[symbol];
+
+	float left = (float)x;
+	float top = (float)y;
+	float right = (float)(x + s.width);
+	float bottom = (float)(y + s.height);
+
+	float u0 = (float)s.x / atlasWidth;
+	float v0 = (float)s.y / atlasHeight;
+	float u1 = (float)(s.x + s.width) / atlasWidth;
+	float v1 = (float)(s.y + s.height) / atlasHeight;
+
+	const float quad[] = {
+		left, top, u0, v0,
+		right, top, u1, v0,
+		right, bottom, u1, v1,
+		left, top, u0, v0,
+		right, bottom, u1, v1,
+		left, bottom, u0, v1
+	};
+	vertices.insert(vertices.end(), quad, quad + 24);
+}
+
+void NOAA_GLRenderer::Flush(void) {
+	if (vertices.empty()) {
+		return;
+	}
+
+	if (currentTexture->dirty) {
+		Upload(*currentTexture);
+	}
+
+	glEnable(GL_TEXTURE_2D);
+	glBindTexture(GL_TEXTURE_2D, currentTexture->texture);
+	glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_REPLACE);
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+	glEnableClientState(GL_VERTEX_ARRAY);
+	glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+	glVertexPointer(2, GL_FLOAT, 4 * sizeof(float), vertices.data());
+	glTexCoordPointer(2, GL_FLOAT, 4 * sizeof(float), vertices.data() + 2);
+
+	glDrawArrays(GL_TRIANGLES, 0, (GLsizei)(vertices.size() / 4));
+
+	glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+	glDisableClientState(GL_VERTEX_ARRAY);
+	glDisable(GL_BLEND);
+	glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
+	glDisable(GL_TEXTURE_2D);
+}
+
+void NOAA_GLRenderer::DrawGeometry(const std::vector<float>& lines, const std::vector<float>& triangles, const wxColour& colour, float lineWidth) {
+	if ((lines.empty()) && (triangles.empty())) {
+		return;
+	}
+
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	glEnable(GL_LINE_SMOOTH);
+	glHint(GL_LINE_SMOOTH_HINT, GL_NICEST);
+	glColor4ub(colour.Red(), colour.Green(), colour.Blue(), colour.Alpha());
+	glLineWidth(lineWidth);
+
+	glEnableClientState(GL_VERTEX_ARRAY);
+	if (!lines.empty()) {
+		glVertexPointer(2, GL_FLOAT, 0, lines.data());
+		glDrawArrays(GL_LINES, 0, (GLsizei)(lines.size() / 2));
+	}
+	if (!triangles.empty()) {
+		glVertexPointer(2, GL_FLOAT, 0, triangles.data());
+		glDrawArrays(GL_TRIANGLES, 0, (GLsizei)(triangles.size() / 2));
+	}
+	glDisableClientState(GL_VERTEX_ARRAY);
+
+	glLineWidth(1.0f);
+	glDisable(GL_LINE_SMOOTH);
+	glDisable(GL_BLEND);
+}
+
+#else
+
+NOAA_GLRenderer::NOAA_GLRenderer() {
+	graphics = NULL;
+}
+
+NOAA_GLRenderer::~NOAA_GLRenderer() {
+	delete graphics;
+}
+
+int NOAA_GLRenderer::AddSymbol(const wxBitmap& bitmap) {
+	Symbol symbol;
+	symbol.bitmap = bitmap;
+	symbol.x = 0;
+	symbol.y = 0;
+	symbol.width = bitmap.GetWidth();
+	symbol.height = bitmap.GetHeight();
+	symbols.push_back(symbol);
+	return (int)symbols.size() - 1;
+}
+
+void NOAA_GLRenderer::ReplaceSymbol(int symbol, const wxBitmap& bitmap) {
+	symbols[symbol].bitmap = bitmap;
+	symbols[symbol].width = bitmap.GetWidth();
+	symbols[symbol].height = bitmap.GetHeight();
+}
+
+void NOAA_GLRenderer::Begin(wxGLContext *context) {
+	// Reuse the same piDC rather than creating one every frame
+	if (graphics == NULL) {
+		graphics = new NOAA_Graphics();
+	}
+	queue.clear();
+}
+
+void NOAA_GLRenderer::Add(int symbol, int x, int y) {
+	Queued queued;
+	queued.symbol = symbol;
+	queued.x = x;
+	queued.y = y;
+	queue.push_back(queued);
+}
+
+void NOAA_GLRenderer::Flush(void) {
+	for (const auto& it : queue) {
+		graphics->DrawBitmap(symbols[it.symbol].bitmap, it.x, it.y, true);
+	}
+	queue.clear();
+}
+
+void NOAA_GLRenderer::DrawGeometry(const std::vector<float>& lines, const std::vector<float>& triangles, const wxColour& colour, float lineWidth) {
+	if (graphics == NULL) {
+		return;
+	}
+
+	graphics->SetPen(wxPen(colour, (int)(lineWidth + 0.5f)));
+	graphics->SetBrush(wxBrush(colour));
+	for (size_t i = 0; i + 3 < lines.size(); i += 4) {
+		graphics->DrawLine((wxCoord)lines[i], (wxCoord)lines[i + 1], (wxCoord)lines[i + 2], (wxCoord)lines[i + 3]);
+	}
+	for (size_t i = 0; i + 5 < triangles.size(); i += 6) {
+		wxPoint corners[3] = { wxPoint((int)triangles[i], (int)triangles[i + 1]),
+			wxPoint((int)triangles[i + 2], (int)triangles[i + 3]), wxPoint((int)triangles[i + 4], (int)triangles[i + 5]) };
+		graphics->DrawPolygon(3, corners);
+	}
+}
+
+#endif
@@ -0,0 +1,294 @@
+// Copyright(C) 2025 by Steven Adler
+//
+// This file is part of NOAA Weather plugin for OpenCPN.
+//
+// NOAA Weather plugin for OpenCPN is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// NOAA Weather plugin for OpenCPN is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with the NOAA Weather plugin for OpenCPN. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "noaa_weather_route.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#define ROUTE_PI 3.14159265358979323846
+
+NOAA_RouteForecast::NOAA_RouteForecast() {
+}
+
+std::vector<std::string> NOAA_RouteForecast::GetLayerNames(void) {
+	return { "temperature", "windSpeed", "windGust", "windDirection" };
+}
+
+double NOAA_RouteForecast::Distance(double latitude0, double longitude0, double latitude1, double longitude1) {
+	double phi0 = latitude0 * ROUTE_PI / 180.0;
+	double phi1 = latitude1 * ROUTE_PI / 180.0;
+	double deltaPhi = phi1 - phi0;
+	double deltaLambda = (longitude1 - longitude0) * ROUTE_PI / 180.0;
+	if (deltaLambda > ROUTE_PI) {
+		deltaLambda -= 2.0 * ROUTE_PI;
+	}
+	else if (deltaLambda < -ROUTE_PI) {
+		deltaLambda += 2.0 * ROUTE_PI;
+	}
+
+	// Ratio of the latitude difference to the stretched (Mercator) latitude difference,
+	// which on an east-west course is simply the cosine of the latitude
+	double deltaPsi = std::log(std::tan((ROUTE_PI / 4.0) + (phi1 / 2.0)) / std::tan((ROUTE_PI / 4.0) + (phi0 / 2.0)));
+	double q = (std::fabs(deltaPsi) > 1e-12) ? deltaPhi / deltaPsi : std::cos(phi0);
+
+	// Radians to nautical miles, one minute of arc
+	return std::sqrt((deltaPhi * deltaPhi) + (q * q * deltaLambda * deltaLambda)) * (180.0 * 60.0 / ROUTE_PI);
+}
+
+void NOAA_RouteForecast::Plan(const std::vector<RouteWaypoint>& waypoints, double speed, long long departure, double sampleDistance) {
+	names.clear();
+	waypointSamples.clear();
+	latitudes.clear();
+	longitudes.clear();
+	distances.clear();
+	times.clear();
+	sampleCells.clear();
+	cellKeys.clear();
+
+	if ((waypoints.empty()) || (speed <= 0)) {
+		return;
+	}
+
+	std::vector<double> legs;
+	double total = 0;
+	for (size_t i = 1; i < waypoints.size(); i++) {
+		legs.push_back(Distance(waypoints[i - 1].latitude, waypoints[i - 1].longitude, waypoints[i].latitude, waypoints[i].longitude));
+		total += legs.back();
+	}
+	sampleDistance = std::max(sampleDistance, total / ROUTE_MAX_SAMPLES);
+
+	double distance = 0;
+	for (size_t i = 0; i < waypoints.size(); i++) {
+		names.push_back(waypoints[i].name);
+		waypointSamples.push_back(times.size());
+
+		latitudes.push_back(waypoints[i].latitude);
+		longitudes.push_back(waypoints[i].longitude);
+		distances.push_back(distance);
+		times.push_back(departure + (long long)((distance / speed) * 3600.0));
+
+		if (i + 1 == waypoints.size()) {
+			break;
+		}
+
+		// Positions along the leg are interpolated in latitude and longitude, close enough to the
+		// rhumb line over the length of a leg
+		double deltaLongitude = waypoints[i + 1].longitude - waypoints[i].longitude;
+		if (deltaLongitude > 180.0) {
+			deltaLongitude -= 360.0;
+		}
+		else if (deltaLongitude < -180.0) {
+			deltaLongitude += 360.0;
+		}
+
+		int steps = (int)std::ceil(legs[i] / sampleDistance);
+		for (int step = 1; step < steps; step++) {
+			double fraction = (double)step / steps;
+			double longitude = waypoints[i].longitude + (fraction * deltaLongitude);
+			if (longitude > 180.0) {
+				longitude -= 360.0;
+			}
+			else if (longitude < -180.0) {
+				longitude += 360.0;
+			}
+			latitudes.push_back(waypoints[i].latitude + (fraction * (waypoints[i + 1].latitude - waypoints[i].latitude)));
+			longitudes.push_back(longitude);
+			distances.push_back(distance + (fraction * legs[i]));
+			times.push_back(departure + (long long)(((distance + (fraction * legs[i])) / speed) * 3600.0));
+		}
+		distance += legs[i];
+	}
+	sampleCells.assign(times.size(), -1);
+}
+
+void NOAA_RouteForecast::SetCell(size_t sample, const std::string& key) {
+	auto it = std::find(cellKeys.begin(), cellKeys.end(), key);
+	if (it == cellKeys.end()) {
+		it = cellKeys.insert(cellKeys.end(), key);
+	}
+	sampleCells[sample] = (int)(it - cellKeys.begin());
+}
+
+bool NOAA_RouteForecast::HasForecast(const std::string& key, long long now, long long maxAge) const {
+	auto it = cells.find(key);
+	return (it != cells.end()) && (now - it->second.fetched <= maxAge);
+}
+
+void NOAA_RouteForecast::SetForecast(const std::string& key, const NOAA_Forecast& forecast, long long now) {
+
+	// Make room by discarding the cells the current plan doesn't use
+	if ((cells.size() >= ROUTE_CELLS) && (cells.find(key) == cells.end())) {
+		for (auto it = cells.begin(); it != cells.end(); ) {
+			it = (std::find(cellKeys.begin(), cellKeys.end(), it->first) == cellKeys.end()) ? cells.erase(it) : std::next(it);
+		}
+	}
+
+	RouteCell& cell = cells[key];
+	cell.origin = forecast.Time(0);
+	cell.hours = forecast.Hours();
+	cell.fetched = now;
+
+	const float missing = std::numeric_limits<float>::quiet_NaN();
+	for (int i = 0; i < ROUTE_LAYERS; i++) {
+		cell.values[i].assign(cell.hours + 3, missing);
+	}
+
+	int temperature = forecast.FindLayer("temperature");
+	int windSpeed = forecast.FindLayer("windSpeed");
+	int windGust = forecast.FindLayer("windGust");
+	int windDirection = forecast.FindLayer("windDirection");
+
+	// Wind speeds in knots, unless NWS has changed the units
+	double windScale = ((windSpeed >= 0) && (forecast.LayerUnit(windSpeed) == "wmoUnit:m_s-1")) ? 3600.0 / 1852.0 : ROUTE_KNOTS_PER_KMH;
+
+	for (size_t hour = 0; hour < cell.hours; hour++) {
+		if (temperature >= 0) {
+			cell.values[ROUTE_TEMPERATURE][hour] = (float)forecast.Value(temperature, hour);
+		}
+		if (windSpeed >= 0) {
+			cell.values[ROUTE_WIND_SPEED][hour] = (float)(forecast.Value(windSpeed, hour) * windScale);
+		}
+		if (windGust >= 0) {
+			cell.values[ROUTE_WIND_GUST][hour] = (float)(forecast.Value(windGust, hour) * windScale);
+		}
+		if (windDirection >= 0) {
+			double direction = forecast.Value(windDirection, hour) * ROUTE_PI / 180.0;
+			cell.values[ROUTE_WIND_X][hour] = (float)std::sin(direction);
+			cell.values[ROUTE_WIND_Y][hour] = (float)std::cos(direction);
+		}
+	}
+
+	// The last hour is repeated, so the interpolation at the last hour may read the hour after it
+	if (cell.hours > 0) {
+		for (int i = 0; i < ROUTE_LAYERS; i++) {
+			cell.values[i][cell.hours] = cell.values[i][cell.hours - 1];
+		}
+	}
+}
+
+// Linear interpolation of the hourly values at each sample's hour and fraction of the hour.
+// There are no branches or bounds checks, samples outside the forecast index the trailing NaN,
+// so the compiler can vectorize the loop
+static void InterpolateHours(const float *hourly, const int32_t *hour, const float *fraction, size_t count, float *result) {
+	for (size_t i = 0; i < count; i++) {
+		float before = hourly[hour[i]];
+		float after = hourly[hour[i] + 1];
+		result[i] = before + (fraction[i] * (after - before));
+	}
+}
+
+void NOAA_RouteForecast::Compute(std::vector<RouteForecastRow> *rows) {
+	rows->clear();
+	size_t samples = times.size();
+	const float missing = std::numeric_limits<float>::quiet_NaN();
+	for (int i = 0; i < ROUTE_LAYERS; i++) {
+		sampleValues[i].assign(samples, missing);
+	}
+
+	// In time, a cell at a time over the samples it covers
+	for (size_t cellIndex = 0; cellIndex < cellKeys.size(); cellIndex++) {
+		auto cell = cells.find(cellKeys[cellIndex]);
+		if ((cell == cells.end()) || (cell->second.hours == 0)) {
+			continue;
+		}
+
+		cellSamples.clear();
+		for (size_t i = 0; i < samples; i++) {
+			if (sampleCells[i] == (int)cellIndex) {
+				cellSamples.push_back((uint32_t)i);
+			}
+		}
+
+		const RouteCell& data = cell->second;
+		hourIndex.resize(cellSamples.size());
+		hourFraction.resize(cellSamples.size());
+		for (size_t i = 0; i < cellSamples.size(); i++) {
+			double hours = (double)(times[cellSamples[i]] - data.origin) / FORECAST_STEP;
+			if ((hours < 0) || (hours > (double)(data.hours - 1))) {
+				hourIndex[i] = (int32_t)data.hours + 1;
+				hourFraction[i] = 0;
+			}
+			else {
+				hourIndex[i] = (int32_t)hours;
+				hourFraction[i] = (float)(hours - hourIndex[i]);
+			}
+		}
+
+		interpolated.resize(cellSamples.size());
+		for (int layer = 0; layer < ROUTE_LAYERS; layer++) {
+			InterpolateHours(data.values[layer].data(), hourIndex.data(), hourFraction.data(), cellSamples.size(), interpolated.data());
+			for (size_t i = 0; i < cellSamples.size(); i++) {
+				sampleValues[layer][cellSamples[i]] = interpolated[i];
+			}
+		}
+	}
+
+	// In space, the samples without a value take it from the nearest samples either side along the route
+	for (int layer = 0; layer < ROUTE_LAYERS; layer++) {
+		std::vector<float>& values = sampleValues[layer];
+		int previous = -1;
+		for (size_t i = 0; i < samples; i++) {
+			if (std::isnan(values[i])) {
+				continue;
+			}
+			if ((previous >= 0) && (i - previous > 1)) {
+				double span = distances[i] - distances[previous];
+				for (size_t j = previous + 1; j < i; j++) {
+					double fraction = (span > 0) ? (distances[j] - distances[previous]) / span : 0.0;
+					values[j] = values[previous] + (float)(fraction * (values[i] - values[previous]));
+				}
+			}
+			previous = (int)i;
+		}
+	}
+
+	for (size_t i = 0; i < waypointSamples.size(); i++) {
+		size_t sample = waypointSamples[i];
+		RouteForecastRow row;
+		row.name = names[i];
+		row.distance = distances[sample];
+		row.eta = times[sample];
+		row.temperature = sampleValues[ROUTE_TEMPERATURE][sample];
+		row.windSpeed = sampleValues[ROUTE_WIND_SPEED][sample];
+		row.windGust = sampleValues[ROUTE_WIND_GUST][sample];
+
+		float x = sampleValues[ROUTE_WIND_X][sample];
+		float y = sampleValues[ROUTE_WIND_Y][sample];
+		if ((std::isnan(x)) || (std::isnan(y)) || ((x == 0) && (y == 0))) {
+			row.windDirection = std::numeric_limits<double>::quiet_NaN();
+		}
+		else {
+			row.windDirection = std::atan2(x, y) * 180.0 / ROUTE_PI;
+			if (row.windDirection < 0) {
+				row.windDirection += 360.0;
+			}
+		}
+
+		row.legWindSpeed = std::numeric_limits<double>::quiet_NaN();
+		size_t end = (i + 1 < waypointSamples.size()) ? waypointSamples[i + 1] : sample;
+		for (size_t j = sample; j <= end; j++) {
+			float speed = sampleValues[ROUTE_WIND_SPEED][j];
+			if ((!std::isnan(speed)) && ((std::isnan(row.legWindSpeed)) || (speed > row.legWindSpeed))) {
+				row.legWindSpeed = speed;
+			}
+		}
+		rows->push_back(row);
+	}
+}
@@ -0,0 +1,104 @@
+// Copyright(C) 2025 by Steven Adler
+//
+// This file is part of NOAA Weather plugin for OpenCPN.
+//
+// NOAA Weather plugin for OpenCPN is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// NOAA Weather plugin for OpenCPN is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with the NOAA Weather plugin for OpenCPN. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "noaa_weather_scheduler.h"
+
+#include <algorithm>
+#include <climits>
+
+NOAA_RefreshScheduler::NOAA_RefreshScheduler() {
+	interval = 0;
+	offset = 0;
+	due = 0;
+}
+
+void NOAA_RefreshScheduler::Schedule(long long refreshInterval, long long refreshOffset, std::function<void()> refreshCallback) {
+	Cancel();
+	interval = refreshInterval;
+	offset = refreshOffset;
+	callback = refreshCallback;
+	if (interval > 0) {
+		ScheduleNext();
+	}
+}
+
+void NOAA_RefreshScheduler::Cancel(void) {
+	Stop();
+	interval = 0;
+	callback = nullptr;
+}
+
+long long NOAA_RefreshScheduler::NextRefresh(long long now, long long interval, long long offset) {
+	// Offsets larger than the interval, or negative, are reduced to the equivalent offset
+	offset %= interval;
+	if (offset < 0) {
+		offset += interval;
+	}
+
+	long long elapsed = (now - offset) % interval;
+	if (elapsed < 0) {
+		elapsed += interval;
+	}
+	return now - elapsed + interval;
+}
+
+void NOAA_RefreshScheduler::Notify() {
+	// Only an intermediate step of a long wait
+	long long now = (long long)wxDateTime::Now().GetTicks();
+	if (now < due) {
+		StartTimer(now);
+		return;
+	}
+
+	// Schedule the next refresh first, the callback may take a while
+	ScheduleNext();
+	if (callback) {
+		callback();
+	}
+}
+
+// One shot timers are used so that a late (eg. after the computer has been asleep) refresh doesn't
+// shift all of the subsequent refreshes
+void NOAA_RefreshScheduler::ScheduleNext(void) {
+	long long now = (long long)wxDateTime::Now().GetTicks();
+	due = NextRefresh(now, interval, offset);
+	StartTimer(now);
+}
+
+void NOAA_RefreshScheduler::StartTimer(long long now) {
+	long long delay = std::min(std::max(due - now, 1LL), (long long)SCHEDULER_MAX_DELAY);
+	Start((int)(delay * 1000), wxTIMER_ONE_SHOT);
+}
+
+void NOAA_DelayedCall::Defer(long long milliseconds, std::function<void()> delayedCallback) {
+	callback = delayedCallback;
+	Start((int)std::min(std::max(milliseconds, 1LL), (long long)INT_MAX), wxTIMER_ONE_SHOT);
+}
+
+void NOAA_DelayedCall::Cancel(void) {
+	Stop();
+	callback = nullptr;
+}
+
+void NOAA_DelayedCall::Notify() {
+	// The callback may defer itself again
+	std::function<void()> delayedCallback = callback;
+	if (delayedCallback) {
+		delayedCallback();
+	}
+}
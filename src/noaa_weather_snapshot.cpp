@@ -0,0 +1,264 @@
+// Copyright(C) 2025 by Steven Adler
+//
+// This file is part of NOAA Weather plugin for OpenCPN.
+//
+// NOAA Weather plugin for OpenCPN is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// NOAA Weather plugin for OpenCPN is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with the NOAA Weather plugin for OpenCPN. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "noaa_weather_snapshot.h"
+
+#include <cstdio>
+#include <cstring>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Snapshot layout, all values in the host's byte order
+//
+// Header
+// The station columns, as written by NOAA_StationColumns::Write
+//
+// A snapshot written on a host with a different byte order fails the byteOrder check and is ignored
+
+#define SNAPSHOT_MAGIC "NOAASNAP"
+#define SNAPSHOT_BYTE_ORDER 0x01020304
+
+typedef struct _snapshotheader {
+	char magic[8];
+	uint32_t byteOrder;
+	uint32_t version;
+	uint32_t content;
+	uint32_t count;
+	uint64_t sourceHash;
+	int64_t created;
+	uint64_t columnBytes;
+} SnapshotHeader;
+
+// Open files using UTF-8 names on every platform
+static FILE *OpenFile(const std::string& fileName, const char *mode) {
+#ifdef _WIN32
+	wchar_t wideName[MAX_PATH];
+	wchar_t wideMode[8];
+	if ((MultiByteToWideChar(CP_UTF8, 0, fileName.c_str(), -1, wideName, MAX_PATH) == 0) ||
+		(MultiByteToWideChar(CP_UTF8, 0, mode, -1, wideMode, 8) == 0)) {
+		return NULL;
+	}
+	return _wfopen(wideName, wideMode);
+#else
+	return fopen(fileName.c_str(), mode);
+#endif
+}
+
+static bool ReplaceFile(const std::string& from, const std::string& to) {
+#ifdef _WIN32
+	wchar_t wideFrom[MAX_PATH];
+	wchar_t wideTo[MAX_PATH];
+	if ((MultiByteToWideChar(CP_UTF8, 0, from.c_str(), -1, wideFrom, MAX_PATH) == 0) ||
+		(MultiByteToWideChar(CP_UTF8, 0, to.c_str(), -1, wideTo, MAX_PATH) == 0)) {
+		return false;
+	}
+	return MoveFileExW(wideFrom, wideTo, MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+	return rename(from.c_str(), to.c_str()) == 0;
+#endif
+}
+
+NOAA_MappedFile::NOAA_MappedFile() {
+	data = NULL;
+	size = 0;
+#ifdef _WIN32
+	file = INVALID_HANDLE_VALUE;
+	mapping = NULL;
+#else
+	file = -1;
+#endif
+}
+
+NOAA_MappedFile::~NOAA_MappedFile() {
+	Close();
+}
+
+bool NOAA_MappedFile::Open(const std::string& fileName) {
+	Close();
+
+#ifdef _WIN32
+	wchar_t wideName[MAX_PATH];
+	if (MultiByteToWideChar(CP_UTF8, 0, fileName.c_str(), -1, wideName, MAX_PATH) == 0) {
+		return false;
+	}
+
+	file = CreateFileW(wideName, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE) {
+		return false;
+	}
+
+	LARGE_INTEGER fileSize;
+	if ((!GetFileSizeEx(file, &fileSize)) || (fileSize.QuadPart == 0)) {
+		Close();
+		return false;
+	}
+
+	mapping = CreateFileMappingW(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (mapping == NULL) {
+		Close();
+		return false;
+	}
+
+	data = (const char *)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if (data == NULL) {
+		Close();
+		return false;
+	}
+	size = (size_t)fileSize.QuadPart;
+#else
+	file = open(fileName.c_str(), O_RDONLY);
+	if (file < 0) {
+		return false;
+	}
+
+	struct stat status;
+	if ((fstat(file, &status) != 0) || (status.st_size == 0)) {
+		Close();
+		return false;
+	}
+
+	void *address = mmap(NULL, (size_t)status.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+	if (address == MAP_FAILED) {
+		Close();
+		return false;
+	}
+	data = (const char *)address;
+	size = (size_t)status.st_size;
+#endif
+	return true;
+}
+
+void NOAA_MappedFile::Close(void) {
+#ifdef _WIN32
+	if (data != NULL) {
+		UnmapViewOfFile(data);
+	}
+	if (mapping != NULL) {
+		CloseHandle(mapping);
+	}
+	if (file != INVALID_HANDLE_VALUE) {
+		CloseHandle(file);
+	}
+	file = INVALID_HANDLE_VALUE;
+	mapping = NULL;
+#else
+	if (data != NULL) {
+		munmap((void *)data, size);
+	}
+	if (file >= 0) {
+		close(file);
+	}
+	file = -1;
+#endif
+	data = NULL;
+	size = 0;
+}
+
+uint64_t HashData(const char *data, size_t length) {
+	uint64_t hash = 14695981039346656037ULL;
+	for (size_t i = 0; i < length; i++) {
+		hash ^= (unsigned char)data[i];
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
+static bool RemoveFile(const std::string& fileName) {
+#ifdef _WIN32
+	wchar_t wideName[MAX_PATH];
+	if (MultiByteToWideChar(CP_UTF8, 0, fileName.c_str(), -1, wideName, MAX_PATH) == 0) {
+		return false;
+	}
+	return DeleteFileW(wideName) != 0;
+#else
+	return remove(fileName.c_str()) == 0;
+#endif
+}
+
+bool SaveSnapshot(const std::string& fileName, const SnapshotInfo& info, const NOAA_StationColumns& buoys) {
+	SnapshotHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+	header.byteOrder = SNAPSHOT_BYTE_ORDER;
+	header.version = SNAPSHOT_VERSION;
+	header.content = info.content;
+	header.count = (uint32_t)buoys.Size();
+	header.sourceHash = info.sourceHash;
+	header.created = info.created;
+
+	std::string columns;
+	buoys.Write(&columns);
+	header.columnBytes = columns.size();
+
+	std::string temporaryName = fileName + ".tmp";
+	FILE *file = OpenFile(temporaryName, "wb");
+	if (file == NULL) {
+		return false;
+	}
+
+	bool success = (fwrite(&header, sizeof(header), 1, file) == 1);
+	if ((success) && (!columns.empty())) {
+		success = (fwrite(columns.data(), 1, columns.size(), file) == columns.size());
+	}
+	success = (fclose(file) == 0) && (success);
+
+	if ((!success) || (!ReplaceFile(temporaryName, fileName))) {
+		RemoveFile(temporaryName);
+		return false;
+	}
+	return true;
+}
+
+// The columns are copied straight out of the mapping, a block per column rather than an insert per station
+bool LoadSnapshot(const std::string& fileName, SnapshotInfo *info, NOAA_StationColumns *buoys) {
+	NOAA_MappedFile mappedFile;
+	if (!mappedFile.Open(fileName)) {
+		return false;
+	}
+
+	const char *data = mappedFile.Data();
+	size_t size = mappedFile.Size();
+
+	SnapshotHeader header;
+	if (size < sizeof(header)) {
+		return false;
+	}
+	memcpy(&header, data, sizeof(header));
+
+	if ((memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic)) != 0) ||
+		(header.byteOrder != SNAPSHOT_BYTE_ORDER) || (header.version != SNAPSHOT_VERSION) ||
+		(sizeof(header) + header.columnBytes != size)) {
+		return false;
+	}
+
+	if (!buoys->Read(data + sizeof(header), (size_t)header.columnBytes, header.count)) {
+		return false;
+	}
+
+	info->content = header.content;
+	info->sourceHash = header.sourceHash;
+	info->created = header.created;
+	return true;
+}
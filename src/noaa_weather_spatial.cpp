@@ -0,0 +1,152 @@
+// Copyright(C) 2025 by Steven Adler
+//
+// This file is part of NOAA Weather plugin for OpenCPN.
+//
+// NOAA Weather plugin for OpenCPN is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// NOAA Weather plugin for OpenCPN is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with the NOAA Weather plugin for OpenCPN. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "noaa_weather_spatial.h"
+
+#include <cmath>
+#include <climits>
+
+NOAA_SpatialIndex::NOAA_SpatialIndex(double cellSize) : cellSize(cellSize) {
+	rows = (int)std::ceil(180.0 / cellSize);
+	columns = (int)std::ceil(360.0 / cellSize);
+	Clear();
+}
+
+void NOAA_SpatialIndex::Clear(void) {
+	cellStart.assign((rows * columns) + 1, 0);
+	stations.clear();
+	latitudes.clear();
+	longitudes.clear();
+}
+
+double NOAA_SpatialIndex::NormalizeLongitude(double longitude) {
+	longitude = std::fmod(longitude + 180.0, 360.0);
+	if (longitude < 0) {
+		longitude += 360.0;
+	}
+	return longitude - 180.0;
+}
+
+int NOAA_SpatialIndex::Row(double latitude) const {
+	int row = (int)std::floor((latitude + 90.0) / cellSize);
+	return (row < 0) ? 0 : (row >= rows) ? rows - 1 : row;
+}
+
+int NOAA_SpatialIndex::Column(double longitude) const {
+	int column = (int)std::floor((longitude + 180.0) / cellSize);
+	return (column < 0) ? 0 : (column >= columns) ? columns - 1 : column;
+}
+
+// Counting sort of the stations into their cells
+void NOAA_SpatialIndex::Build(const float *buoyLatitudes, const float *buoyLongitudes, size_t count) {
+	Clear();
+
+	std::vector<unsigned int> cells;
+	cells.reserve(count);
+
+	for (size_t i = 0; i < count; i++) {
+		if ((!IsReported(buoyLatitudes[i])) || (!IsReported(buoyLongitudes[i]))) {
+			cells.push_back(UINT_MAX);
+			continue;
+		}
+		unsigned int cell = (Row(buoyLatitudes[i]) * columns) + Column(NormalizeLongitude(buoyLongitudes[i]));
+		cells.push_back(cell);
+		cellStart[cell + 1]++;
+	}
+
+	for (size_t i = 1; i < cellStart.size(); i++) {
+		cellStart[i] += cellStart[i - 1];
+	}
+
+	size_t total = cellStart.back();
+	stations.resize(total);
+	latitudes.resize(total);
+	longitudes.resize(total);
+
+	std::vector<unsigned int> next(cellStart.begin(), cellStart.end() - 1);
+	for (size_t i = 0; i < count; i++) {
+		if (cells[i] == UINT_MAX) {
+			continue;
+		}
+		unsigned int slot = next[cells[i]]++;
+		stations[slot] = (unsigned int)i;
+		latitudes[slot] = buoyLatitudes[i];
+		longitudes[slot] = (float)NormalizeLongitude(buoyLongitudes[i]);
+	}
+}
+
+void NOAA_SpatialIndex::Query(double latMin, double latMax, double lonMin, double lonMax, std::vector<unsigned int> *results) const {
+	results->clear();
+
+	if ((stations.empty()) || (latMin > latMax)) {
+		return;
+	}
+
+	double width = lonMax - lonMin;
+	if (width < 0) {
+		// Already expressed as crossing the antimeridian, eg. 170 to -170
+		width += 360.0;
+	}
+
+	if (width >= 360.0) {
+		QueryRange(latMin, latMax, -180.0, 180.0, results);
+		return;
+	}
+
+	double west = NormalizeLongitude(lonMin);
+	double east = west + width;
+
+	if (east <= 180.0) {
+		QueryRange(latMin, latMax, west, east, results);
+	}
+	else {
+		// Crosses the antimeridian, eg. 170 to 190
+		QueryRange(latMin, latMax, west, 180.0, results);
+		QueryRange(latMin, latMax, -180.0, east - 360.0, results);
+	}
+}
+
+void NOAA_SpatialIndex::QueryRange(double latMin, double latMax, double lonMin, double lonMax, std::vector<unsigned int> *results) const {
+	int firstRow = Row(latMin);
+	int lastRow = Row(latMax);
+	int firstColumn = Column(lonMin);
+	int lastColumn = Column(lonMax);
+
+	for (int row = firstRow; row <= lastRow; row++) {
+		for (int column = firstColumn; column <= lastColumn; column++) {
+			unsigned int cell = (row * columns) + column;
+			unsigned int first = cellStart[cell];
+			unsigned int last = cellStart[cell + 1];
+
+			// Cells on the edge of the box are only partially covered and need each station checked
+			bool edge = (row == firstRow) || (row == lastRow) || (column == firstColumn) || (column == lastColumn);
+
+			if (edge) {
+				for (unsigned int i = first; i < last; i++) {
+					if ((latitudes[i] >= latMin) && (latitudes[i] <= latMax) &&
+						(longitudes[i] >= lonMin) && (longitudes[i] <= lonMax)) {
+						results->push_back(stations[i]);
+					}
+				}
+			}
+			else {
+				results->insert(results->end(), stations.begin() + first, stations.begin() + last);
+			}
+		}
+	}
+}
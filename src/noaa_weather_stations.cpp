@@ -0,0 +1,120 @@
+// Copyright(C) 2025 by Steven Adler
+//
+// This file is part of NOAA Weather plugin for OpenCPN.
+//
+// NOAA Weather plugin for OpenCPN is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// NOAA Weather plugin for OpenCPN is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with the NOAA Weather plugin for OpenCPN. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "noaa_weather_stations.h"
+
+#include <ctime>
+#include <utility>
+
+NOAA_StationStore::NOAA_StationStore() : busy(false) {
+	statistics = NULL;
+	NOAA_StationColumns empty;
+	current = Build(SNAPSHOT_STATION_LIST, 0, empty);
+}
+
+NOAA_StationStore::~NOAA_StationStore() {
+	Wait();
+}
+
+NOAA_StationDataPtr NOAA_StationStore::Build(uint32_t content, uint64_t sourceHash, NOAA_StationColumns& buoys) {
+	std::shared_ptr<NOAA_StationData> data = std::make_shared<NOAA_StationData>();
+	data->content = content;
+	data->sourceHash = sourceHash;
+	buoys.Compact();
+	data->buoys = std::move(buoys);
+	buoys.Clear();
+	data->index.Build(data->buoys.Latitudes(), data->buoys.Longitudes(), data->buoys.Size());
+	data->clusters.Build(data->buoys);
+	return data;
+}
+
+bool NOAA_StationStore::Refresh(std::vector<char>& data, uint32_t content, const std::string& snapshotFile, NOAA_PublishCallback published) {
+	bool expected = false;
+	if (!busy.compare_exchange_strong(expected, true)) {
+		return false;
+	}
+
+	// The previous worker has finished (busy was clear), but must still be joined
+	if (worker.joinable()) {
+		worker.join();
+	}
+
+	// No init-capture in C++11, so the buffer is handed over in a shared_ptr
+	std::shared_ptr<std::vector<char>> buffer = std::make_shared<std::vector<char>>();
+	buffer->swap(data);
+
+	worker = std::thread(&NOAA_StationStore::Run, this, buffer, content, snapshotFile, published);
+	return true;
+}
+
+void NOAA_StationStore::Wait(void) {
+	if (worker.joinable()) {
+		worker.join();
+	}
+}
+
+void NOAA_StationStore::Run(std::shared_ptr<std::vector<char>> data, uint32_t content, std::string snapshotFile, NOAA_PublishCallback published) {
+	// The station list rarely changes and NDBC only regenerates the scheduled reports every few minutes
+	uint64_t hash = HashData(data->data(), data->size());
+	NOAA_StationDataPtr previous = Get();
+	if ((hash == previous->sourceHash) && (content == previous->content) && (!previous->buoys.Empty())) {
+		busy = false;
+		return;
+	}
+
+	uint64_t start = NOAA_Statistics::Now();
+	NOAA_StationColumns buoys;
+	if (content == SNAPSHOT_SCHEDULED_REPORTS) {
+		ParseScheduledReports(data->data(), data->size(), &buoys);
+	}
+	else {
+		ParseStationList(data->data(), data->size(), &buoys);
+	}
+	data.reset();
+
+	// A captive portal, an error page served as a success or a truncated download parse to nothing.
+	// Keep the stations already drawn and the last good snapshot rather than replacing them with an empty set
+	if (buoys.Empty()) {
+		if (published) {
+			published(NOAA_StationDataPtr(), false);
+		}
+		busy = false;
+		return;
+	}
+
+	NOAA_StationDataPtr stations = Build(content, hash, buoys);
+	if (statistics != NULL) {
+		statistics->Record(STAT_PARSE_STATIONS, NOAA_Statistics::Now() - start);
+	}
+	Publish(stations);
+
+	bool saved = false;
+	if (!snapshotFile.empty()) {
+		SnapshotInfo info;
+		info.content = content;
+		info.sourceHash = hash;
+		info.created = (int64_t)time(NULL);
+		saved = SaveSnapshot(snapshotFile, info, stations->buoys);
+	}
+
+	if (published) {
+		published(stations, saved);
+	}
+
+	busy = false;
+}
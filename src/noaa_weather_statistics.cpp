@@ -0,0 +1,151 @@
+// Copyright(C) 2025 by Steven Adler
+//
+// This file is part of NOAA Weather plugin for OpenCPN.
+//
+// NOAA Weather plugin for OpenCPN is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// NOAA Weather plugin for OpenCPN is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with the NOAA Weather plugin for OpenCPN. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "noaa_weather_statistics.h"
+
+#include <chrono>
+
+NOAA_Histogram::NOAA_Histogram() {
+	Reset();
+}
+
+void NOAA_Histogram::Record(uint64_t value) {
+	int bucket = 0;
+	while ((bucket < HISTOGRAM_BUCKETS - 1) && ((value >> bucket) != 0)) {
+		bucket++;
+	}
+
+	buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+	count.fetch_add(1, std::memory_order_relaxed);
+	sum.fetch_add(value, std::memory_order_relaxed);
+
+	uint64_t previous = maximum.load(std::memory_order_relaxed);
+	while ((value > previous) && (!maximum.compare_exchange_weak(previous, value, std::memory_order_relaxed))) {
+	}
+}
+
+void NOAA_Histogram::Reset(void) {
+	for (int i = 0; i < HISTOGRAM_BUCKETS; i++) {
+		buckets[i].store(0, std::memory_order_relaxed);
+	}
+	count.store(0, std::memory_order_relaxed);
+	sum.store(0, std::memory_order_relaxed);
+	maximum.store(0, std::memory_order_relaxed);
+}
+
+HistogramSummary NOAA_Histogram::Summarize(void) const {
+	// Values recorded while summarizing may or may not be included, the totals are taken from the
+	// buckets so the percentiles are at least consistent with each other
+	uint64_t counts[HISTOGRAM_BUCKETS];
+	uint64_t total = 0;
+	for (int i = 0; i < HISTOGRAM_BUCKETS; i++) {
+		counts[i] = buckets[i].load(std::memory_order_relaxed);
+		total += counts[i];
+	}
+
+	HistogramSummary summary;
+	summary.count = total;
+	summary.sum = sum.load(std::memory_order_relaxed);
+	summary.maximum = maximum.load(std::memory_order_relaxed);
+	summary.p50 = Percentile(counts, total, 0.50, summary.maximum);
+	summary.p90 = Percentile(counts, total, 0.90, summary.maximum);
+	summary.p99 = Percentile(counts, total, 0.99, summary.maximum);
+	return summary;
+}
+
+uint64_t NOAA_Histogram::Percentile(const uint64_t *counts, uint64_t total, double percentile, uint64_t maximum) const {
+	if (total == 0) {
+		return 0;
+	}
+
+	uint64_t rank = (uint64_t)((percentile * total) + 0.5);
+	if (rank == 0) {
+		rank = 1;
+	}
+
+	uint64_t seen = 0;
+	for (int i = 0; i < HISTOGRAM_BUCKETS; i++) {
+		seen += counts[i];
+		if (seen >= rank) {
+			if (i == HISTOGRAM_BUCKETS - 1) {
+				return maximum;
+			}
+			uint64_t upper = ((uint64_t)1 << i) - 1;
+			return (upper < maximum) ? upper : maximum;
+		}
+	}
+	return maximum;
+}
+
+NOAA_Statistics::NOAA_Statistics() {
+	Reset();
+}
+
+void NOAA_Statistics::Reset(void) {
+	for (int i = 0; i < STAT_HISTOGRAMS; i++) {
+		histograms[i].Reset();
+	}
+	for (int i = 0; i < COUNTER_COUNT; i++) {
+		counters[i].store(0, std::memory_order_relaxed);
+	}
+	started.store(Now(), std::memory_order_relaxed);
+}
+
+uint64_t NOAA_Statistics::Uptime(void) const {
+	return (Now() - started.load(std::memory_order_relaxed)) / 1000000;
+}
+
+uint64_t NOAA_Statistics::Now(void) {
+	return (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+const char *NOAA_Statistics::Name(STATISTIC statistic) {
+	static const char *names[STAT_HISTOGRAMS] = { "pointsLookup", "download", "downloadSize",
+		"parseForecast", "parseAlerts", "parseStations", "parseRealtime", "dialog",
+		"filterVisible", "renderDC", "renderGL", "frameIcons" };
+	return names[statistic];
+}
+
+const char *NOAA_Statistics::Unit(STATISTIC statistic) {
+	switch (statistic) {
+		case STAT_DOWNLOAD_BYTES:
+			return "bytes";
+		case STAT_FRAME_ICONS:
+			return "icons";
+		default:
+			return "us";
+	}
+}
+
+const char *NOAA_Statistics::Name(COUNTER counter) {
+	static const char *names[COUNTER_COUNT] = { "cacheFresh", "cacheStale", "cacheMiss",
+		"cacheNotModified", "pointsHit", "pointsMiss", "downloadFailed", "prefetched", "prefetchHit" };
+	return names[counter];
+}
+
+NOAA_StatisticsTimer::NOAA_StatisticsTimer(NOAA_Statistics *statistics, STATISTIC statistic) :
+	statistics(statistics), statistic(statistic) {
+	start = (statistics != NULL) ? NOAA_Statistics::Now() : 0;
+}
+
+NOAA_StatisticsTimer::~NOAA_StatisticsTimer() {
+	if (statistics != NULL) {
+		statistics->Record(statistic, NOAA_Statistics::Now() - start);
+	}
+}
@@ -0,0 +1,148 @@
+// Copyright(C) 2025 by Steven Adler
+//
+// This file is part of NOAA Weather plugin for OpenCPN.
+//
+// NOAA Weather plugin for OpenCPN is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// NOAA Weather plugin for OpenCPN is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with the NOAA Weather plugin for OpenCPN. If not, see <https://www.gnu.org/licenses/>.
+//
+
+#include "noaa_weather_table.h"
+
+#include <algorithm>
+#include <cmath>
+
+// NWS units of measure are WMO codes, eg. "wmoUnit:degC"
+#define WMO_UNIT_PREFIX "wmoUnit:"
+
+NOAA_ForecastTable::NOAA_ForecastTable(const NOAA_Forecast *forecast) : forecast(forecast) {
+}
+
+int NOAA_ForecastTable::GetNumberRows() {
+	return (int)forecast->Hours();
+}
+
+int NOAA_ForecastTable::GetNumberCols() {
+	return (int)columns.size();
+}
+
+bool NOAA_ForecastTable::IsEmptyCell(int row, int col) {
+	return std::isnan(forecast->Value(columns[col], row));
+}
+
+wxString NOAA_ForecastTable::GetValue(int row, int col) {
+	double value = forecast->Value(columns[col], row);
+	if (std::isnan(value)) {
+		return wxEmptyString;
+	}
+
+	// Angles and percentages are whole numbers, don't need more than 2 decimal places for anything else !!
+	const std::string& unit = forecast->LayerUnit(columns[col]);
+	if ((unit == WMO_UNIT_PREFIX "degree_(angle)") || (unit == WMO_UNIT_PREFIX "percent")) {
+		return wxString::Format("%d", (int)lround(value));
+	}
+	return wxString::Format("%0.2f", value);
+}
+
+void NOAA_ForecastTable::SetValue(int row, int col, const wxString& value) {
+	// The forecast is read only
+}
+
+// Times are displayed in UTC, as they are given by NWS
+wxString NOAA_ForecastTable::GetRowLabelValue(int row) {
+	return wxDateTime((time_t)forecast->Time(row)).Format("%Y-%m-%d %H:%M", wxDateTime::UTC);
+}
+
+wxString NOAA_ForecastTable::GetColLabelValue(int col) {
+	return GetLayerTitle(*forecast, columns[col]);
+}
+
+void NOAA_ForecastTable::ShowLayer(size_t layer, bool show) {
+	auto it = std::find(columns.begin(), columns.end(), layer);
+
+	if ((show) && (it == columns.end())) {
+		columns.push_back(layer);
+		if (GetView() != NULL) {
+			wxGridTableMessage message(this, wxGRIDTABLE_NOTIFY_COLS_APPENDED, 1);
+			GetView()->ProcessTableMessage(message);
+		}
+	}
+	else if ((!show) && (it != columns.end())) {
+		int position = (int)(it - columns.begin());
+		columns.erase(it);
+		if (GetView() != NULL) {
+			wxGridTableMessage message(this, wxGRIDTABLE_NOTIFY_COLS_DELETED, position, 1);
+			GetView()->ProcessTableMessage(message);
+		}
+	}
+}
+
+void NOAA_ForecastTable::HoursChanged(int previousRows) {
+	if (GetView() == NULL) {
+		return;
+	}
+
+	int rows = GetNumberRows();
+	if (rows > previousRows) {
+		wxGridTableMessage message(this, wxGRIDTABLE_NOTIFY_ROWS_APPENDED, rows - previousRows);
+		GetView()->ProcessTableMessage(message);
+	}
+	else if (rows < previousRows) {
+		wxGridTableMessage message(this, wxGRIDTABLE_NOTIFY_ROWS_DELETED, rows, previousRows - rows);
+		GetView()->ProcessTableMessage(message);
+	}
+}
+
+bool NOAA_ForecastTable::IsLayerShown(size_t layer) const {
+	return std::find(columns.begin(), columns.end(), layer) != columns.end();
+}
+
+// Split the camel case layer name into words and append the unit, eg. "windSpeed" becomes "Wind Speed (km/h)"
+wxString NOAA_ForecastTable::GetLayerTitle(const NOAA_Forecast& forecast, size_t layer) {
+	return GetLayerTitle(forecast.LayerName(layer), forecast.LayerUnit(layer));
+}
+
+wxString NOAA_ForecastTable::GetLayerTitle(const std::string& layerName, const std::string& layerUnit) {
+	wxString name = wxString::FromUTF8(layerName.c_str());
+	wxString title;
+	for (size_t i = 0; i < name.Length(); i++) {
+		if (i == 0) {
+			title += wxString(name[i]).Upper();
+		}
+		else {
+			if (wxIsupper(name[i])) {
+				title += " ";
+			}
+			title += name[i];
+		}
+	}
+
+	wxString unit = wxString::FromUTF8(layerUnit.c_str());
+	unit.Replace(WMO_UNIT_PREFIX, wxEmptyString);
+	if (unit == "degC") {
+		unit = wxString::FromUTF8("\xC2\xB0" "C");
+	}
+	else if (unit == "degree_(angle)") {
+		unit = wxString::FromUTF8("\xC2\xB0");
+	}
+	else if (unit == "km_h-1") {
+		unit = "km/h";
+	}
+	else if (unit == "percent") {
+		unit = "%";
+	}
+
+	if (!unit.IsEmpty()) {
+		title += " (" + unit + ")";
+	}
+	return title;
+}